@@ -0,0 +1,92 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#include "counters.hxx"
+
+
+
+namespace soma {
+
+namespace {
+
+// JSON members common to each depth and totals
+void write_depth(
+std::ostream                &output,
+const Counters::Depth       &depth )
+{
+    output << "\"nodes\":"      << depth.nodes
+           << ",\"tries\":"      << depth.tries
+           << ",\"fits\":"       << depth.fits
+           << ",\"orphans\":"    << depth.orphans
+           << ",\"duplicates\":" << depth.duplicates
+           << ",\"seconds\":"    << depth.nanoseconds / 1e9;
+}
+
+}  // namespace
+
+
+
+// See counters.hxx
+Counters::Depth Counters::totals()
+const
+{
+    Depth   totals{0, 0, 0, 0, 0, 0};
+
+    for (const Depth &depth : _depths) {
+        totals.nodes       += depth.nodes      ;
+        totals.tries       += depth.tries      ;
+        totals.fits        += depth.fits       ;
+        totals.orphans     += depth.orphans    ;
+        totals.duplicates  += depth.duplicates ;
+        totals.nanoseconds += depth.nanoseconds;
+    }
+
+    return totals;
+
+}  // totals() const
+
+
+
+// See counters.hxx
+void Counters::write_json(
+std::ostream        &output     ,
+const std::string   &piece_order)
+const
+{
+    output << "{\"depths\":[";
+
+    for (unsigned ndx = 0 ; ndx < NUMBER_OF_DEPTHS ; ++ndx) {
+        output << (ndx ? ",{" : "{")
+               << "\"depth\":"
+               << ndx + 1
+               << ",\"piece\":\""
+               << (ndx < piece_order.size() ? piece_order[ndx] : '?')
+               << "\",";
+        write_depth(output, _depths[ndx]);
+        output << '}';
+    }
+
+    output << "],\"totals\":{";
+    write_depth(output, totals());
+    output << "}}";
+
+}  // write_json(std::ostream&, const std::string&) const
+
+}  // namespace soma
@@ -0,0 +1,84 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef COUNTERS_HXX
+#define COUNTERS_HXX
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+
+
+namespace soma {
+
+// Per-depth (piece number 1 through 7 in -P order) search tree counters.
+// Unlike Engine::statistics ones, not a template parameter of
+//   Piece::place() but only updated if enabled at runtime via
+//   Soma::counters(true), so cost only a pointer test per placement
+//   attempt when disabled.
+// Reset by Soma::reset(), so values are for single figure.
+//
+class Counters {
+  public:
+    // Must match Piece::NUMBER_OF_PIECES (not included here so
+    //   piece.hxx can include this file)
+    static const unsigned   NUMBER_OF_DEPTHS = 7;
+
+    struct Depth {
+        uint64_t    nodes      ,  // successful placements (tree nodes)
+                    tries      ,  // Shape::place_piece() attempts
+                    fits       ,  //   "       "    successes
+                    orphans    ,  // fits rejected by Shape::has_orphan()
+                              //   or Shape::forward_check()
+                    duplicates ,  //  "      "     "  duplicate checks
+                    nanoseconds;  // time spent in Piece::place()
+    };
+
+    Counters() { reset(); }
+
+    void reset()
+    {
+        for (Depth &depth : _depths)
+            depth = Depth{0, 0, 0, 0, 0, 0};
+    }
+
+          Depth& operator[](unsigned depth)       { return _depths[depth]; }
+    const Depth& operator[](unsigned depth) const { return _depths[depth]; }
+
+    // Sum of all depths
+    Depth   totals() const;
+
+    // Single-line JSON object, one element per depth plus totals.
+    // piece_order is Soma::piece_order(), for labeling depths.
+    void    write_json(std::ostream         &output     ,
+                       const std::string    &piece_order) const;
+
+
+
+  protected:
+    std::array<Depth, NUMBER_OF_DEPTHS>     _depths;
+
+};  // class Counters
+
+}  // namespace soma
+
+#endif  // #ifndef COUNTERS_HXX
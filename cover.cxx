@@ -0,0 +1,212 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <utility>
+
+#include "cover.hxx"
+
+
+
+namespace soma {
+
+// See cover.hxx
+Cover::Cover(
+const uint32_t                               cells,
+const std::vector<std::vector<uint32_t>>    &items)
+:   _cells          (cells                    ),
+    _all_items      ((1 << items.size()) - 1  ),
+    _items          (items                    ),
+    _cell_placements(32                       ),
+    _scores         (items.size()             ),
+    _chosen         (items.size(), 0          ),
+    _nodes          (0                        ),
+    _limit          (0                        ),
+    _restarts       (0                        ),
+    _aborted        (false                    )
+{
+    for (unsigned item = 0 ; item < _items.size() ; ++item)
+        for (unsigned     placement = 0                     ;
+                          placement < _items[item].size()   ;
+                        ++placement                          )
+            for (unsigned cell = 0 ; cell < 32 ; ++cell)
+                if (_items[item][placement] & (1u << cell))
+                    _cell_placements[cell].emplace_back(item, placement);
+}
+
+
+
+// See cover.hxx
+bool Cover::solve(
+const uint64_t           seed  ,
+std::vector<unsigned>   &chosen)
+{
+    std::mt19937_64                         random(seed);
+    std::uniform_real_distribution<double>  jitter(1.0, 1.25);
+
+    _nogoods.clear();
+    _nodes    = 0;
+    _restarts = 0;
+
+    while (true) {
+        // Cells covered by fewer placements are harder to cover later,
+        //   so prefer placements covering them
+        for (unsigned item = 0 ; item < _items.size() ; ++item) {
+            _scores[item].resize(_items[item].size());
+            for (unsigned     placement = 0                     ;
+                              placement < _items[item].size()   ;
+                            ++placement                          ) {
+                double  score = 0.0;
+                for (unsigned cell = 0 ; cell < 32 ; ++cell)
+                    if (_items[item][placement] & (1u << cell))
+                        score += 1.0 / _cell_placements[cell].size();
+                _scores[item][placement] = _restarts ? score * jitter(random)
+                                                     : score                ;
+            }
+        }
+
+        // Geometric node limits, effectively unlimited after ~50 restarts
+        _limit   =   _restarts < 48
+                   ? _nodes + (uint64_t(256) << _restarts)
+                   : std::numeric_limits<uint64_t>::max();
+        _aborted = false;
+
+        if (search(0, 0)) {
+            chosen = _chosen;
+            return true;
+        }
+
+        if (!_aborted)
+            return false;
+
+        ++_restarts;
+    }
+
+}  // solve(const uint64_t, std::vector<unsigned>&)
+
+
+
+// See cover.hxx
+bool Cover::search(
+const uint32_t  covered,
+const unsigned  used   )
+{
+    if (used == _all_items)
+        return covered == _cells;
+
+    const uint64_t  key = static_cast<uint64_t>(covered) << 8 | used;
+
+    if (covered == _cells || _nogoods.count(key))
+        return false;
+
+    if (++_nodes > _limit) {
+        _aborted = true;
+        return false;
+    }
+
+    // Most constrained uncovered cell, or unused item, whichever has
+    //   fewer remaining placements. Dead end if any has none.
+    unsigned    fewest    = std::numeric_limits<unsigned>::max(),
+                best_cell = 32                                 ,
+                best_item = MAX_ITEMS                          ;
+
+    for (unsigned cell = 0 ; cell < 32 ; ++cell) {
+        if (!(_cells & ~covered & (1u << cell)))
+            continue;
+
+        unsigned    count = 0;
+        for (const std::pair<unsigned, unsigned> &candidate
+             : _cell_placements[cell])
+            if (   !(used & (1 << candidate.first))
+                && !(_items[candidate.first][candidate.second] & covered))
+                ++count;
+
+        if (count < fewest) {
+            fewest    = count;
+            best_cell = cell ;
+            if (count == 0) {
+                _nogoods.insert(key);
+                return false;
+            }
+        }
+    }
+
+    for (unsigned item = 0 ; item < _items.size() ; ++item) {
+        if (used & (1 << item))
+            continue;
+
+        unsigned    count = 0;
+        for (const uint32_t mask : _items[item])
+            if (!(mask & covered))
+                ++count;
+
+        if (count < fewest) {
+            fewest    = count;
+            best_item = item ;
+            if (count == 0) {
+                _nogoods.insert(key);
+                return false;
+            }
+        }
+    }
+
+    std::vector<std::pair<unsigned, unsigned>>  candidates;
+    if (best_item != MAX_ITEMS) {
+        for (unsigned     placement = 0                         ;
+                          placement < _items[best_item].size()  ;
+                        ++placement                              )
+            if (!(_items[best_item][placement] & covered))
+                candidates.emplace_back(best_item, placement);
+    }
+    else
+        for (const std::pair<unsigned, unsigned> &candidate
+             : _cell_placements[best_cell])
+            if (   !(used & (1 << candidate.first))
+                && !(_items[candidate.first][candidate.second] & covered))
+                candidates.push_back(candidate);
+
+    std::sort(candidates.begin(),
+              candidates.end  (),
+              [this](const std::pair<unsigned, unsigned> &left ,
+                     const std::pair<unsigned, unsigned> &right)
+              {
+                  return   _scores[left .first][left .second]
+                         > _scores[right.first][right.second];
+              });
+
+    for (const std::pair<unsigned, unsigned> &candidate : candidates) {
+        _chosen[candidate.first] = candidate.second;
+
+        if (search(covered | _items[candidate.first][candidate.second],
+                   used    | (1 << candidate.first)                    ))
+            return true;
+
+        if (_aborted)
+            return false;  // not proven, so not a nogood
+    }
+
+    _nogoods.insert(key);
+    return false;
+
+}  // search(const uint32_t, const unsigned)
+
+}  // namespace soma
@@ -0,0 +1,95 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef COVER_HXX
+#define COVER_HXX
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+
+
+namespace soma {
+
+// Exact cover of up to 32 cells by one placement (bitmask of cells)
+//   from each of up to 8 items (pieces).
+// Independent of Shape/Piece search in Soma::solve(): no duplicate
+//   checking, no fixed piece order. Used for existence-only queries
+//   (Soma::exists()) where time to first solution matters.
+//
+class Cover {
+  public:
+    static const unsigned   MAX_ITEMS = 8;
+
+    // cells:  bitmask of cells to be covered
+    // items:  per item, all its candidate placements
+    Cover(const uint32_t                                 cells,
+          const std::vector<std::vector<uint32_t>>      &items);
+
+    // Find any one exact cover. Returns true and index into items[N]
+    //   for each item N in chosen, or false if none exists.
+    // Depth-first search choosing most constrained cell or item
+    //   first, and placements covering hardest-to-cover cells first.
+    // Randomized restarts with increasing node limits, sharing
+    //   record of proven-unsolvable partial covers (which makes
+    //   final, unlimited, restart complete).
+    bool    solve(const uint64_t             seed  ,
+                  std::vector<unsigned>     &chosen);
+
+    // Statistics from last solve()
+    uint64_t    nodes   () const { return _nodes           ; }
+    unsigned    restarts() const { return _restarts        ; }
+    size_t      nogoods () const { return _nogoods.size()  ; }
+
+
+
+  protected:
+    // Returns true if cover found (in _chosen), false if none or if
+    //   node limit reached (_aborted == true)
+    bool    search(const uint32_t   covered,
+                   const unsigned   used   );
+
+    uint32_t                                _cells        ;
+    unsigned                                _all_items    ;  // bitmask
+    const std::vector<std::vector<uint32_t>>  &_items     ;
+
+    // Per cell, (item, placement) pairs covering it
+    std::vector<std::vector<std::pair<unsigned, unsigned>>>
+                                            _cell_placements;
+
+    // Value ordering: sum over covered cells of 1/(number of placements
+    //   covering cell), with random jitter per restart
+    std::vector<std::vector<double>>        _scores       ;
+
+    // (covered << 8 | used) known to have no completion
+    std::unordered_set<uint64_t>            _nogoods      ;
+
+    std::vector<unsigned>                   _chosen       ;
+    uint64_t                                _nodes        ,
+                                            _limit        ;
+    unsigned                                _restarts     ;
+    bool                                    _aborted      ;
+
+};  // class Cover
+
+}  // namespace soma
+
+#endif  // #ifndef COVER_HXX
@@ -0,0 +1,475 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#include <algorithm>
+
+#include "decompose.hxx"
+
+
+
+namespace soma {
+
+// See decompose.hxx
+Decompose::Decompose(
+const std::vector<Part>                     &parts    ,
+const std::vector<std::vector<uint32_t>>    &items    ,
+const std::vector<uint32_t>                 &adjacents,
+const unsigned                               pos      ,
+const unsigned                               neg      )
+:   _parts      (parts                             ),
+    _items      (items                             ),
+    _adjacents  (adjacents                         ),
+    _pos        (pos                               ),
+    _neg        (neg                               ),
+    _sizes      (items.size()                      ),
+    _subsets    (parts.size()                      ),
+    _remaining  (parts.size()                      ),
+    _item_parts (items.size()                      ),
+    _total      (0                                 ),
+    _nodes      (0                                 ),
+    _splits     (0                                 ),
+    _assignments(0                                 )
+{
+    for (unsigned item = 0 ; item < _items.size() ; ++item) {
+        if (!_items[item].empty())
+            _sizes[item] = __builtin_popcount(_items[item][0]);
+
+        for (unsigned     placement = 0                     ;
+                          placement < _items[item].size()   ;
+                        ++placement                          )
+            _lowest[__builtin_ctz(_items[item][placement])]
+            .emplace_back(item, placement);
+    }
+
+}  // Decompose(...)
+
+
+
+// See decompose.hxx
+uint64_t Decompose::count(
+const bool  unique)
+{
+    _total       = 0;
+    _nodes       = 0;
+    _splits      = 0;
+    _assignments = 0;
+
+    for (unsigned part = 0 ; part < _parts.size() ; ++part) {
+        _subsets  [part] = 0;
+        _remaining[part] = __builtin_popcount(_parts[part].cells);
+    }
+
+    assign(0, unique);
+
+    return _total;
+
+}  // count(const bool)
+
+
+
+// Recursively assign each item to a part with enough remaining
+//   cells, and at end add product of parts' covers to _total
+//
+void Decompose::assign(
+const unsigned  item  ,
+const bool      unique)
+{
+    if (item < _items.size()) {
+        for (unsigned part = 0 ; part < _parts.size() ; ++part) {
+            if (_remaining[part] < _sizes[item])
+                continue;
+
+            // Must have a placement in part
+            bool    fits = false;
+            for (const uint32_t mask : _items[item])
+                if (!(mask & ~_parts[part].cells)) {
+                    fits = true;
+                    break;
+                }
+            if (!fits)
+                continue;
+
+            _subsets   [part] |= 1 << item  ;
+            _remaining [part] -= _sizes[item];
+            _item_parts[item]  = part        ;
+
+            assign(item + 1, unique);
+
+            _subsets  [part] &= ~(1 << item);
+            _remaining[part] += _sizes[item];
+        }
+        return;
+    }
+
+    for (unsigned part = 0 ; part < _parts.size() ; ++part)
+        if (_remaining[part])
+            return;
+
+    ++_assignments;
+
+    const unsigned  pos_part = _item_parts[_pos],
+                    neg_part = _item_parts[_neg];
+    uint64_t        product  = 1                ,
+                    mirrored = 1                ;
+
+    for (unsigned part = 0 ; part < _parts.size() ; ++part) {
+        if (!unique)
+            product *= tally(_parts[part].cells, _subsets[part]);
+        else {
+            const Covers    &part_covers = covers(part, _subsets[part]);
+
+            product *= part_covers.canonical.size();
+
+            if (part == pos_part || part == neg_part)
+                mirrored *= part_covers.mirrored;
+            else
+                mirrored *= part_covers.canonical.size();
+        }
+
+        if (!product)
+            return;
+    }
+
+    _total += product;
+
+    // Jointly reflecting parts with "p" and "n" maps each such cover
+    //   to one with the two items exchanged (counted by that
+    //   assignment), so subtract those counted twice, once
+    if (unique && pos_part < neg_part)
+        _total -= mirrored;
+
+}  // assign(const unsigned, const bool)
+
+
+
+// Memoized covers of part by subset of items. Canonical covers are
+//   least images under all of part's rotations and reflections unless
+//   subset has only one of "p" and "n" items, in which case rotations
+//   only, and then mirrored is number of canonical covers with a
+//   reflected image in covers of part by subset with other item.
+//
+const Decompose::Covers& Decompose::covers(
+const unsigned  part  ,
+const unsigned  subset)
+{
+    const unsigned                              key   =   part << MAX_ITEMS
+                                                        | subset          ;
+    const std::map<unsigned, Covers>::iterator  found = _covers.find(key) ;
+
+    if (found != _covers.end())
+        return found->second;
+
+    const unsigned  pos_neg = 1 << _pos | 1 << _neg  ;
+    const bool      both    =    (subset & pos_neg) == 0
+                              || (subset & pos_neg) == pos_neg;
+    Covers         &result  = _covers[key];
+    Cover           cover   ;
+
+    cover.fill(0);
+    result.mirrored = 0;
+    enumerate(_parts[part].cells,
+              subset            ,
+              cover             ,
+              [this, part, both, &result](const Cover &cover)
+              {
+                  Cover     least = canonical(cover                   ,
+                                              _parts[part].rotations  ,
+                                              false                   );
+                  if (both)
+                      least = std::min(least,
+                                       canonical(cover                    ,
+                                                 _parts[part].reflections ,
+                                                 true                     ));
+                  result.canonical.insert(least);
+              });
+
+    if (both)
+        return result;
+
+    const Covers    &other = covers(part, subset ^ pos_neg);
+
+    for (const Cover &canonical : result.canonical)
+        if (other.canonical.count(this->canonical(canonical                    ,
+                                                  _parts[part].reflections,
+                                                  true                    )))
+            ++result.mirrored;
+
+    return result;
+
+}  // covers(const unsigned, const unsigned)
+
+
+
+// Memoized number of covers of cells by subset of items (whose sizes
+//   must sum to number of cells). Lowest cell covered by each item in
+//   turn, unless cells are disconnected, in which case sum over
+//   partitions of subset of product of regions' numbers.
+//
+uint64_t Decompose::tally(
+const uint32_t  cells ,
+const unsigned  subset)
+{
+    if (!cells)
+        return 1;
+
+    const uint64_t  key = static_cast<uint64_t>(cells) << MAX_ITEMS | subset;
+    const std::unordered_map<uint64_t, uint64_t>::iterator
+                    found = _tallies.find(key);
+
+    if (found != _tallies.end())
+        return found->second;
+
+    ++_nodes;
+
+    uint64_t                        total   = 0               ;
+    const std::vector<uint32_t>     regions = this->regions(cells);
+
+    if (regions.size() > 1) {
+        std::vector<unsigned>   subsets  (regions.size(), 0),
+                                remaining(regions.size()   );
+
+        ++_splits;
+        for (unsigned region = 0 ; region < regions.size() ; ++region)
+            remaining[region] = __builtin_popcount(regions[region]);
+
+        partition(regions  ,
+                  subset   ,
+                  subsets  ,
+                  remaining,
+                  [this, &regions, &subsets, &total]()
+                  {
+                      uint64_t  product = 1;
+                      for (unsigned     region = 0              ;
+                                        region < regions.size() && product ;
+                                      ++region                   )
+                          product *= tally(regions[region], subsets[region]);
+                      total += product;
+                  });
+    }
+    else
+        for (const std::pair<unsigned, unsigned> &candidate
+             : _lowest[__builtin_ctz(cells)]) {
+            const uint32_t  mask = _items[candidate.first][candidate.second];
+
+            if ((subset & (1 << candidate.first)) && !(mask & ~cells))
+                total += tally(cells  & ~mask                 ,
+                               subset & ~(1 << candidate.first));
+        }
+
+    _tallies[key] = total;
+
+    return total;
+
+}  // tally(const uint32_t, const unsigned)
+
+
+
+// Call found with each cover of cells by subset of items, added to
+//   cover's items already placed. As per tally(), except regions'
+//   covers are each enumerated once and then cross-producted.
+//
+void Decompose::enumerate(
+const uint32_t                              cells ,
+const unsigned                              subset,
+      Cover                                &cover ,
+const std::function<void(const Cover&)>    &found )
+{
+    if (!cells) {
+        found(cover);
+        return;
+    }
+
+    ++_nodes;
+
+    const std::vector<uint32_t>     regions = this->regions(cells);
+
+    if (regions.size() == 1) {
+        for (const std::pair<unsigned, unsigned> &candidate
+             : _lowest[__builtin_ctz(cells)]) {
+            const uint32_t  mask = _items[candidate.first][candidate.second];
+
+            if (!(subset & (1 << candidate.first)) || (mask & ~cells))
+                continue;
+
+            cover[candidate.first] = mask;
+            enumerate(cells  & ~mask                 ,
+                      subset & ~(1 << candidate.first),
+                      cover                           ,
+                      found                           );
+            cover[candidate.first] = 0;
+        }
+        return;
+    }
+
+    std::vector<unsigned>   subsets  (regions.size(), 0),
+                            remaining(regions.size()   );
+
+    ++_splits;
+    for (unsigned region = 0 ; region < regions.size() ; ++region)
+        remaining[region] = __builtin_popcount(regions[region]);
+
+    partition(regions  ,
+              subset   ,
+              subsets  ,
+              remaining,
+              [this, &regions, &subsets, &cover, &found]()
+    {
+        const unsigned                      num_regions = regions.size();
+        std::vector<std::vector<Cover>>     lists(num_regions);
+
+        for (unsigned region = 0 ; region < num_regions ; ++region) {
+            Cover   empty;
+
+            empty.fill(0);
+            enumerate(regions[region],
+                      subsets[region],
+                      empty          ,
+                      [&lists, region](const Cover &cover)
+                      {
+                          lists[region].push_back(cover);
+                      });
+
+            if (lists[region].empty())
+                return;
+        }
+
+        // Odometer over one cover from each region
+        std::vector<unsigned>   ndxs(num_regions, 0);
+        while (true) {
+            Cover   combined = cover;
+            for (unsigned region = 0 ; region < num_regions ; ++region)
+                for (unsigned item = 0 ; item < _items.size() ; ++item)
+                    combined[item] |= lists[region][ndxs[region]][item];
+            found(combined);
+
+            unsigned    region = 0;
+            while (   region < num_regions
+                   && ++ndxs[region] == lists[region].size())
+                ndxs[region++] = 0;
+            if (region == num_regions)
+                break;
+        }
+    });
+
+}  // enumerate(...)
+
+
+
+// Orthogonally connected regions of cells
+std::vector<uint32_t> Decompose::regions(
+const uint32_t  cells)
+const
+{
+    std::vector<uint32_t>   regions  ;
+    uint32_t                unvisited = cells;
+
+    while (unvisited) {
+        uint32_t    region  = 0                     ,
+                    pending = unvisited & -unvisited;  // lowest set bit
+
+        while (pending) {
+            const unsigned  ndx = __builtin_ctz(pending);
+
+            region  |= 1 << ndx;
+            pending  = (pending | _adjacents[ndx]) & unvisited & ~region;
+        }
+
+        regions.push_back(region);
+        unvisited &= ~region;
+    }
+
+    return regions;
+
+}   // regions(const uint32_t) const
+
+
+
+// Recursively assign each of items to one of regions with enough
+//   remaining cells, calling found with all regions exactly filled
+//
+void Decompose::partition(
+const std::vector<uint32_t>     &regions  ,
+const unsigned                   items    ,
+      std::vector<unsigned>     &subsets  ,
+      std::vector<unsigned>     &remaining,
+const std::function<void()>     &found    )
+{
+    if (!items) {
+        for (const unsigned cells : remaining)
+            if (cells)
+                return;
+        found();
+        return;
+    }
+
+    const unsigned  item = __builtin_ctz(items);
+
+    for (unsigned region = 0 ; region < regions.size() ; ++region) {
+        if (remaining[region] < _sizes[item])
+            continue;
+
+        subsets  [region] |= 1 << item  ;
+        remaining[region] -= _sizes[item];
+
+        partition(regions, items & ~(1 << item), subsets, remaining, found);
+
+        subsets  [region] &= ~(1 << item);
+        remaining[region] += _sizes[item];
+    }
+
+}  // partition(...)
+
+
+
+// Lexicographically least of images of cover, exchanging "p" and "n"
+//   items if mirror
+//
+Decompose::Cover Decompose::canonical(
+const Cover                 &cover ,
+const std::vector<Image>    &images,
+const bool                   mirror)
+const
+{
+    Cover   least;
+    least.fill(UINT32_MAX);
+
+    for (const Image &image : images) {
+        Cover   mapped;
+        mapped.fill(0);
+
+        for (unsigned item = 0 ; item < _items.size() ; ++item) {
+            unsigned    target = item;
+            if (mirror) {
+                if      (item == _pos) target = _neg;
+                else if (item == _neg) target = _pos;
+            }
+
+            for (uint32_t bits = cover[item] ; bits ; bits &= bits - 1)
+                mapped[target] |= 1 << image[__builtin_ctz(bits)];
+        }
+
+        least = std::min(least, mapped);
+    }
+
+    return least;
+
+}  // canonical(const Cover&, const std::vector<Image>&, const bool) const
+
+}  // namespace soma
@@ -0,0 +1,158 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef DECOMPOSE_HXX
+#define DECOMPOSE_HXX
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+
+
+namespace soma {
+
+// Counts exact covers of separated parts (cell bitmasks) of up to 32
+//   cells, by one placement from each of up to 8 items (pieces), by
+//   covering each part independently with each subset of items whose
+//   sizes sum to the part's, and joining results over all
+//   assignments of items to parts. Sum of products instead of
+//   search of product of parts' search spaces.
+// Same again within each part whenever placements split its
+//   uncovered cells into disconnected regions: regions are covered
+//   independently by each partition of the remaining items, and
+//   counts multiplied (or covers cross-producted when enumerating
+//   them for uniqueness) instead of re-covering each region once per
+//   cover of the others.
+// Independent of Shape/Piece search in Soma::solve(). Used for
+//   counting solutions of separated shapes (Soma::count()).
+//
+class Decompose {
+  public:
+    static const unsigned   MAX_ITEMS = 8;
+
+    // Cells to cells (cells not in part unchanged)
+    typedef std::array<uint8_t, 32>     Image;
+
+    struct Part {
+        uint32_t            cells      ;
+        std::vector<Image>  rotations  ,  // including identity
+                            reflections;  // exchange pos and neg items
+    };
+
+    // parts:      disjoint, together all cells to be covered
+    // items:      per item, all its candidate placements (one if
+    //             pre-placed), each within one part
+    // adjacents:  per cell, bitmask of orthogonally adjacent cells
+    // pos, neg:   mutually mirrored items ("p" and "n" pieces)
+    Decompose(const std::vector<Part>                   &parts    ,
+              const std::vector<std::vector<uint32_t>>  &items    ,
+              const std::vector<uint32_t>               &adjacents,
+              const unsigned                             pos      ,
+              const unsigned                             neg      );
+
+    // Number of covers. If unique, only one of each set equivalent
+    //   under independent rotation/reflection of parts containing
+    //   both or neither of pos and neg items, plus joint reflection of
+    //   the two parts containing them if separate (as per duplicate
+    //   checking by Shape::add_solution()).
+    uint64_t    count(const bool    unique);
+
+    // Statistics from last count()
+    uint64_t    nodes      () const { return _nodes      ; }
+    uint64_t    splits     () const { return _splits     ; }
+    unsigned    assignments() const { return _assignments; }
+
+
+
+  protected:
+    // Per item, cells covered (0 if item not in subset)
+    typedef std::array<uint32_t, MAX_ITEMS>     Cover;
+
+    // Unique covers of one part by one subset of items
+    struct Covers {
+        std::set<Cover>     canonical;  // lexicographically least images
+        uint64_t            mirrored ;  // canonical with valid reflection
+    };
+
+    const Covers&   covers   (const unsigned    part  ,
+                              const unsigned    subset);
+
+    uint64_t        tally    (const uint32_t    cells ,
+                              const unsigned    subset);
+
+    void            enumerate(const uint32_t                        cells ,
+                              const unsigned                        subset,
+                                    Cover                          &cover ,
+                              const std::function<void(const Cover&)>
+                                                                   &found );
+
+    std::vector<uint32_t>
+                    regions  (const uint32_t    cells ) const;
+
+    void            partition(const std::vector<uint32_t>   &regions  ,
+                              const unsigned                 items    ,
+                                    std::vector<unsigned>   &subsets  ,
+                                    std::vector<unsigned>   &remaining,
+                              const std::function<void()>   &found    );
+
+    Cover           canonical(const Cover               &cover ,
+                              const std::vector<Image>  &images,
+                              const bool                 mirror) const;
+
+    void            assign   (const unsigned    item  ,
+                              const bool        unique);
+
+    const std::vector<Part>                    &_parts    ;
+    const std::vector<std::vector<uint32_t>>   &_items    ;
+    const std::vector<uint32_t>                &_adjacents;
+    const unsigned                              _pos      ,
+                                                _neg      ;
+
+    // Per item, cells in placement (all same), and per cell,
+    //   (item, placement) pairs with that as lowest cell
+    std::vector<unsigned>                       _sizes ;
+    std::array<std::vector<std::pair<unsigned, unsigned>>, 32>
+                                                _lowest;
+
+    // Keyed by part << MAX_ITEMS | subset
+    std::map<unsigned, Covers>                  _covers ;
+
+    // Number of covers, keyed by cells << MAX_ITEMS | subset
+    std::unordered_map<uint64_t, uint64_t>      _tallies;
+
+    // State of assign()
+    std::vector<unsigned>                       _subsets  ,  // per part
+                                                _remaining;  // cells
+    std::vector<unsigned>                       _item_parts; // per item
+    uint64_t                                    _total      ,
+                                                _nodes      ,
+                                                _splits     ;
+    unsigned                                    _assignments;
+
+};  // class Decompose
+
+}  // namespace soma
+
+#endif  // #ifndef DECOMPOSE_HXX
@@ -0,0 +1,48 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+
+#ifndef ENGINE_HXX
+#define ENGINE_HXX
+
+
+
+namespace soma {
+
+// Alternate implementations of solver internals, all compiled into
+//   the program and selected at run time via Soma::engine().
+// Each setting becomes a template parameter of the Piece::placer()
+//   chosen once per figure by Soma::init_shape() (see piece.cxx),
+//   so the variants cost nothing in the inner search loop.
+// Results are identical, only speed differs.
+//
+struct Engine {
+    bool    lambda_rotation = false,  // Rotators::lambdas instead of
+                                      //   Rotators::matrices
+            ordered_sets    = false,  // std::set instead of
+                                      //   std::unordered_set for
+                                      //   duplicate solutions
+            statistics      = false;  // update Piece and Shape
+                                      //   statistics counters
+};  // struct Engine
+
+}  // namespace soma
+
+#endif  // #ifndef ENGINE_HXX
@@ -0,0 +1,155 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#include <algorithm>
+
+#include "enumerate.hxx"
+
+
+
+namespace soma {
+
+// See enumerate.hxx
+Enumerate::Enumerate(
+const Figure::Coords                                    &box     ,
+const unsigned                                           cubicles,
+const unsigned                                           rules   ,
+const std::vector<std::vector<std::vector<Figure::Coords>>>
+                                                        &items   )
+:   _cells     (box[0] * box[1] * box[2]                         ),
+    _cubicles  (cubicles                                         ),
+    _rules     (rules                                            ),
+    _figure    (std::vector<Figure::Coords>()                    ,
+                std::vector<std::pair<Figure::Coords, char>>()   ,
+                items                                            ),
+    _candidates(0                                                ),
+    _solvable  (0                                                )
+{
+    auto    index = [&box](const Figure::Coords &position)
+                    {
+                        return   (position[2] * box[1] + position[1])
+                               * box[0] + position[0];
+                    };
+
+    _faces.fill(0);
+
+    for (int z = 0 ; z < box[2] ; ++z)
+        for (int y = 0 ; y < box[1] ; ++y)
+            for (int x = 0 ; x < box[0] ; ++x) {
+                const Figure::Coords    position{{x, y, z}};
+                const uint64_t          bit = 1ull << _coords.size();
+
+                _below.push_back(z ? index({{x, y, z - 1}}) : -1);
+
+                _adjacent.push_back(0);
+                for (unsigned axis = 0 ; axis < 3 ; ++axis)
+                    for (const int step : {-1, 1}) {
+                        Figure::Coords  neighbor = position;
+                        neighbor[axis] += step;
+                        if (neighbor[axis] >= 0 && neighbor[axis] < box[axis])
+                            _adjacent.back() |= 1ull << index(neighbor);
+                    }
+
+                for (unsigned axis = 0 ; axis < 3 ; ++axis) {
+                    if (position[axis] == 0)
+                        _faces[axis * 2    ] |= bit;
+                    if (position[axis] == box[axis] - 1)
+                        _faces[axis * 2 + 1] |= bit;
+                }
+
+                _coords.push_back(position);
+            }
+
+    // Axis permutations keeping box's sizes, times reflections
+    std::array<unsigned, 3>     axes{{0, 1, 2}};
+    do {
+        if (   box[axes[0]] != box[0]
+            || box[axes[1]] != box[1]
+            || box[axes[2]] != box[2])
+            continue;
+
+        for (unsigned signs = 0 ; signs < 8 ; ++signs) {
+            if (signs == 0 && axes[0] == 0 && axes[1] == 1)  // identity
+                continue;
+
+            std::array<uint8_t, MAX_CELLS>  image;
+
+            for (unsigned cell = 0 ; cell < _cells ; ++cell) {
+                Figure::Coords  position;
+                for (unsigned axis = 0 ; axis < 3 ; ++axis) {
+                    const int   from = _coords[cell][axes[axis]];
+                    position[axis] =   signs & (1 << axis)
+                                     ? box[axis] - 1 - from
+                                     : from                ;
+                }
+                image[cell] = index(position);
+            }
+
+            _symmetries.push_back(image);
+        }
+    } while (std::next_permutation(axes.begin(), axes.end()));
+
+}  // Enumerate(const Figure::Coords&, const unsigned, const unsigned, ...)
+
+
+
+// Bounding box is whole box, connected, least of its images under
+//   box's symmetries, and, if SYMMETRIC, equal to one of them
+//
+bool Enumerate::accept(
+const uint64_t  cells)
+const
+{
+    for (const uint64_t face : _faces)
+        if (!(cells & face))
+            return false;
+
+    uint64_t    reached = cells & -cells,
+                last    = 0             ;
+
+    while (reached != last) {
+        last = reached;
+        for (uint64_t bits = last ; bits ; bits &= bits - 1)
+            reached |= _adjacent[__builtin_ctzll(bits)] & cells;
+    }
+
+    if (reached != cells)
+        return false;
+
+    bool    symmetric = false;
+
+    for (const std::array<uint8_t, MAX_CELLS> &image : _symmetries) {
+        uint64_t    mapped = 0;
+
+        for (uint64_t bits = cells ; bits ; bits &= bits - 1)
+            mapped |= 1ull << image[__builtin_ctzll(bits)];
+
+        if (mapped < cells)
+            return false;
+
+        if (mapped == cells)
+            symmetric = true;
+    }
+
+    return symmetric || !(_rules & SYMMETRIC);
+
+}  // accept(const uint64_t) const
+
+}  // namespace soma
@@ -0,0 +1,150 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef ENUMERATE_HXX
+#define ENUMERATE_HXX
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "figure.hxx"
+
+
+
+namespace soma {
+
+// All orthogonally connected figures of a given number of cubicles
+//   whose bounding box is exactly box (so each translation counted
+//   once), each once up to the rotations/reflections mapping box onto
+//   itself (least bitmask of box cells kept), optionally restricted by
+//   rules, and screened for solvability.
+// Box cells are decided in order (z, then y, then x, from 0) by
+//   depth-first include/exclude, with one Figure updated as cells are
+//   included and excluded again on backtracking, so each candidate's
+//   placements are mostly already generated by its prefix, and
+//   checked by Figure::solvable(). No files, and no Shape/Piece
+//   search.
+//
+class Enumerate {
+  public:
+    static const unsigned   MAX_CELLS = 64;  // of box
+
+    // Rules, bitmask
+    static const unsigned   SUPPORTED = 1,  // each cubicle above z 0
+                                            //   has one directly below
+                            SYMMETRIC = 2;  // equal to some non-identity
+                                            //   rotation/reflection
+
+    // box:        x, y, z sizes, at most MAX_CELLS cells and at least
+    //             cubicles
+    // cubicles:   per figure, at most Figure::MAX_CUBICLES
+    // items:      as per Figure
+    Enumerate(const Figure::Coords                             &box     ,
+              const unsigned                                    cubicles,
+              const unsigned                                    rules   ,
+              const std::vector<std::vector<std::vector<Figure::Coords>>>
+                                                               &items   );
+
+    // Call visit(figure) for each solvable figure, figure's cubicles
+    //   in box cell order (so numbered 0 upward), until visit()
+    //   returns false. False if stopped by visit().
+    template<typename Visit>
+    bool    run(Visit   visit)
+    {
+        _candidates = 0;
+        _solvable   = 0;
+
+        return extend(0, 0, 0, visit);
+    }
+
+    // Statistics from last run(): figures meeting rules, and how many
+    //   of those solvable
+    uint64_t    candidates() const { return _candidates; }
+    uint64_t    solvable  () const { return _solvable  ; }
+
+
+
+  protected:
+    // Whether complete figure (bitmask of box cells) is a candidate,
+    //   see enumerate.cxx
+    bool        accept(const uint64_t   cells) const;
+
+    template<typename Visit>
+    bool        extend(const unsigned   cell    ,
+                       const unsigned   included,
+                       const uint64_t   cells   ,
+                             Visit     &visit   )
+    {
+        if (included == _cubicles) {
+            if (!accept(cells))
+                return true;
+
+            ++_candidates;
+
+            if (!_figure.solvable())
+                return true;
+
+            ++_solvable;
+
+            return visit(static_cast<const Figure&>(_figure));
+        }
+
+        if (_cells - cell < _cubicles - included)
+            return true;
+
+        const uint64_t  bit = 1ull << cell;
+
+        if (!(_rules & SUPPORTED) || _below[cell] < 0
+                                  || (cells & (1ull << _below[cell]))) {
+            _figure.add(_coords[cell]);
+            const bool  more = extend(cell + 1    ,
+                                      included + 1,
+                                      cells | bit ,
+                                      visit       );
+            _figure.remove(_coords[cell]);
+            if (!more)
+                return false;
+        }
+
+        return extend(cell + 1, included, cells, visit);
+    }
+
+    unsigned                                    _cells     ,  // in box
+                                                _cubicles  ,
+                                                _rules     ;
+    std::vector<Figure::Coords>                 _coords    ;  // per cell
+    std::vector<int>                            _below     ;  // cell or -1
+    std::vector<uint64_t>                       _adjacent  ;  //  "   mask
+    std::array<uint64_t, 6>                     _faces     ;  // of box
+
+    // Per rotation/reflection of box onto itself, other than identity,
+    //   image of each cell
+    std::vector<std::array<uint8_t, MAX_CELLS>> _symmetries;
+
+    Figure                                      _figure    ;
+    uint64_t                                    _candidates,
+                                                _solvable  ;
+
+};  // class Enumerate
+
+}  // namespace soma
+
+#endif  // #ifndef ENUMERATE_HXX
@@ -0,0 +1,329 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#include <algorithm>
+#include <set>
+#include <unordered_set>
+
+#include "cover.hxx"
+#include "figure.hxx"
+
+
+
+namespace {
+
+const soma::Figure::Coords  ORTHOGONALS[] = {{{ 1,  0,  0}},
+                                             {{-1,  0,  0}},
+                                             {{ 0,  1,  0}},
+                                             {{ 0, -1,  0}},
+                                             {{ 0,  0,  1}},
+                                             {{ 0,  0, -1}}};
+
+soma::Figure::Coords operator+(
+const soma::Figure::Coords  &augend,
+const soma::Figure::Coords  &addend)
+{
+    return {{augend[0] + addend[0],
+             augend[1] + addend[1],
+             augend[2] + addend[2]}};
+}
+
+soma::Figure::Coords operator-(
+const soma::Figure::Coords  &minuend   ,
+const soma::Figure::Coords  &subtrahend)
+{
+    return {{minuend[0] - subtrahend[0],
+             minuend[1] - subtrahend[1],
+             minuend[2] - subtrahend[2]}};
+}
+
+}  // namespace
+
+
+
+namespace soma {
+
+// See figure.hxx
+Figure::Figure(
+const std::vector<Coords>                                &cubicles,
+const std::vector<std::pair<Coords, char>>               &fixed   ,
+const std::vector<std::vector<std::vector<Coords>>>      &items   )
+:   _placements(items.size()),
+    _labels    (fixed       ),
+    _cells     (0           )
+{
+    // Orientations relative to least cube, so that ones equal as sets
+    //   of cubes (e.g. given relative to different cubes) are merged
+    for (const std::vector<std::vector<Coords>> &item : items) {
+        std::set<std::vector<Coords>>   orientations;
+
+        for (std::vector<Coords> cubes : item) {
+            std::sort(cubes.begin(), cubes.end());
+            const Coords    least = cubes.front();
+            for (Coords &cube : cubes)
+                cube = cube - least;
+            orientations.insert(cubes);
+        }
+
+        _items.emplace_back(orientations.begin(), orientations.end());
+    }
+
+    for (const std::pair<Coords, char> &label : fixed)
+        _fixed[key(label.first)] = label.second;
+
+    // Each placement generated once, when last of its cubicles added
+    for (const Coords &cubicle : cubicles)
+        add(cubicle);
+
+}  // Figure(const std::vector<Coords>&, ...)
+
+
+
+// See figure.hxx
+bool Figure::add(
+const Coords    &position)
+{
+    const uint32_t  code = key(position);
+
+    if (   _cells == UINT32_MAX
+        || _cubicles.count(code)
+        || _fixed   .count(code))
+        return false;
+
+    const unsigned  cubicle = __builtin_ctz(~_cells);
+
+    _coords  [cubicle]  = position;
+    _cubicles[code   ]  = cubicle ;
+    _cells             |= 1u << cubicle;
+
+    generate(cubicle);
+
+    return true;
+
+}  // add(const Coords&)
+
+
+
+// See figure.hxx
+bool Figure::remove(
+const Coords    &position)
+{
+    const int   cubicle = find(position);
+
+    if (cubicle < 0)
+        return false;
+
+    const uint32_t  bit = 1u << cubicle;
+
+    for (std::vector<uint32_t> &placements : _placements)
+        placements.erase(std::remove_if(placements.begin(),
+                                        placements.end  (),
+                                        [bit](const uint32_t mask)
+                                        { return mask & bit; }),
+                         placements.end());
+
+    _cubicles.erase(key(position));
+    _cells &= ~bit;
+
+    return true;
+
+}  // remove(const Coords&)
+
+
+
+// See figure.hxx
+bool Figure::move(
+const Coords    &from,
+const Coords    &to  )
+{
+    const uint32_t  code = key(to);
+
+    if (find(from) < 0 || _cubicles.count(code) || _fixed.count(code))
+        return false;
+
+    remove(from);
+    add   (to  );
+
+    return true;
+
+}  // move(const Coords&, const Coords&)
+
+
+
+// See figure.hxx
+int Figure::find(
+const Coords    &position)
+const
+{
+    const std::unordered_map<uint32_t, unsigned>::const_iterator
+                    found = _cubicles.find(key(position));
+
+    return found == _cubicles.end() ? -1 : static_cast<int>(found->second);
+
+}  // find(const Coords&) const
+
+
+
+// See figure.hxx
+void Figure::frontier(
+std::vector<Coords>     &positions)
+const
+{
+    std::unordered_set<uint32_t>    seen;
+
+    positions.clear();
+
+    auto    neighbors = [&](const Coords &occupied)
+    {
+        for (const Coords &direction : ORTHOGONALS) {
+            const Coords    position = occupied + direction;
+            const uint32_t  code     = key(position);
+
+            if (   !_cubicles.count(code)
+                && !_fixed   .count(code)
+                && seen.insert(code).second)
+                positions.push_back(position);
+        }
+    };
+
+    for (uint32_t bits = _cells ; bits ; bits &= bits - 1)
+        neighbors(_coords[__builtin_ctz(bits)]);
+
+    for (const std::pair<Coords, char> &label : _labels)
+        neighbors(label.first);
+
+}  // frontier(std::vector<Coords>&) const
+
+
+
+// See figure.hxx
+std::string Figure::canonical()
+const
+{
+    std::vector<std::pair<Coords, char>>    occupied(_labels);
+    std::string                             least           ;
+
+    for (uint32_t bits = _cells ; bits ; bits &= bits - 1)
+        occupied.emplace_back(_coords[__builtin_ctz(bits)], 'o');
+
+    // 6 axis permutations times 8 sign combinations
+    std::array<unsigned, 3>     axes{{0, 1, 2}};
+    do
+        for (unsigned signs = 0 ; signs < 8 ; ++signs) {
+            std::vector<std::pair<Coords, char>>    image;
+            Coords                                  lows{{INT32_MAX,
+                                                          INT32_MAX,
+                                                          INT32_MAX}};
+
+            for (const std::pair<Coords, char> &cubicle : occupied) {
+                Coords  position;
+                for (unsigned axis = 0 ; axis < 3 ; ++axis) {
+                    position[axis] =   signs & (1 << axis)
+                                     ? -cubicle.first[axes[axis]]
+                                     :  cubicle.first[axes[axis]];
+                    lows[axis] = std::min(lows[axis], position[axis]);
+                }
+                image.emplace_back(position, cubicle.second);
+            }
+
+            for (std::pair<Coords, char> &cubicle : image)
+                cubicle.first = cubicle.first - lows;
+            std::sort(image.begin(), image.end());
+
+            std::string     text;
+            for (const std::pair<Coords, char> &cubicle : image) {
+                text += static_cast<char>(cubicle.first[0]);
+                text += static_cast<char>(cubicle.first[1]);
+                text += static_cast<char>(cubicle.first[2]);
+                text += cubicle.second;
+            }
+
+            if (least.empty() || text < least)
+                least = text;
+        }
+    while (std::next_permutation(axes.begin(), axes.end()));
+
+    return least;
+
+}  // canonical() const
+
+
+
+// See figure.hxx
+bool Figure::solvable(
+const uint64_t  seed)
+const
+{
+    unsigned    cubes   = 0;
+    uint32_t    covered = 0;
+
+    // Quick rejections before search
+    for (unsigned item = 0 ; item < _items.size() ; ++item) {
+        if (_placements[item].empty())
+            return false;
+
+        cubes += _items[item].front().size();
+        for (const uint32_t placement : _placements[item])
+            covered |= placement;
+    }
+
+    if (   cubes   != static_cast<unsigned>(__builtin_popcount(_cells))
+        || covered != _cells                                           )
+        return false;
+
+    Cover                   cover(_cells, _placements);
+    std::vector<unsigned>   chosen;
+
+    return cover.solve(seed, chosen);
+
+}  // solvable(const uint64_t) const
+
+
+
+// Add placements of each item with one of its cubes at cubicle and
+//   all others at cubicles already in figure
+//
+void Figure::generate(
+const unsigned  cubicle)
+{
+    const Coords    &position = _coords[cubicle];
+
+    for (unsigned item = 0 ; item < _items.size() ; ++item)
+        for (const std::vector<Coords> &orientation : _items[item])
+            for (const Coords &anchor : orientation) {
+                const Coords    origin = position - anchor;
+                uint32_t        mask   = 0;
+
+                for (const Coords &cube : orientation) {
+                    const int   found = find(origin + cube);
+                    if (found < 0) {
+                        mask = 0;
+                        break;
+                    }
+                    mask |= 1u << found;
+                }
+
+                if (mask)
+                    _placements[item].push_back(mask);
+            }
+
+}  // generate(const unsigned)
+
+}  // namespace soma
@@ -0,0 +1,120 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef FIGURE_HXX
+#define FIGURE_HXX
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+
+namespace soma {
+
+// Editable figure: up to 32 cubicles at integer coordinates, to be
+//   covered by one placement of each of up to 8 items (pieces), plus
+//   fixed cubicles (e.g. pre-placed pieces') that are occupied but
+//   not covered. Every placement (bitmask of cubicles) of each item
+//   is kept up to date as cubicles are added, removed, or moved one
+//   at a time: only placements through the changed cubicle are
+//   dropped or generated, instead of rebuilding adjacency and valid
+//   orientations of whole figure as Soma::read() does.
+// Cubicles keep their index (bit in masks) while in figure, and
+//   removed ones' indices are reused.
+// Independent of Shape/Piece search. Used by Soma::near_misses().
+//
+class Figure {
+  public:
+    static const unsigned   MAX_CUBICLES = 32,
+                            MAX_ITEMS    =  8;
+
+    typedef std::array<int, 3>      Coords;
+
+    // cubicles:  to be covered
+    // fixed:     occupied but not covered, each with label (e.g.
+    //            Piece::name()) for canonical()
+    // items:     per item, its orientations, each its cubes'
+    //            coordinates relative to any one of them
+    Figure(const std::vector<Coords>                         &cubicles,
+           const std::vector<std::pair<Coords, char>>        &fixed   ,
+           const std::vector<std::vector<std::vector<Coords>>>
+                                                             &items   );
+
+    // False, leaving figure unchanged, if position is occupied (or
+    //   MAX_CUBICLES already), or for remove() isn't a cubicle (fixed
+    //   ones can't be removed), or for move() either
+    bool        add   (const Coords &position);
+    bool        remove(const Coords &position);
+    bool        move  (const Coords &from    ,
+                       const Coords &to      );
+
+    // Bitmask of cubicles' indices
+    uint32_t    cells () const { return _cells; }
+
+    // Index of cubicle at position, or -1 if none
+    int         find  (const Coords &position) const;
+
+    Coords      coords(const unsigned cubicle) const
+                { return _coords[cubicle]; }
+
+    // Per item, bitmasks of its placements, in no particular order
+    const std::vector<std::vector<uint32_t>>   &placements() const
+                                                { return _placements; }
+
+    // Unoccupied positions orthogonally adjacent to any cubicle or
+    //   fixed one
+    void        frontier(std::vector<Coords> &positions) const;
+
+    // Same for figures (including fixed cubicles' labels) equal under
+    //   some translation, rotation, and/or reflection
+    std::string canonical() const;
+
+    // Whether items have an exact cover of cubicles, see Cover
+    bool        solvable(const uint64_t seed = 1) const;
+
+
+
+  protected:
+    static uint32_t key(const Coords &position)
+    {
+        return   static_cast<uint32_t>(position[0] + 512) << 20
+               | static_cast<uint32_t>(position[1] + 512) << 10
+               | static_cast<uint32_t>(position[2] + 512);
+    }
+
+    void        generate(const unsigned cubicle);
+
+    std::vector<std::vector<std::vector<Coords>>>   _items     ;
+    std::vector<std::vector<uint32_t>>              _placements;
+    std::array<Coords, MAX_CUBICLES>                _coords    ;
+    std::unordered_map<uint32_t, unsigned>          _cubicles  ;  // key()
+    std::unordered_map<uint32_t, char    >          _fixed     ;  //  "
+    std::vector<std::pair<Coords, char>>            _labels    ;  // fixed
+    uint32_t                                        _cells     ;
+
+};  // class Figure
+
+}  // namespace soma
+
+#endif  // #ifndef FIGURE_HXX
@@ -0,0 +1,276 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#include <algorithm>
+#include <cmath>
+
+#include "join.hxx"
+
+
+
+namespace soma {
+
+// See join.hxx
+Join::Join(
+const uint32_t                               cells    ,
+const std::vector<std::vector<uint32_t>>    &items    ,
+const std::vector<uint32_t>                 &adjacents,
+const unsigned                               pos      ,
+const unsigned                               neg      )
+:   _cells    (cells    ),
+    _items    (items    ),
+    _adjacents(adjacents),
+    _pos     (pos  ),
+    _neg     (neg  ),
+    _total   (0    ),
+    _tabled  (0    ),
+    _streamed(0    )
+{
+    // Sorted for fixed(), and in case any duplicates
+    for (std::vector<uint32_t> &placements : _items) {
+        std::sort(placements.begin(), placements.end());
+        placements.erase(std::unique(placements.begin(), placements.end()),
+                         placements.end()                                 );
+    }
+
+}  // Join(...)
+
+
+
+// See join.hxx
+uint64_t Join::count()
+{
+    return join(_items);
+
+}  // count()
+
+
+
+// See join.hxx
+uint64_t Join::fixed(
+const Image &image   ,
+const bool   mirrored)
+{
+    std::vector<std::vector<uint32_t>>  items;
+
+    // Each item's placement must map to itself, except if mirrored
+    //   "p" and "n" ones must map to each other, so are combined into
+    //   one item
+    for (unsigned item = 0 ; item < _items.size() ; ++item) {
+        if (mirrored && item == _neg)
+            continue;
+
+        items.emplace_back();
+
+        for (const uint32_t placement : _items[item]) {
+            const uint32_t  image_cells = map(placement, image);
+
+            if (!mirrored || item != _pos) {
+                if (image_cells == placement)
+                    items.back().push_back(placement);
+                continue;
+            }
+
+            if (   !(image_cells & placement)
+                && map(image_cells, image) == placement
+                && std::binary_search(_items[_neg].begin(),
+                                      _items[_neg].end  (),
+                                      image_cells         ))
+                items.back().push_back(placement | image_cells);
+        }
+    }
+
+    return join(items);
+
+}  // fixed(const Image&, const bool)
+
+
+
+// See join.hxx
+uint64_t Join::unique(
+const std::vector<Image>    &images  ,
+const std::vector<bool>     &mirrored)
+{
+    uint64_t    sum = 0;
+
+    for (unsigned ndx = 0 ; ndx < images.size() ; ++ndx)
+        sum += fixed(images[ndx], mirrored[ndx]);
+
+    return images.empty() ? 0 : sum / images.size();
+
+}  // unique(const std::vector<Image>&, const std::vector<bool>&)
+
+
+
+// Split items into two groups with most nearly equal numbers of
+//   combinations (product of numbers of placements), table one
+//   group's, and stream the other's against the table
+//
+uint64_t Join::join(
+const std::vector<std::vector<uint32_t>>    &items)
+{
+    const unsigned  num_items = items.size();
+
+    for (const std::vector<uint32_t> &placements : items)
+        if (placements.empty())
+            return 0;
+
+    unsigned    best_split   = 0      ;
+    double      best_largest = INFINITY;
+
+    for (unsigned split = 0 ; split < (1u << num_items) ; ++split) {
+        const unsigned  size = __builtin_popcount(split);
+        if (size != num_items / 2 && size != (num_items + 1) / 2)
+            continue;
+
+        double  in_split  = 0.0,
+                out_split = 0.0;
+        for (unsigned item = 0 ; item < num_items ; ++item)
+            if (split & (1 << item))
+                in_split  += std::log(items[item].size());
+            else
+                out_split += std::log(items[item].size());
+
+        // Table is in-split group. Larger estimate usually has more
+        //   overlaps so fewer actual combinations, and inserting
+        //   into table is slower than probing it.
+        if (in_split >= out_split && in_split < best_largest) {
+            best_split   = split   ;
+            best_largest = in_split;
+        }
+    }
+
+    std::vector<unsigned>   tabled  ,
+                            streamed;
+    for (unsigned item = 0 ; item < num_items ; ++item)
+        if (best_split & (1 << item))
+            tabled  .push_back(item);
+        else
+            streamed.push_back(item);
+
+    _table.clear();
+    _total    = 0;
+    _tabled   = 0;
+    _streamed = 0;
+
+    table(items, tabled  , 0, 0);
+    probe(items, streamed, 0, 0);
+
+    _table.clear();
+
+    return _total;
+
+}  // join(const std::vector<std::vector<uint32_t>>&)
+
+
+
+void Join::table(
+const std::vector<std::vector<uint32_t>>    &items ,
+const std::vector<unsigned>                 &group ,
+const unsigned                               member,
+const uint32_t                               cells )
+{
+    if (member == group.size()) {
+        ++_table[cells];
+        ++_tabled;
+        return;
+    }
+
+    for (const uint32_t placement : items[group[member]])
+        if (!(placement & cells) && !orphans(cells | placement, placement))
+            table(items, group, member + 1, cells | placement);
+
+}  // table(...)
+
+
+
+void Join::probe(
+const std::vector<std::vector<uint32_t>>    &items ,
+const std::vector<unsigned>                 &group ,
+const unsigned                               member,
+const uint32_t                               cells )
+{
+    if (member == group.size()) {
+        const std::unordered_map<uint32_t, uint64_t>::const_iterator
+                found = _table.find(_cells & ~cells);
+
+        ++_streamed;
+        if (found != _table.end())
+            _total += found->second;
+        return;
+    }
+
+    for (const uint32_t placement : items[group[member]])
+        if (!(placement & cells) && !orphans(cells | placement, placement))
+            probe(items, group, member + 1, cells | placement);
+
+}  // probe(...)
+
+
+
+// True if any uncovered cell next to placement is in region of one
+//   or two uncovered cells, which no item can cover
+//
+bool Join::orphans(
+const uint32_t  covered  ,
+const uint32_t  placement)
+const
+{
+    uint32_t    next = 0;
+    for (uint32_t bits = placement ; bits ; bits &= bits - 1)
+        next |= _adjacents[__builtin_ctz(bits)];
+    next &= _cells & ~covered;
+
+    for (uint32_t bits = next ; bits ; bits &= bits - 1) {
+        const unsigned  cell = __builtin_ctz(bits);
+        const uint32_t  free = _adjacents[cell] & _cells & ~covered;
+
+        if (!free)
+            return true;
+
+        if (   !(free & (free - 1))  // only one
+            && !(  _adjacents[__builtin_ctz(free)]
+                 & _cells
+                 & ~covered
+                 & ~(1u << cell)                  ))
+            return true;
+    }
+
+    return false;
+
+}  // orphans(const uint32_t, const uint32_t) const
+
+
+
+// Bitmask of images of cells
+uint32_t Join::map(
+const uint32_t   cells,
+const Image     &image)
+{
+    uint32_t    mapped = 0;
+
+    for (uint32_t bits = cells ; bits ; bits &= bits - 1)
+        mapped |= 1 << image[__builtin_ctz(bits)];
+
+    return mapped;
+
+}  // map(const uint32_t, const Image&)
+
+}  // namespace soma
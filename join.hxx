@@ -0,0 +1,119 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef JOIN_HXX
+#define JOIN_HXX
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+
+namespace soma {
+
+// Counts exact covers of up to 32 cells by one placement (bitmask of
+//   cells) from each of up to 8 items (pieces), meet-in-the-middle:
+//   all non-overlapping combinations of placements of one group of
+//   items (without one- or two-cell uncovered holes) are tabled by
+//   cells covered, then each combination of the other group's is
+//   joined with the table entry for the complementary cells. Time
+//   proportional to number of partial covers by either group, not to
+//   number of full covers.
+// Independent of Shape/Piece search in Soma::solve(). Used for
+//   counting solutions (Soma::join_count()).
+//
+class Join {
+  public:
+    static const unsigned   MAX_ITEMS = 8;
+
+    // Cells to cells
+    typedef std::array<uint8_t, 32>     Image;
+
+    // cells:      bitmask of cells to be covered
+    // items:      per item, all its candidate placements
+    // adjacents:  per cell, bitmask of orthogonally adjacent cells
+    // pos, neg:   mutually mirrored items ("p" and "n" pieces)
+    Join(const uint32_t                                 cells    ,
+         const std::vector<std::vector<uint32_t>>      &items    ,
+         const std::vector<uint32_t>                   &adjacents,
+         const unsigned                                 pos      ,
+         const unsigned                                 neg      );
+
+    // Number of covers
+    uint64_t    count();
+
+    // Number of covers mapped to themselves by image, exchanging pos
+    //   and neg items if mirrored
+    uint64_t    fixed(const Image   &image   ,
+                      const bool     mirrored);
+
+    // Number of covers unique under group of images (each with
+    //   corresponding mirrored flag, identity included), by Burnside's
+    //   lemma: average of fixed() over group
+    uint64_t    unique(const std::vector<Image>    &images  ,
+                       const std::vector<bool>     &mirrored);
+
+    // Statistics from last count(), fixed(), or unique()
+    uint64_t    tabled  () const { return _tabled  ; }
+    uint64_t    streamed() const { return _streamed; }
+
+
+
+  protected:
+    // Covers of _cells by one placement from each of items
+    uint64_t    join (const std::vector<std::vector<uint32_t>>  &items);
+
+    // Recursively all non-overlapping combinations of one placement
+    //   from each of items[group[0..]], either tabling or joining them
+    void        table(const std::vector<std::vector<uint32_t>>  &items ,
+                      const std::vector<unsigned>               &group ,
+                      const unsigned                             member,
+                      const uint32_t                             cells );
+    void        probe(const std::vector<std::vector<uint32_t>>  &items ,
+                      const std::vector<unsigned>               &group ,
+                      const unsigned                             member,
+                      const uint32_t                             cells );
+
+    bool        orphans(const uint32_t  covered  ,
+                        const uint32_t  placement) const;
+
+    static uint32_t map(const uint32_t   cells,
+                        const Image     &image);
+
+    uint32_t                                _cells    ;
+    std::vector<std::vector<uint32_t>>      _items    ;
+    const std::vector<uint32_t>            &_adjacents;
+    const unsigned                          _pos      ,
+                                            _neg      ;
+
+    // Cells covered by combination of tabled group, to number of them
+    std::unordered_map<uint32_t, uint64_t>  _table    ;
+
+    uint64_t                                _total    ,
+                                            _tabled   ,
+                                            _streamed ;
+
+};  // class Join
+
+}  // namespace soma
+
+#endif  // #ifndef JOIN_HXX
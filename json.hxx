@@ -0,0 +1,53 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef JSON_HXX
+#define JSON_HXX
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+
+
+namespace soma {
+
+// JSON string contents (without surrounding quotes), escaping quote,
+//   backslash, and control characters so any filename or name is valid
+inline void write_json_escaped(
+std::ostream        &output,
+const std::string   &string)
+{
+    for (const char letter : string) {
+        if (letter == '"' || letter == '\\')
+            output << '\\' << letter;
+        else if (static_cast<unsigned char>(letter) < 0x20) {
+            char    escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", letter);
+            output << escaped;
+        }
+        else
+            output << letter;
+    }
+}
+
+}  // namespace soma
+
+#endif  // #ifndef JSON_HXX
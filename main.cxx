@@ -34,6 +34,10 @@
 
 
 
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <functional>
 #include <getopt.h>
@@ -44,7 +48,9 @@
 #include <string>
 #include <sys/time.h>
 
+#include "json.hxx"
 #include "soma.hxx"
+#include "trace.hxx"
 
 
 
@@ -69,23 +75,108 @@ static const char   *DEFAULT_ORPHANS_CHARS    = "123456",
                     *DEFAULT_SYMMETRIES_CHARS = "0"     ;
 
 
+// Checkpoint/resume and per-figure deadline settings
+// See BRIEF_HELP_TEXT
+struct Limits {
+    std::string     checkpoint_filename,  // "" if not checkpointing
+                    resume_filename    ;  // "" if not resuming
+    double          checkpoint_interval,  // seconds
+                    deadline           ;  // seconds per figure, 0 if none
+};
+
+// Solution numbering (-k, --sample, --unrank), see Soma::ranked()
+// See BRIEF_HELP_TEXT
+struct Ranking {
+    bool            count  ;  // -k: count by Soma::ranked() if count_only
+    unsigned        samples;  // --sample, 0 if not sampling
+    uint64_t        seed   ;  //    "     random seed
+    uint64_t        number ;  // --unrank, from 1, 0 if not unranking
+};
+
+// One configuration of --sweep, see read_sweep()
+struct Sweep {
+    std::string     options          ;  // as in file, for results
+    unsigned        orphans          ,  // -O
+                    duplicates       ,  // -D
+                    symmetries       ;  // -S
+    std::string     piece_order      ;  // -P
+    bool            symmetry_breaking,  // -b
+                    forward_checking ;  // -F
+};
+
+// One --hint script command, see read_hints()
+struct Hint {
+    std::string     text     ;  // as in file, for output
+    char            command  ;  // 'c'ount, 'm'oves, 'p'lace, or 'u'ndo
+    char            piece    ;  // place: Piece::name()
+    unsigned        placement;  //   "    Piece::placements() number
+};
+
+// Per-figure settings for solve()
+// See BRIEF_HELP_TEXT
+struct Options {
+    bool                print_name       ,  // -n
+                        count_only       ,  // -c
+                        existence        ,  // -x: Soma::exists() not solve()
+                        decompose        ,  // -d: Soma::count() if count_only
+                        join             ,  // -m: Soma::join_count()  "
+                        explain          ,  // -i: print Soma::infeasibility()
+                        all_solutions    ,  // -a (or -c)
+                        print_time       ,  // -t
+                        marginals        ,  // --marginals instead of solving
+                        near_miss        ;  // --near-miss   "     "     "
+    std::string         diagram_directory,  // --zdd, "" if not writing
+                        read_directory   ,  // --read-zdd, print_diagram()
+                                            //   instead if not ""
+                        store_directory  ,  // --store, "" if not writing
+                        query_expression ;  // --query, "" if none
+    std::vector<Hint>   hints            ;  // --hint, print_hints() instead
+                                            //   if any
+    unsigned            estimate_probes  ;  // -e, 0 if not estimating
+    uint64_t            estimate_seed    ;  //  "
+    unsigned            progress_probes  ;  // --progress, 0 if not
+    uint64_t            progress_seed    ;  //   reporting
+    Ranking             ranking          ;  // -k, --sample, --unrank
+    Limits              limits           ;  // checkpoint/resume and deadline
+    std::ostream       *counters_output  ;  // -j, null if not writing
+};
+
+// Figure enumeration (--catalog), see Soma::enumerate()
+// See BRIEF_HELP_TEXT
+struct Catalog {
+    std::array<unsigned, 3>     box  ;  // x, y, z sizes, all 0 if none
+    unsigned                    rules;  // Enumerate::SUPPORTED, etc
+};
+
+// Set by SIGINT/SIGTERM handler if checkpointing, polled by Soma::solve(),
+//   then STOPPED by solve() once checkpoint written and batch should end
+enum { STOP_REQUESTED = 1, STOPPED = 2 };
+volatile std::sig_atomic_t                  stop_requested = 0;
+
+// Across figures, so periodic even if batch of many small figures
+std::chrono::steady_clock::time_point       next_checkpoint   ;
+
+
 // see implementations, below
 //
 int         parse_arguments (      int               argc            ,
                                    char             *argv[]          ,
                                    std::string      &output_filename ,
-                                   bool             &all_solutions   ,
                                    bool             &reflects_rotates,
                                    unsigned         &orphans         ,
                                    unsigned         &duplicates      ,
                                    unsigned         &symmetries      ,
                                    std::string      &piece_order     ,
-#ifdef SOMA_STATISTICS
-                                   bool             &statistics      ,
-#endif
-                                   bool             &print_time      ,
-                                   bool             &count_only      ,
-                                   bool             &print_name      );
+                                   std::string      &pair_anchored   ,
+                                   bool             &symmetry_breaking,
+                                   bool             &forward_checking,
+                                   Engine           &engine          ,
+                                   std::string      &counters_filename,
+                                   std::string      &trace_filename  ,
+                                   Catalog          &catalog         ,
+                                   std::string      &sweep_filename  ,
+                                   std::string      &hint_filename   ,
+                                   Options          &options         );
 
 bool        parse_steps     (      unsigned         &steps           ,
                              const std::string      &string          ,
@@ -100,23 +191,109 @@ bool        read_pieces_file(      Soma             &soma            ,
 double      solve           (const std::string      &input_filename  ,
                                    Soma             &soma            ,
                                    std::ostream     &output          ,
-                                   bool              print_name      ,
-                                   bool              count_only      ,
-                                   bool              all_solutions   ,
-#ifdef SOMA_STATISTICS
-                                   unsigned         &total_solutions ,
-#endif
-                                   bool             print_time       );
-
-#ifdef SOMA_STATISTICS
+                             const Options          &options         ,
+                                   uint64_t         &total_solutions ,
+                                   std::istream     *resume_input    ,
+                                   uint64_t          resume_solutions);
+
+void        write_checkpoint(const Soma             &soma            ,
+                             const Limits           &limits          ,
+                             const std::string      &input_filename  ,
+                                   uint64_t          num_solutions   ,
+                                   bool              done            );
+
+void        request_stop    (      int               signal_number   );
+
 void        print_statistics(      Soma             &soma            ,
                                    unsigned          number_of_solves,
-                                   unsigned          total_solutions );
-#endif
+                                   uint64_t          total_solutions );
 
 void        print_api       (const Soma             &soma            ,
                                    std::ostream     &output          );
 
+void        print_counters  (const Soma             &soma            ,
+                             const std::string      &input_filename  ,
+                                   uint64_t          num_solutions   ,
+                                   std::ostream     &output          );
+
+void        print_estimate  (const Soma::Estimate   &estimate        ,
+                             const std::string      &input_filename  ,
+                                   std::ostream     &output          );
+
+void        print_progress  (const Soma::Estimate   &estimate        ,
+                             const std::string      &input_filename  ,
+                                   uint64_t          num_solutions   ,
+                                   double            elapsed         );
+
+void        print_ranked    (      Soma             &soma            ,
+                             const Ranking          &ranking         ,
+                             const std::string      &input_filename  ,
+                                   std::ostream     &output          );
+
+std::string output_path     (const std::string      &directory       ,
+                             const std::string      &input_filename  ,
+                             const std::string      &extension       );
+
+bool        write_diagram   (      Soma             &soma            ,
+                             const std::string      &directory       ,
+                             const std::string      &input_filename  ,
+                                   std::ostream     &output          ,
+                                   uint64_t         &count           );
+
+void        print_diagram   (      Soma             &soma            ,
+                             const std::string      &directory       ,
+                             const std::string      &expression      ,
+                             const Ranking          &ranking         ,
+                             const std::string      &input_filename  ,
+                                   std::ostream     &output          );
+
+void        write_store     (      Soma             &soma            ,
+                             const std::string      &directory       ,
+                             const std::string      &input_filename  ,
+                             const std::vector<Rank::Cover>
+                                                    &solutions       ,
+                                   std::ostream     &output          );
+
+void        print_marginals (      Soma             &soma            ,
+                             const std::string      &input_filename  ,
+                                   std::ostream     &output          );
+
+void        print_near_misses(     Soma             &soma            ,
+                             const std::string      &input_filename  ,
+                                   std::ostream     &output          );
+
+double      query_store     (const std::string      &input_filename  ,
+                             const std::string      &expression      ,
+                                   bool              list            ,
+                                   std::ostream     &output          );
+
+double      write_catalog   (      Soma             &soma            ,
+                             const Catalog          &catalog         ,
+                                   std::ostream     &output          );
+
+bool        read_hints      (const std::string      &filename        ,
+                                   std::vector<Hint>
+                                                    &hints           );
+
+void        print_hints     (      Soma             &soma            ,
+                             const std::vector<Hint>
+                                                    &hints           ,
+                             const std::string      &input_filename  ,
+                                   std::ostream     &output          );
+
+bool        read_sweep      (const std::string      &filename        ,
+                             const Sweep            &defaults        ,
+                                   std::vector<Sweep>
+                                                    &sweeps          );
+
+double      sweep           (const std::vector<std::string>
+                                                    &input_filenames ,
+                                   Soma             &soma            ,
+                             const std::vector<Sweep>
+                                                    &sweeps          ,
+                                   bool              print_time      ,
+                                   std::ostream     &output          );
+
 }  // namespace
 
 
@@ -125,41 +302,66 @@ int main(
 int     argc  ,
 char    **argv)
 {
-    bool            all_solutions   ,   // true: all      false: first solution
-                    reflects_rotates,   // true: include  false: only uniques
-#ifdef SOMA_STATISTICS
-                    statistics      ,   // report solution algorithm info
-#endif
-                    print_time      ,   // time to solve all on commandline
-                    count_only      ,   // do not print actual solutions
-                    print_name      ;   // print filename before each solution
+    bool            reflects_rotates;   // true: include  false: only uniques
     unsigned        orphans         ,   // see EXTENDED_HELP_TEXT
                     duplicates      ,   //  "          "
                     symmetries      ;   //  "          "
-    std::string     piece_order     ;   //  "          "
+    std::string     piece_order     ,   //  "          "
+                    pair_anchored   ;   //  "          "
+    bool            symmetry_breaking;  //  "          "
+    bool            forward_checking;   //  "          "
+    Engine          engine          ;   //  "          "
     int             first_filename  ;   // index into argv
+    Catalog         catalog         ;   // --catalog instead of files
+    std::vector<Sweep>  sweeps      ;   // --sweep configurations, if any
+    Options         options         ;   // for solve()
     std::string     input_filename  ,
-                    output_filename ;
+                    output_filename ,
+                    counters_filename,  // "" if not writing search counters
+                    trace_filename  ,   // "" if not writing trace timeline
+                    sweep_filename  ,   // "" unless --sweep
+                    hint_filename   ;   // "" unless --hint
 
     if (    (first_filename = parse_arguments(argc            ,
                                               argv            ,
                                               output_filename ,
-                                              all_solutions   ,
                                               reflects_rotates,
                                               orphans         ,
                                               duplicates      ,
                                               symmetries      ,
                                               piece_order     ,
-#ifdef SOMA_STATISTICS
-                                              statistics      ,
-#endif
-                                              print_time      ,
-                                              count_only      ,
-                                              print_name      ))
+                                              pair_anchored   ,
+                                              symmetry_breaking,
+                                              forward_checking,
+                                              engine          ,
+                                              counters_filename,
+                                              trace_filename  ,
+                                              catalog         ,
+                                              sweep_filename  ,
+                                              hint_filename   ,
+                                              options         ))
         == -1                                                   )
         // error details already printed to stderr by parse_arguments()
         return 1;   // arbitrary non-zero shell error code
 
+    if (!sweep_filename.empty()) {
+        const Sweep     defaults{"",
+                                 orphans          ,
+                                 duplicates       ,
+                                 symmetries       ,
+                                 piece_order      ,
+                                 symmetry_breaking,
+                                 forward_checking };
+
+        if (!read_sweep(sweep_filename, defaults, sweeps))
+            // error details already printed to stderr by read_sweep()
+            return 2;   // arbitrary non-zero shell error code
+    }
+
+    if (!hint_filename.empty() && !read_hints(hint_filename, options.hints))
+        // error details already printed to stderr by read_hints()
+        return 2;   // arbitrary non-zero shell error code
+
     // input and output streams
     // use intermediate pointer because can't reassign reference
 
@@ -178,44 +380,174 @@ char    **argv)
     }
     std::ostream &output = *output_ptr;
 
+    std::ofstream   *counters_output = 0;
+    if (!counters_filename.empty()) {
+        counters_output = new std::ofstream(counters_filename);
+
+        if (!*counters_output) {
+            std::cerr << "Can't open file "
+                      << counters_filename
+                      << " for search counters output"
+                      << std::endl;
+            return 2;   // arbitrary non-zero shell error code
+        }
+    }
+
+
+    std::ofstream   *trace_output = 0;
+    if (!trace_filename.empty()) {
+        trace_output = new std::ofstream(trace_filename);
+
+        if (!*trace_output) {
+            std::cerr << "Can't open file "
+                      << trace_filename
+                      << " for trace output"
+                      << std::endl;
+            return 2;   // arbitrary non-zero shell error code
+        }
+
+        Trace::open(trace_output);
+    }
+
 
     // solver engine
     Soma    soma(orphans, duplicates, symmetries, piece_order);
+    soma.pair_anchored(pair_anchored);  // already validated
+    soma.symmetry_breaking(symmetry_breaking);
+    soma.forward_checking (forward_checking );
+    soma.engine           (engine           );
+
+    if (counters_output) {
+        options.counters_output = counters_output;
+        soma.counters(true);
+    }
+
+
+    // resume from checkpoint if requested
+    //
+    std::ifstream   *resume_input     = 0;
+    int              resume_ndx       = -1;  // argv index of figure
+    uint64_t         resume_solutions = 0;
+    if (!options.limits.resume_filename.empty()) {
+        resume_input = new std::ifstream(options.limits.resume_filename);
+
+        std::string     figure, solutions, state;
+        if (   !*resume_input
+            || !std::getline(*resume_input, figure   )
+            || !std::getline(*resume_input, solutions)
+            || !std::getline(*resume_input, state    )
+            || figure   .compare(0, 7, "figure "   ) != 0
+            || solutions.compare(0, 10, "solutions ") != 0
+            || (state != "done" && state != "state")) {
+            std::cerr << "Can't read checkpoint file "
+                      << options.limits.resume_filename
+                      << std::endl;
+            return 2;   // arbitrary non-zero shell error code
+        }
+        figure           = figure.substr(7);
+        resume_solutions = strtoull(solutions.c_str() + 10, 0, 10);
+
+        for (int arg_ndx = first_filename ; arg_ndx < argc ; ++arg_ndx)
+            if (figure == argv[arg_ndx]) {
+                resume_ndx = arg_ndx;
+                break;
+            }
+        if (resume_ndx == -1) {
+            std::cerr << "Checkpoint figure "
+                      << figure
+                      << " not in commandline files"
+                      << std::endl;
+            return 2;   // arbitrary non-zero shell error code
+        }
+
+        // skip figures already solved
+        if (state == "done")
+            first_filename = resume_ndx + 1;
+        else
+            first_filename = resume_ndx;
+
+        // interrupted run stopped before blank space after done figure
+        if (   state == "done"
+            && !options.count_only
+            && !options.print_name
+            && first_filename < argc)
+            output << std::endl;
+    }
+
+    if (!options.limits.checkpoint_filename.empty()) {
+        std::signal(SIGINT , request_stop);
+        std::signal(SIGTERM, request_stop);
+        next_checkpoint =   std::chrono::steady_clock::now()
+                          + std::chrono::duration_cast<
+                              std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double>(
+                                options.limits.checkpoint_interval));
+    }
 
 
     // solve all commandline-specified figures
     //
-    double      elapsed_time    = 0.0;
-#ifdef SOMA_STATISTICS
-    unsigned    total_solutions = 0  ;
-#endif
+    double      elapsed_time    = 0.0  ;
+    uint64_t    total_solutions = 0    ;
+    bool        resume_failed   = false;
+
+    // or generated ones instead
+    if (catalog.box[0]) {
+        elapsed_time  = write_catalog(soma, catalog, output);
+        first_filename = argc;
+    }
+
+    // or each with all --sweep configurations
+    if (!sweeps.empty()) {
+        elapsed_time = sweep(std::vector<std::string>(argv + first_filename,
+                                                      argv + argc          ),
+                             soma                                           ,
+                             sweeps                                         ,
+                             options.print_time                             ,
+                             output                                         );
+        first_filename = argc;
+    }
 
     for (int arg_ndx = first_filename ; arg_ndx < argc ; ++arg_ndx) {
+        if (   !options.query_expression.empty()
+            &&  options.read_directory  .empty()) {
+            elapsed_time += query_store(argv[arg_ndx]           ,
+                                        options.query_expression,
+                                        options.all_solutions   ,
+                                        output                  );
+            continue;
+        }
+
         elapsed_time += solve(argv[arg_ndx]  ,
                               soma           ,
                               output         ,
-                              print_name     ,
-                              count_only     ,
-                              all_solutions  ,
-#ifdef SOMA_STATISTICS
+                              options        ,
                               total_solutions,
-#endif
-                              print_time     );
+                              arg_ndx == resume_ndx ? resume_input     : 0,
+                              arg_ndx == resume_ndx ? resume_solutions : 0);
+
+        if (arg_ndx == resume_ndx && !*resume_input) {
+            resume_failed = true;
+            break;
+        }
+
+        if (stop_requested == STOPPED)
+            break;
 
         // blank spaces between files if necessary
-        if (   !count_only
-            && !print_name
+        if (   !options.count_only
+            && !options.print_name
             && argc - first_filename > 1 && arg_ndx < argc - 1)
             output << std::endl;
     }
 
-    if (print_time) {
+    if (options.print_time) {
         std::cout << elapsed_time
                   << " seconds"
                   << std::endl;
     }
 
-    if (all_solutions) {
+    if (options.all_solutions) {
         // check and warn about potential problems with optimization arguments
 
         if (duplicates != 0 && !(duplicates & 0x40)) {
@@ -228,32 +560,31 @@ char    **argv)
                              "number of solutions."
                           << std::endl;
         }
-
-        std::string     bad_pieces = "";
-        for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx)
-            if (   (symmetries & (1 << ndx))
-                &&    std::string("pnzl").find(piece_order[ndx])
-                   != std::string::npos                               )
-                bad_pieces.append(std::string(1, piece_order[ndx]));
-        if (bad_pieces != "") {
-            std::cerr << "Warning: One or more of \""
-                      << bad_pieces
-                      << "\" in \"-P "
-                      << piece_order
-                      << "\" match \"-S ";
-            for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx)
-                if (symmetries & (1 << ndx))
-                    std::cerr << ndx + 1;
-            std::cerr << "\" symmetry checks. "
-                         "Possible failed or incorrect number of solutions."
-                      << std::endl;
-        }
     }
 
-#ifdef SOMA_STATISTICS
-    if (statistics)
+    if (engine.statistics)
         print_statistics(soma, argc - first_filename, total_solutions);
-#endif
+
+    if (counters_output)
+        delete counters_output;
+
+    if (resume_input)
+        delete resume_input;
+
+    if (trace_output) {
+        Trace::close();
+        delete trace_output;
+    }
+
+    if (resume_failed)
+        return 2;   // arbitrary non-zero shell error code
+
+    if (stop_requested == STOPPED) {
+        std::cerr << "Interrupted, checkpoint written to "
+                  << options.limits.checkpoint_filename
+                  << std::endl;
+        return 3;   // arbitrary non-zero shell error code
+    }
 
     return 0;
 
@@ -266,17 +597,17 @@ namespace {
 //  Solve single SOMA figure
 //
 double solve(
-const std::string   &input_filename,
+const std::string   &input_filename  ,
 Soma                &soma            ,  // solver engine
 std::ostream        &output          ,
-bool                 print_name      ,
-bool                 count_only      ,
-bool                 all_solutions   ,
-#ifdef SOMA_STATISTICS
-unsigned            &total_solutions ,
-#endif
-bool                 print_time      )
+const Options       &options         ,
+uint64_t            &total_solutions ,
+std::istream        *resume_input    ,  // null if not resuming figure,
+                                        //   failed if can't resume
+uint64_t             resume_solutions)  // already found before checkpoint
 {
+    Trace::Span      trace("figure", input_filename);
+
     std::istream    *input_ptr          ;
     bool             is_api_test = false;   // input is special test file format
 
@@ -290,7 +621,7 @@ bool                 print_time      )
                    << input_filename
                    << " for input"
                    << std::endl;
-            if (!count_only)
+            if (!options.count_only)
                 output << std::endl;
             return 0.0;
         }
@@ -311,12 +642,12 @@ bool                 print_time      )
     if (!is_api_test) {
         std::ostringstream      errors;
         if (!soma.read(input, &errors)) {
-            if (print_name)
+            if (options.print_name)
                 output << input_filename
                        << ':'
                        << std::endl;
             output << errors.str();
-            if (!count_only)
+            if (!options.count_only)
                 output << std::endl;
             return 0.0;
         }
@@ -325,29 +656,235 @@ bool                 print_time      )
                                input         ,
                                output        ,
                                input_filename,
-                               print_name    )) {
-        if (!count_only)
+                               options.print_name    )) {
+        if (!options.count_only)
             output << std::endl;
         return 0.0;
     }
 
-    if (print_name && !count_only)
+    // --progress search size, before resume() replaces state
+    const bool      progressing =    options.progress_probes
+                                 && !options.estimate_probes;
+    Soma::Estimate  progress_estimate{};
+    if (progressing)
+        progress_estimate = soma.estimate(options.progress_probes,
+                                          options.progress_seed  );
+
+    if (resume_input) {
+        std::ostringstream      errors;
+        if (!soma.resume(*resume_input, &errors)) {
+            std::cerr << input_filename
+                      << ": can't resume from checkpoint "
+                      << options.limits.resume_filename
+                      << ": "
+                      << errors.str();
+            resume_input->setstate(std::ios::failbit);  // caller exits
+            if (input_ptr != &std::cin)
+                delete input_ptr;
+            return 0.0;
+        }
+    }
+
+    if (options.estimate_probes) {
+        print_estimate(soma.estimate(options.estimate_probes,
+                                     options.estimate_seed  ),
+                       input_filename                         ,
+                       output                                 );
+        if (input_ptr != &std::cin)
+            delete input_ptr;
+        return 0.0;
+    }
+
+    if (options.marginals) {
+        print_marginals(soma, input_filename, output);
+        if (input_ptr != &std::cin)
+            delete input_ptr;
+        return 0.0;
+    }
+
+    if (options.near_miss) {
+        print_near_misses(soma, input_filename, output);
+        if (input_ptr != &std::cin)
+            delete input_ptr;
+        return 0.0;
+    }
+
+    if (!options.hints.empty()) {
+        print_hints(soma, options.hints, input_filename, output);
+        if (input_ptr != &std::cin)
+            delete input_ptr;
+        return 0.0;
+    }
+
+    if (!options.read_directory.empty()) {
+        print_diagram(soma                    ,
+                      options.read_directory  ,
+                      options.query_expression,
+                      options.ranking         ,
+                      input_filename          ,
+                      output                  );
+        if (input_ptr != &std::cin)
+            delete input_ptr;
+        return 0.0;
+    }
+
+    if (options.print_name && !options.count_only && !resume_input)
         output << input_filename << ':' << std::endl;
 
+    if (options.ranking.samples || options.ranking.number) {
+        print_ranked(soma, options.ranking, input_filename, output);
+        if (options.print_name)
+            output << std::endl;
+        if (input_ptr != &std::cin)
+            delete input_ptr;
+        return 0.0;
+    }
+
 
     // solve SOMA figure
     //
 
     double          elapsed_time = 0.0;
     struct timeval  begin_time        ;
-    if (print_time) gettimeofday(&begin_time, 0);
+    if (options.print_time) gettimeofday(&begin_time, 0);
+
+    using std::chrono::steady_clock;
+
+    const bool                  checkpointing
+                              = !options.limits.checkpoint_filename.empty();
+    const steady_clock::time_point
+                                deadline
+                              =   options.limits.deadline > 0
+                                ?   steady_clock::now()
+                                  + std::chrono::duration_cast<
+                                      steady_clock::duration>(
+                                      std::chrono::duration<double>(
+                                        options.limits.deadline))
+                                : steady_clock::time_point::max();
+    bool                        timed_out = false,
+                                stopped   = false;
+
+    // --progress reports once per second, so also polled via deadline
+    const steady_clock::time_point
+                                search_begin  = steady_clock::now();
+    steady_clock::time_point    next_progress
+                              =   progressing
+                                ? search_begin + std::chrono::seconds(1)
+                                : steady_clock::time_point::max();
+    bool                        progressed = false;
+
+    // earliest of deadline, checkpoint, and progress report
+    auto const  next_poll = [&]() {
+        return std::min(std::min(deadline, next_progress),
+                          checkpointing
+                        ? next_checkpoint
+                        : steady_clock::time_point::max());
+    };
+
+    soma.interruptible(checkpointing ? &stop_requested : 0, next_poll());
+
+    uint64_t    number_of_solutions = resume_solutions;
+    Trace::Span trace_solve("solve");
+
+    // diagram of all solutions, also counting them if not unique
+    uint64_t    diagram_count = 0;
+    const bool  diagrammed    =    !options.diagram_directory.empty()
+                                && write_diagram(soma                     ,
+                                                 options.diagram_directory,
+                                                 input_filename           ,
+                                                 output                   ,
+                                                 diagram_count            );
+
+    // solutions to write to store, each as found
+    const bool                  storing = !options.store_directory.empty();
+    std::vector<Rank::Cover>    stored  ;
+
+    // all at once, so nothing to interrupt or checkpoint
+    bool        all_at_once = false;
+    if (options.count_only && !options.existence && !storing) {
+        uint64_t    count;
+
+        if (options.decompose) {
+            count       = soma.count();
+            all_at_once = true;
+        }
+        else if (options.join && soma.join_count(count))
+            all_at_once = true;
+        else if (options.ranking.count && soma.ranked(count))
+            all_at_once = true;
+        else if (diagrammed && !soma.unique()) {
+            count       = diagram_count;
+            all_at_once = true;
+        }
+
+        if (all_at_once)
+            number_of_solutions = count;
+    }
+
+    while (!all_at_once) {
+        // existence mode finds at most one solution
+        if (!(  options.existence ? !number_of_solutions && soma.exists()
+                                  : soma.solve()                         )) {
+            if (!soma.interrupted())
+                break;  // no more solutions
+
+            if (stop_requested) {
+                write_checkpoint(soma               ,
+                                 options.limits     ,
+                                 input_filename     ,
+                                 number_of_solutions,
+                                 false              );
+                stopped        = true   ;
+                stop_requested = STOPPED;
+                break;
+            }
+
+            const steady_clock::time_point  now = steady_clock::now();
+            if (now >= deadline) {
+                timed_out = true;
+                break;
+            }
+
+            if (now >= next_progress) {
+                print_progress(progress_estimate                          ,
+                               input_filename                             ,
+                               number_of_solutions                        ,
+                               std::chrono::duration<double>(
+                                 now - search_begin).count()              );
+                next_progress = now + std::chrono::seconds(1);
+                progressed    = true;
+            }
+
+            // periodic checkpoint
+            if (checkpointing && now >= next_checkpoint) {
+                write_checkpoint(soma               ,
+                                 options.limits     ,
+                                 input_filename     ,
+                                 number_of_solutions,
+                                 false              );
+                next_checkpoint =   now
+                                  + std::chrono::duration_cast<
+                                      steady_clock::duration>(
+                                      std::chrono::duration<double>(
+                                        options.limits.checkpoint_interval));
+            }
+
+            soma.interruptible(checkpointing ? &stop_requested : 0,
+                               next_poll()                         );
+            continue;
+        }
 
-    unsigned    number_of_solutions = 0;
-    while (soma.solve()) {    // returns true until no more solutions
         ++number_of_solutions;
 
-        if (!count_only) {
-            if (all_solutions)
+        if (storing) {
+            stored.emplace_back();
+            soma.cover(stored.back());
+        }
+
+        if (!options.count_only) {
+            Trace::Span     trace_output("output");
+
+            if (options.all_solutions)
                 output << (number_of_solutions == 1 ? "" : "\n")
                        << "solution #"
                        << number_of_solutions
@@ -358,16 +895,25 @@ bool                 print_time      )
             if (is_api_test)
                 print_api(soma, output);
 
-            if (!all_solutions)
+            if (!options.all_solutions)
                 break;   // only first solution
         }
     }
+    trace_solve.end();
+
+    if (progressed)
+        std::cerr << std::endl;  // end print_progress() line
+
+    if (storing)
+        write_store(soma                   ,
+                    options.store_directory,
+                    input_filename         ,
+                    stored                 ,
+                    output                 );
 
-#ifdef SOMA_STATISTICS
     total_solutions += number_of_solutions;
-#endif
 
-    if (print_time) {
+    if (options.print_time) {
         timeval     end_time;
 
         gettimeofday(&end_time, 0);
@@ -383,23 +929,76 @@ bool                 print_time      )
 
     }
 
-    if (count_only) {
+    const char  *incomplete =   timed_out ? " (deadline reached, incomplete)"
+                              : stopped   ? " (interrupted, incomplete)"
+                              :             ""                                 ;
+
+    if (options.count_only && options.existence)
+        output << input_filename
+               << (number_of_solutions ? ": solvable" : ": unsolvable")
+               << std::endl;
+    else if (options.count_only) {
         output << input_filename
                << ": "
                << number_of_solutions
                << " solution"
                << (number_of_solutions == 1 ? "" : "s")
+               << incomplete
                << std::endl;
     }
+    else if (timed_out)
+        output << input_filename
+               << ':'
+               << incomplete
+               << std::endl;
+    else if (stopped)   // not in output, so resumed run continues it
+        std::cerr << input_filename
+                  << ':'
+                  << incomplete
+                  << std::endl;
 
-    if (!count_only && number_of_solutions == 0) {
+    if (   !options.count_only
+        && number_of_solutions == 0
+        && !timed_out
+        && !stopped                ) {
         // no solution was printed above so show unsolved figure
         soma.print(output);
     }
 
-    if (print_name && !count_only)
+    if (options.explain) {
+        std::istringstream  reasons(soma.infeasibility());
+        std::string         reason ;
+        while (std::getline(reasons, reason))
+            output << "  " << reason << std::endl;
+    }
+
+    // record completion, so resume will skip to next figure, even if
+    //   earlier periodic checkpoint of this figure's state not yet due
+    //   to be replaced
+    if (checkpointing && !stopped) {
+        write_checkpoint(soma               ,
+                         options.limits     ,
+                         input_filename     ,
+                         number_of_solutions,
+                         true               );
+        if (stop_requested)
+            stop_requested = STOPPED;
+        next_checkpoint =   steady_clock::now()
+                          + std::chrono::duration_cast<
+                              steady_clock::duration>(
+                              std::chrono::duration<double>(
+                                options.limits.checkpoint_interval));
+    }
+
+    if (options.print_name && !options.count_only && !stopped)
         output << std::endl;
 
+    if (options.counters_output)
+        print_counters(soma,
+                       input_filename,
+                       number_of_solutions,
+                       *options.counters_output);
+
     // clean up open file if any
     if (input_ptr != &std::cin)
         delete input_ptr;
@@ -410,11 +1009,10 @@ bool                 print_time      )
 
 
 
-#ifdef SOMA_STATISTICS
 void print_statistics(
 Soma        &soma            ,
 unsigned     number_of_solves,
-unsigned     total_solutions )
+uint64_t     total_solutions )
 {
     static const unsigned   SPACING     = 10,
                             LABEL_WIDTH = 10;
@@ -514,7 +1112,6 @@ unsigned     total_solutions )
                  { return soma.statuses_duplicates(piece); });
 
 }  // print_statistics(Soma&, unsigned)
-#endif  // #ifdef SOMA_STATISTICS
 
 
 
@@ -543,122 +1140,1428 @@ const Soma          &soma  ,
 
 
 
-// Read special input file format for testing Soma::shape() API
-// For testing only. File format not intended for external use.
-// See ./figures/*.api_test for examples.
-// Minimal error checking.
+// One line of JSON per figure, see Soma::counters() and counters.hxx
+// Figures which fail to read or specify are not reported.
 //
-bool read_pieces_file(
-      Soma          &soma      ,
-      std::istream  &input     ,
-      std::ostream  &output    ,
-const std::string   &filename  ,
-      bool           print_name)
+void print_counters(
+const Soma          &soma          ,
+const std::string   &input_filename,
+      uint64_t       num_solutions ,
+      std::ostream  &output        )
 {
-    // 'o' normal, others pre-placed pieces
-    static std::string  PIECE_CHARS("ocpnztl3");
+    output << "{\"figure\":\"";
+    write_json_escaped(output, input_filename);
+    output << "\",\"solutions\":"
+           << num_solutions
+           << ",\"counters\":";
+    soma.counters().write_json(output, soma.piece_order());
+    output << '}' << std::endl;
 
-    // flat array of x0, y0, z0, x1, y1, z1 ... positoins
-    std::array<int, Shape::NUMBER_OF_CUBICLES * 3>  coords;
+}  // print_counters(const Soma&, const std::string&, uint64_t, ...)
 
-    std::string     line   ,  // raw input
-                    pieces ;  // one-to-one with positions, name or unspecified
-    unsigned        ndx = 0;  // indices into flat array
 
-    while (std::getline(input, line)) {
-        std::istringstream      parser(line);
-        int                     x, y, z     ;
-        std::string             piece       ;
 
-        parser >> x
-               >> y
-               >> z
-               >> piece;
+// Write to temporary file and rename, so never leaves partial checkpoint
+// Format is figure filename, solutions found so far, and either "done"
+//   or "state" followed by Soma::checkpoint()
+//
+void write_checkpoint(
+const Soma          &soma          ,
+const Limits        &limits        ,
+const std::string   &input_filename,
+      uint64_t       num_solutions ,
+      bool           done          )
+{
+    const std::string   temporary = limits.checkpoint_filename + ".tmp";
 
-        // check for valid piece (or unspecified) name
-        if (PIECE_CHARS.find(piece) == std::string::npos) {
-            if (print_name)
-                output << filename
-                       << ':'
-                       << std::endl;
-            output << "Bad piece character code in line: "
-                   << line
-                   << std::endl;
-            return false;
-        }
+    {
+        std::ofstream   output(temporary);
 
-        pieces.append(piece);
+        output << "figure "
+               << input_filename
+               << "\nsolutions "
+               << num_solutions
+               << '\n'
+               << (done ? "done" : "state")
+               << '\n';
 
-        // flat array
-        coords[ndx * 3    ] = x;
-        coords[ndx * 3 + 1] = y;
-        coords[ndx * 3 + 2] = z;
-        ++ndx                  ;
-    }
+        if (!done)
+            soma.checkpoint(output);
 
-    if (ndx < Shape::NUMBER_OF_CUBICLES) {
-        if (print_name)
-            output << filename
-                       << ':'
-                       << std::endl;
-        output << "Less than 27 cubicles ("
-               << ndx
-               << ") in .api_test file"
-                << std::endl         ;
-        return false;
+        if (!output) {
+            std::cerr << "Can't write checkpoint file "
+                      << temporary
+                      << std::endl;
+            return;
+        }
     }
 
+    if (std::rename(temporary.c_str(), limits.checkpoint_filename.c_str()))
+        std::cerr << "Can't rename "
+                  << temporary
+                  << " to "
+                  << limits.checkpoint_filename
+                  << std::endl;
 
-    // use Soma class API
-    std::ostringstream      errors;
-    if (!soma.shape(coords, pieces, &errors)) {
-        if (print_name)
-            output << filename
-                   << ':'
-                   << std::endl;
-        output << errors.str();
-        return false;
-    }
+}  // write_checkpoint(const Soma&, const Limits&, ...)
 
-    return true;
 
-}  // read_pieces_file(...)
 
+// SIGINT/SIGTERM handler if checkpointing
+void request_stop(
+int     /* signal_number */)
+{
+    if (!stop_requested)
+        stop_requested = STOP_REQUESTED;
+}
 
 
-// commandline help text strings
+
+// Single line per figure, values with 95% confidence interval half-widths
+void print_estimate(
+const Soma::Estimate    &estimate      ,
+const std::string       &input_filename,
+      std::ostream      &output        )
+{
+    output << input_filename
+           << ": "
+           << estimate.solutions
+           << " +/- "
+           << estimate.solutions_error
+           << " solutions, "
+           << estimate.nodes
+           << " +/- "
+           << estimate.nodes_error
+           << " nodes, "
+           << estimate.seconds
+           << " +/- "
+           << estimate.seconds_error
+           << " seconds ("
+           << estimate.probes
+           << " probes in "
+           << estimate.elapsed
+           << " seconds)"
+           << std::endl;
+
+}  // print_estimate(const Soma::Estimate&, const std::string&, std::ostream&)
+
+
+
+// To stderr, overwriting previous report's line, so caller must end
+//   with newline. Elapsed is seconds since search began (or resumed).
+void print_progress(
+const Soma::Estimate    &estimate      ,
+const std::string       &input_filename,
+      uint64_t           num_solutions ,
+      double             elapsed       )
+{
+    std::cerr << '\r'
+              << input_filename
+              << ": "
+              << num_solutions
+              << " of ~"
+              << estimate.solutions
+              << " solutions, "
+              << elapsed
+              << " of ~"
+              << estimate.seconds
+              << " +/- "
+              << estimate.seconds_error
+              << " seconds, ";
+
+    if (elapsed < estimate.seconds)
+        std::cerr << "ETA "
+                  << estimate.seconds - elapsed
+                  << " seconds   ";
+    else
+        std::cerr << "past estimate   ";
+
+    std::cerr << std::flush;
+
+}  // print_progress(const Soma::Estimate&, const std::string&, ...)
+
+
+
+// Solution number ranking.number, then ranking.samples random ones,
+//   each with its number, instead of solving
 //
+void print_ranked(
+      Soma          &soma          ,
+const Ranking       &ranking       ,
+const std::string   &input_filename,
+      std::ostream  &output        )
+{
+    uint64_t    count;
 
-const char  *BRIEF_HELP_TEXT = R"END_OF_TEXT(Solve SOMA figure(s).
+    // -D 7 forced for separated shapes, whose child shapes rotate and
+    //   reflect independently, so even with -r
+    if (!soma.ranked(count)) {
+        output << input_filename
+               << ": can't number solutions of figure with separated shapes"
+               << std::endl;
+        return;
+    }
 
-Usage: %s [OPTIONS] <FILE> [FILES...]
+    if (count == 0) {
+        output << input_filename
+               << ": no solutions"
+               << std::endl;
+        return;
+    }
 
-FILE:       filename or "-" for standard input
-FILES:      additional files
+    if (ranking.number > count) {
+        output << input_filename
+               << ": no solution #"
+               << ranking.number
+               << " ("
+               << count
+               << " solution"
+               << (count == 1 ? "" : "s")
+               << ')'
+               << std::endl;
+        return;
+    }
 
-OPTIONS:
-  -a            all solutions (only unique solutions by default)
-  -r            include rotated and reflected solutions (forces -D 0)
-  -c            only count of solutions, not solution(s) themselves
-  -t            print elapsed time to solve figures
-  -n            print filename before solution(s)
-  -o <FILE>     output to file instead of standard output
-  -O <pieces>   orphans check:     1 to 7 numbers, each 1 thru 7,
-                                   or single 0 (default: %s)
+    bool    first = true;
+
+    if (ranking.number) {
+        soma.unrank(ranking.number - 1);
+        output << "solution #"
+               << ranking.number
+               << " of "
+               << count
+               << std::endl;
+        soma.print(output);
+        first = false;
+    }
+
+    std::mt19937_64     random(ranking.seed);
+
+    for (unsigned sample = 0 ; sample < ranking.samples ; ++sample) {
+        uint64_t    index;
+
+        soma.sample(random);
+        soma.rank  (index );
+        output << (first ? "" : "\n")
+               << "random solution #"
+               << index + 1
+               << " of "
+               << count
+               << std::endl;
+        soma.print(output);
+        first = false;
+    }
+
+}  // print_ranked(Soma&, const Ranking&, const std::string&, std::ostream&)
+
+
+
+// Write Soma::diagram() of figure to directory, see output_path().
+//   False (with message to output) if can't.
+//
+bool write_diagram(
+      Soma          &soma          ,
+const std::string   &directory     ,
+const std::string   &input_filename,
+      std::ostream  &output        ,
+      uint64_t      &count         )
+{
+    const std::string   filename = output_path(directory     ,
+                                               input_filename,
+                                               ".zdd"        );
+    Zdd                 zdd;
+
+    soma.diagram(zdd);
+
+    std::ofstream   diagram(filename, std::ios::binary);
+
+    if (!diagram || !zdd.write(diagram)) {
+        output << "Can't write file "
+               << filename
+               << " for diagram output"
+               << std::endl;
+        return false;
+    }
+
+    count = zdd.count();
+
+    return true;
+
+}  // write_diagram(Soma&, const std::string&, const std::string&, ...)
+
+
+
+// File in directory named as figure file without its directory and
+//   extension, plus extension
+//
+std::string output_path(
+const std::string   &directory     ,
+const std::string   &input_filename,
+const std::string   &extension     )
+{
+    std::string                  name  = input_filename;
+    const std::string::size_type slash = name.rfind('/');
+
+    if (slash != std::string::npos)
+        name.erase(0, slash + 1);
+
+    const std::string::size_type period = name.find('.');
+
+    if (period != std::string::npos)
+        name.erase(period);
+
+    if (name.empty() || name == "-")
+        name = "stdin";
+
+    return directory + '/' + name + extension;
+
+}  // output_path(const std::string&, const std::string&, ...)
+
+
+
+// Write solutions found by solve() to store in directory, see
+//   output_path(). Message to output if can't.
+//
+void write_store(
+      Soma                      &soma          ,
+const std::string               &directory     ,
+const std::string               &input_filename,
+const std::vector<Rank::Cover>  &solutions     ,
+      std::ostream              &output        )
+{
+    const std::string   filename = output_path(directory     ,
+                                               input_filename,
+                                               ".sdb"        );
+    std::ofstream       store(filename, std::ios::binary);
+
+    if (!store || !soma.store(store, solutions))
+        output << "Can't write file "
+               << filename
+               << " for solution store output"
+               << std::endl;
+
+}  // write_store(Soma&, const std::string&, const std::string&, ...)
+
+
+
+// Soma::marginals(): per piece, number of its placements in some
+//   solution and in all (listing those cubicles), then per cubicle,
+//   number of solutions with each piece covering it
+//
+void print_marginals(
+      Soma          &soma          ,
+const std::string   &input_filename,
+      std::ostream  &output        )
+{
+    Soma::Marginals                                 marginals;
+    std::array<int, Shape::NUMBER_OF_CUBICLES * 3>  coords   ;
+
+    soma.marginals(marginals);
+    soma.solution (coords   );
+
+    // Cubicle coordinates, as for --query
+    auto    cubicle = [&coords](const unsigned ndx)
+                      {
+                          std::ostringstream    text;
+                          text << '('
+                               << coords[ndx * 3    ] << ','
+                               << coords[ndx * 3 + 1] << ','
+                               << coords[ndx * 3 + 2] << ')';
+                          return text.str();
+                      };
+
+    output << input_filename
+           << ": "
+           << marginals.solutions
+           << " solution"
+           << (marginals.solutions == 1 ? "" : "s")
+           << std::endl;
+
+    for (unsigned piece = 0 ; piece < Piece::NUMBER_OF_PIECES ; ++piece) {
+        const std::vector<std::pair<uint32_t, uint64_t>>
+                   &placements = marginals.placements[piece];
+        unsigned    used       = 0;
+        std::string forced        ;
+
+        for (const std::pair<uint32_t, uint64_t> &placement : placements) {
+            if (!placement.second)
+                continue;
+
+            ++used;
+
+            if (placement.second == marginals.solutions)
+                for (uint32_t bits = placement.first ; bits ; bits &= bits - 1)
+                    forced += " " + cubicle(__builtin_ctz(bits));
+        }
+
+        output << "  "
+               << marginals.names[piece]
+               << ": "
+               << used
+               << " of "
+               << placements.size()
+               << " placement"
+               << (placements.size() == 1 ? "" : "s")
+               << " in some solution"
+               << (forced.empty() ? "" : ", forced:")
+               << forced
+               << std::endl;
+    }
+
+    output << "  cubicle     ";
+    for (const char name : marginals.names)
+        output << std::setw(8) << name;
+    output << std::endl;
+
+    for (unsigned ndx = 0 ; ndx < Shape::NUMBER_OF_CUBICLES ; ++ndx) {
+        output << "  " << std::left << std::setw(12) << cubicle(ndx)
+               << std::right;
+        for (unsigned piece = 0 ; piece < Piece::NUMBER_OF_PIECES ; ++piece)
+            output << std::setw(8) << marginals.cubicles[piece][ndx];
+        output << std::endl;
+    }
+
+}  // print_marginals(Soma&, const std::string&, std::ostream&)
+
+
+
+// Soma::near_misses(): number of one-cube moves tried and making
+//   figure solvable, then each of latter
+//
+void print_near_misses(
+      Soma          &soma          ,
+const std::string   &input_filename,
+      std::ostream  &output        )
+{
+    std::vector<Soma::Move>     solvable;
+    const unsigned              tried = soma.near_misses(solvable);
+
+    auto    position = [](const Position &cubicle)
+                       {
+                           std::ostringstream   text;
+                           text << static_cast<int>(cubicle.x()) << ','
+                                << static_cast<int>(cubicle.y()) << ','
+                                << static_cast<int>(cubicle.z());
+                           return text.str();
+                       };
+
+    output << input_filename
+           << ": "
+           << solvable.size()
+           << " of "
+           << tried
+           << " one-cube move"
+           << (tried == 1 ? "" : "s")
+           << " make"
+           << (solvable.size() == 1 ? "s" : "")
+           << " figure solvable"
+           << std::endl;
+
+    for (const Soma::Move &move : solvable)
+        output << "  "
+               << position(move.from)
+               << " -> "
+               << position(move.to)
+               << std::endl;
+
+}  // print_near_misses(Soma&, const std::string&, std::ostream&)
+
+
+
+// Soma::hint_start() session of --hint commands, each printed with
+//   its result: Soma::hint_count() after count, place, and undo (or
+//   why not done), and for moves per unused piece its number of
+//   placements with solutions and their total solutions (equal to
+//   count, as each solution uses exactly one of them)
+//
+void print_hints(
+      Soma                  &soma          ,
+const std::vector<Hint>     &hints         ,
+const std::string           &input_filename,
+      std::ostream          &output        )
+{
+    if (!soma.hint_start()) {
+        output << input_filename
+               << ": unsolvable"
+               << std::endl;
+        return;
+    }
+
+    output << input_filename
+           << ": "
+           << soma.hint_count()
+           << " solutions"
+           << std::endl;
+
+    for (const Hint &hint : hints) {
+        output << hint.text << ':';
+
+        if (hint.command == 'm') {
+            std::array<std::vector<uint64_t>, Piece::NUMBER_OF_PIECES>
+                        moves;
+
+            soma.hint_moves(moves);
+            output << std::endl;
+
+            for (unsigned     piece = 0                       ;
+                              piece < Piece::NUMBER_OF_PIECES ;
+                            ++piece                            ) {
+                unsigned    used      = 0;
+                uint64_t    solutions = 0;
+
+                for (const uint64_t count : moves[piece])
+                    if (count) {
+                        ++used;
+                        solutions += count;
+                    }
+
+                if (used)
+                    output << "  "
+                           << soma.piece_name(piece)
+                           << ": "
+                           << used
+                           << " of "
+                           << moves[piece].size()
+                           << " placements, "
+                           << solutions
+                           << " solutions"
+                           << std::endl;
+            }
+            continue;
+        }
+
+        bool        done = true;
+
+        if (hint.command == 'p') {
+            unsigned    piece = 0;
+
+            while (   piece < Piece::NUMBER_OF_PIECES
+                   && soma.piece_name(piece) != hint.piece)
+                ++piece;
+
+            done = soma.hint_place(piece, hint.placement);
+        }
+        else if (hint.command == 'u')
+            done = soma.hint_undo();
+
+        if (done)
+            output << ' '
+                   << soma.hint_count()
+                   << " solutions"
+                   << std::endl;
+        else
+            output << " not possible"
+                   << std::endl;
+    }
+
+    output << std::endl;
+    soma.print(output);
+    output << std::endl;
+
+}  // print_hints(Soma&, const std::vector<Hint>&, const std::string&, ...)
+
+
+
+// Number of solutions in store matching query expression, and time
+//   taken to find them. If list (-a), also each matching one's number
+//   in store and its pieces' cubicles, from Store::solution().
+//
+double query_store(
+const std::string   &input_filename,
+const std::string   &expression    ,
+      bool           list          ,
+      std::ostream  &output        )
+{
+    Trace::Span     trace("query", input_filename);
+
+    Store                   store  ;
+    std::ostringstream      errors ;
+    std::vector<uint64_t>   matches;
+    uint64_t                count  ;
+
+    if (!store.open(input_filename, errors)) {
+        output << errors.str();
+        return 0.0;
+    }
+
+    const std::chrono::steady_clock::time_point
+                    begin = std::chrono::steady_clock::now();
+
+    if (!store.query(expression, matches, count, errors)) {
+        output << input_filename << ": " << errors.str();
+        return 0.0;
+    }
+
+    const std::chrono::duration<double>
+                    elapsed = std::chrono::steady_clock::now() - begin;
+
+    output << input_filename
+           << ": "
+           << count
+           << " of "
+           << store.solutions()
+           << " solution"
+           << (store.solutions() == 1 ? "" : "s")
+           << std::endl;
+
+    const std::string   names = store.names();
+
+    for (uint64_t ndx = 0 ; list && ndx < store.solutions() ; ++ndx) {
+        if (!(matches[ndx / 64] & static_cast<uint64_t>(1) << ndx % 64))
+            continue;
+
+        const Store::Cover  cover = store.solution(ndx);
+
+        output << "solution #"
+               << ndx + 1
+               << std::endl;
+
+        for (unsigned piece = 0 ; piece < names.size() ; ++piece) {
+            output << "  " << names[piece] << ':';
+
+            for (uint32_t bits = cover[piece] ; bits ; bits &= bits - 1) {
+                const unsigned  cubicle = __builtin_ctz(bits);
+
+                if (cubicle >= store.cubicles())
+                    continue;  // corrupt store
+
+                const Store::Coords coords = store.coords(cubicle);
+
+                output << " ("
+                       << coords[0] << ','
+                       << coords[1] << ','
+                       << coords[2] << ')';
+            }
+
+            output << std::endl;
+        }
+    }
+
+    return elapsed.count();
+
+}  // query_store(const std::string&, const std::string&, bool, ...)
+
+
+
+// Zdd::count() excluded variables for "&"-joined --query terms:
+//   all other placements of each term's piece if it covers term's
+//   cubicle, else all those covering it. False (with message to
+//   output) if expression invalid.
+//
+bool diagram_excluded(
+      Soma                  &soma      ,
+const Zdd                   &zdd       ,
+const std::string           &expression,
+      std::vector<bool>     &excluded  ,
+      std::ostream          &output    )
+{
+    std::array<int, Shape::NUMBER_OF_CUBICLES * 3>  coords;
+
+    soma.solution(coords);
+    excluded.assign(zdd.variables().size(), false);
+
+    if (expression.find('|') != std::string::npos) {
+        output << "Query \""
+               << expression
+               << "\": only \"&\" with --read-zdd"
+               << std::endl;
+        return false;
+    }
+
+    for (std::string::size_type start = 0, stop = 0 ;
+                                stop != std::string::npos ;
+                                start = stop + 1) {
+        stop = expression.find('&', start);
+
+        const std::string           text   = expression.substr(start,
+                                                               stop - start);
+        const bool                  negate = !text.empty() && text[0] == '!';
+        const std::string::size_type
+                                    name   = negate ? 1 : 0;
+        const std::string::size_type
+                                    piece  =   text.size() > name
+                                             ? zdd.names().find(text[name])
+                                             : std::string::npos;
+        int                         term[3];
+        const char                 *scan   = text.c_str() + name + 1;
+        char                       *end    = 0;
+        bool                        valid  =    piece != std::string::npos
+                                             && text.size() > name + 1
+                                             && text[name + 1] == '@';
+
+        for (unsigned axis = 0 ; axis < 3 && valid ; ++axis) {
+            term[axis] = strtol(++scan, &end, 10);
+            valid      = end != scan && *end == (axis == 2 ? '\0' : ',');
+            scan       = end;
+        }
+
+        if (!valid) {
+            output << "Invalid query term \""
+                   << text
+                   << "\": must be [!]<piece>@<x>,<y>,<z>"
+                   << std::endl;
+            return false;
+        }
+
+        unsigned    cubicle = 0;
+
+        while (   cubicle < Shape::NUMBER_OF_CUBICLES
+               && (   coords[cubicle * 3    ] != term[0]
+                   || coords[cubicle * 3 + 1] != term[1]
+                   || coords[cubicle * 3 + 2] != term[2]))
+            ++cubicle;
+
+        if (cubicle == Shape::NUMBER_OF_CUBICLES) {
+            output << "Query term \""
+                   << text
+                   << "\": no cubicle at those coordinates"
+                   << std::endl;
+            return false;
+        }
+
+        for (unsigned var = 0 ; var < zdd.variables().size() ; ++var) {
+            const Zdd::Variable &variable = zdd.variables()[var];
+
+            if (   variable.item == piece
+                && static_cast<bool>(variable.mask & (1u << cubicle))
+                   == negate                                         )
+                excluded[var] = true;
+        }
+    }
+
+    return true;
+
+}  // diagram_excluded(Soma&, const Zdd&, const std::string&, ...)
+
+
+
+// Number of all solutions (as with -r) of figure, or of those
+//   matching --query expression, and --unrank and --sample ones, from
+//   diagram written by --zdd instead of solving figure
+//
+void print_diagram(
+      Soma          &soma          ,
+const std::string   &directory     ,
+const std::string   &expression    ,
+const Ranking       &ranking       ,
+const std::string   &input_filename,
+      std::ostream  &output        )
+{
+    Trace::Span     trace("read diagram", input_filename);
+
+    const std::string   filename = output_path(directory     ,
+                                               input_filename,
+                                               ".zdd"        );
+    std::ifstream       diagram(filename, std::ios::binary);
+    Zdd                 zdd;
+
+    if (   !diagram
+        || !zdd.read(diagram)
+        || zdd.names().size() != Piece::NUMBER_OF_PIECES
+        || zdd.cells() != (1u << Shape::NUMBER_OF_CUBICLES) - 1) {
+        output << input_filename
+               << ": can't read diagram file "
+               << filename
+               << std::endl;
+        return;
+    }
+
+    // Diagram's items are in writer's piece order (-P), perhaps not
+    //   this figure's, so per item, Soma piece number
+    std::array<unsigned, Piece::NUMBER_OF_PIECES>   pieces;
+    unsigned                                        found = 0;
+
+    for (unsigned item = 0 ; item < Piece::NUMBER_OF_PIECES ; ++item)
+        for (unsigned piece = 0 ; piece < Piece::NUMBER_OF_PIECES ; ++piece)
+            if (zdd.names()[item] == soma.piece_name(piece)) {
+                pieces[item]  = piece;
+                found        |= 1 << piece;
+            }
+
+    if (found != (1u << Piece::NUMBER_OF_PIECES) - 1) {
+        output << input_filename
+               << ": diagram file "
+               << filename
+               << " pieces \""
+               << zdd.names()
+               << "\" don't match figure's"
+               << std::endl;
+        return;
+    }
+
+    // Solution from diagram into figure, false (with message) if
+    //   diagram wasn't of this figure
+    auto    place = [&](const Zdd::Cover &cover)
+                    {
+                        Rank::Cover     placed;
+
+                        for (unsigned     item = 0                       ;
+                                          item < Piece::NUMBER_OF_PIECES ;
+                                        ++item                            )
+                            placed[pieces[item]] = cover[item];
+
+                        if (soma.place(placed))
+                            return true;
+
+                        output << input_filename
+                               << ": diagram file "
+                               << filename
+                               << " solution doesn't fit figure"
+                               << std::endl;
+                        return false;
+                    };
+
+    std::vector<bool>   excluded;
+
+    if (   !expression.empty()
+        && !diagram_excluded(soma, zdd, expression, excluded, output))
+        return;
+
+    const uint64_t  count    = zdd.count(),
+                    matching = expression.empty() ? count
+                                                  : zdd.count(excluded);
+
+    output << input_filename
+           << ": ";
+    if (!expression.empty())
+        output << matching
+               << " of ";
+    output << count
+           << " solution"
+           << (count == 1 ? "" : "s")
+           << std::endl;
+
+    Zdd::Cover  cover        ;
+    bool        first = true;
+
+    if (ranking.number) {
+        if (!zdd.unrank(ranking.number - 1, cover))
+            output << "no solution #"
+                   << ranking.number
+                   << std::endl;
+        else if (place(cover)) {
+            output << "solution #"
+                   << ranking.number
+                   << " of "
+                   << count
+                   << std::endl;
+            soma.print(output);
+        }
+        first = false;
+    }
+
+    std::mt19937_64     random(ranking.seed);
+
+    for (unsigned sample = 0 ; sample < ranking.samples ; ++sample) {
+        if (!zdd.sample(random, cover, expression.empty() ? 0 : &excluded))
+            break;
+
+        if (!place(cover))
+            break;
+        output << (first ? "" : "\n")
+               << "random solution of "
+               << matching
+               << std::endl;
+        soma.print(output);
+        first = false;
+    }
+
+}  // print_diagram(Soma&, const std::string&, const std::string&, ...)
+
+
+
+// Soma::enumerate(): each solvable generated figure in .soma file
+//   format (see EXTENDED_HELP_TEXT) preceded by comment with its number
+//   of solutions, then summary comment. Time taken.
+//
+double write_catalog(
+      Soma          &soma   ,
+const Catalog       &catalog,
+      std::ostream  &output )
+{
+    std::ostringstream  box;
+    box << catalog.box[0] << 'x' << catalog.box[1] << 'x' << catalog.box[2];
+
+    Trace::Span     trace("catalog", box.str());
+
+    const std::chrono::steady_clock::time_point
+                    begin = std::chrono::steady_clock::now();
+
+    const unsigned  width  = catalog.box[0],  // x
+                    height = catalog.box[1],  // y
+                    depth  = catalog.box[2];  // z
+    uint64_t        candidates = 0,
+                    solvable   = 0;
+
+    auto    found = [&](const std::array<int, Shape::NUMBER_OF_CUBICLES * 3>
+                                                                    &coords)
+    {
+        // layers top to bottom, rows back to front, each with newline
+        std::string     cubicles(depth * height * (width + 1), '.');
+        uint64_t        count;
+
+        for (unsigned row = 0 ; row < depth * height ; ++row)
+            cubicles[row * (width + 1) + width] = '\n';
+
+        for (unsigned ndx = 0 ; ndx < Shape::NUMBER_OF_CUBICLES ; ++ndx) {
+            const unsigned  x = coords[ndx * 3    ],
+                            y = coords[ndx * 3 + 1],
+                            z = coords[ndx * 3 + 2];
+
+            cubicles[  ((depth - 1 - z) * height + height - 1 - y)
+                     * (width + 1)
+                     + x                                           ] = 'o';
+        }
+
+        soma.shape(coords, "");
+        if (!soma.join_count(count))
+            count = soma.count();
+
+        output << "# "
+               << count
+               << " solution"
+               << (count == 1 ? "" : "s")
+               << std::endl;
+
+        for (unsigned layer = 0 ; layer < depth ; ++layer) {
+            if (layer)
+                output << std::endl;
+            output << cubicles.substr(layer * height * (width + 1),
+                                      height * (width + 1)        );
+        }
+        output << std::endl;
+
+        return true;
+    };
+
+    soma.enumerate(catalog.box, catalog.rules, found, candidates, solvable);
+
+    const std::chrono::duration<double>
+                    elapsed = std::chrono::steady_clock::now() - begin;
+
+    output << "# "
+           << box.str()
+           << ": "
+           << solvable
+           << " of "
+           << candidates
+           << " figure"
+           << (candidates == 1 ? "" : "s")
+           << " solvable"
+           << std::endl;
+
+    return elapsed.count();
+
+}  // write_catalog(Soma&, const Catalog&, std::ostream&)
+
+
+
+// Read --hint file: one command per line, "count", "moves",
+//   "place <piece> <placement>", or "undo". '#' starts comment,
+//   blank lines ignored. Errors to stderr.
+//
+bool read_hints(
+const std::string           &filename,
+      std::vector<Hint>     &hints   )
+{
+    std::ifstream   input(filename);
+    std::string     line          ;
+    unsigned        line_number = 0;
+
+    if (!input) {
+        std::cerr << "Can't open file "
+                  << filename
+                  << " for --hint commands"
+                  << std::endl;
+        return false;
+    }
+
+    while (std::getline(input, line)) {
+        ++line_number;
+
+        std::istringstream  parser(line.substr(0, line.find('#')));
+        std::string         command,
+                            extra  ;
+        Hint                hint{"", 0, 0, 0};
+
+        if (!(parser >> command))
+            continue;
+
+        if (command == "place")
+            parser >> hint.piece >> hint.placement;
+
+        hint.command = command[0];
+        hint.text    = command;
+        if (command == "place" && parser)
+            hint.text += std::string(" ") + hint.piece + ' '
+                       + std::to_string(hint.placement);
+
+        if (   (   command != "count" && command != "moves"
+                && command != "place" && command != "undo" )
+            || !parser
+            || parser >> extra                              ) {
+            std::cerr << "Bad command in --hint file "
+                      << filename
+                      << " line "
+                      << line_number
+                      << ": "
+                      << line
+                      << std::endl;
+            return false;
+        }
+
+        hints.push_back(hint);
+    }
+
+    if (hints.empty()) {
+        std::cerr << "No commands in --hint file "
+                  << filename
+                  << std::endl;
+        return false;
+    }
+
+    return true;
+
+}  // read_hints(const std::string&, std::vector<Hint>&)
+
+
+
+// Read --sweep file: one configuration per line, any of -O, -D, -S,
+//   -P (each followed by its value), -b, and -F as on commandline,
+//   others as per defaults. '#' starts comment, blank lines ignored.
+// Errors to stderr.
+//
+bool read_sweep(
+const std::string           &filename,
+const Sweep                 &defaults,
+      std::vector<Sweep>    &sweeps  )
+{
+    std::ifstream   input(filename);
+    std::string     line          ;
+    unsigned        line_number = 0;
+
+    if (!input) {
+        std::cerr << "Can't open file "
+                  << filename
+                  << " for --sweep configurations"
+                  << std::endl;
+        return false;
+    }
+
+    while (std::getline(input, line)) {
+        ++line_number;
+
+        std::istringstream  parser(line.substr(0, line.find('#')));
+        std::string         option,
+                            value ;
+        Sweep               sweep(defaults);
+        bool                good = true    ;
+
+        while (good && parser >> option) {
+            if (!sweep.options.empty())
+                sweep.options += ' ';
+            sweep.options += option;
+
+            if (option == "-b")
+                sweep.symmetry_breaking = true;
+            else if (option == "-F")
+                sweep.forward_checking  = true;
+            else if (   (   option != "-O" && option != "-D"
+                         && option != "-S" && option != "-P")
+                     || !(parser >> value)                   )
+                good = false;
+            else {
+                sweep.options += ' ' + value;
+
+                if (option == "-O")
+                    good = parse_steps(sweep.orphans   , value, option);
+                else if (option == "-D")
+                    good = parse_steps(sweep.duplicates, value, option);
+                else if (option == "-S")
+                    good = parse_steps(sweep.symmetries, value, option);
+                else {
+                    std::string     sorted(value                    ),
+                                    pieces(Soma::DEFAULT_PIECE_ORDER);
+                    std::sort(sorted.begin(), sorted.end());
+                    std::sort(pieces.begin(), pieces.end());
+                    sweep.piece_order = value;
+                    good              = sorted == pieces;
+                }
+            }
+        }
+
+        if (!good) {
+            std::cerr << "Bad configuration in --sweep file "
+                      << filename
+                      << " line "
+                      << line_number
+                      << ": "
+                      << line
+                      << std::endl;
+            return false;
+        }
+
+        if (!sweep.options.empty())
+            sweeps.push_back(sweep);
+    }
+
+    if (sweeps.empty()) {
+        std::cerr << "No configurations in --sweep file "
+                  << filename
+                  << std::endl;
+        return false;
+    }
+
+    return true;
+
+}  // read_sweep(const std::string&, const Sweep&, std::vector<Sweep>&)
+
+
+
+// Read (and prepare, see Soma::read()) each figure once, then count
+//   its solutions (as per -c) with each configuration in turn via
+//   Soma::reconfigure(). Table of total solutions, figures whose
+//   count differs from first configuration's (each listed), and if
+//   print_time solving time, per configuration. Total time.
+//
+double sweep(
+const std::vector<std::string>  &input_filenames,
+      Soma                      &soma           ,
+const std::vector<Sweep>        &sweeps         ,
+      bool                       print_time     ,
+      std::ostream              &output         )
+{
+    struct Result {
+        uint64_t                    solutions;
+        double                      seconds  ;
+        std::vector<std::string>    differs  ;  // figure and counts
+    };
+
+    std::vector<Result>     results(sweeps.size(), Result{0, 0.0, {}});
+    unsigned                figures = 0;
+    double                  elapsed = 0.0;
+
+    auto    configure = [&soma](const Sweep &sweep)
+                        {
+                            soma.orphans          (sweep.orphans          );
+                            soma.duplicates       (sweep.duplicates       );
+                            soma.symmetries       (sweep.symmetries       );
+                            soma.piece_order      (sweep.piece_order      );
+                            soma.symmetry_breaking(sweep.symmetry_breaking);
+                            soma.forward_checking (sweep.forward_checking );
+                        };
+
+    for (const std::string &input_filename : input_filenames) {
+        Trace::Span         trace("figure", input_filename);
+
+        std::ifstream       input (input_filename);
+        std::ostringstream  errors;
+        uint64_t            first = 0;
+
+        // determine file type from filename extension, as per solve()
+        const std::string::size_type    period = input_filename.find(".");
+        const bool                      is_api_test
+                                        =    period != std::string::npos
+                                          &&    input_filename.substr(period)
+                                             == ".api_test"              ;
+
+        configure(sweeps[0]);
+
+        if (!input) {
+            output << "Can't open file "
+                   << input_filename
+                   << " for input"
+                   << std::endl;
+            continue;
+        }
+
+        if (  is_api_test
+            ? !read_pieces_file(soma, input, errors, input_filename, true)
+            : !soma.read(input, &errors)                                  ) {
+            if (!is_api_test)
+                output << input_filename << ':' << std::endl;
+            output << errors.str();
+            continue;
+        }
+
+        ++figures;
+
+        for (unsigned ndx = 0 ; ndx < sweeps.size() ; ++ndx) {
+            Trace::Span     trace_configuration("configuration",
+                                                sweeps[ndx].options);
+
+            bool            ready = true;  // as after read() if first
+            if (ndx) {
+                configure(sweeps[ndx]);
+                ready = soma.reconfigure();
+            }
+
+            const std::chrono::steady_clock::time_point
+                            begin = std::chrono::steady_clock::now();
+
+            uint64_t        count = 0;
+            while (ready && soma.solve())
+                ++count;
+
+            const std::chrono::duration<double>
+                            seconds = std::chrono::steady_clock::now() - begin;
+
+            results[ndx].solutions += count            ;
+            results[ndx].seconds   += seconds.count()  ;
+            elapsed                += seconds.count()  ;
+
+            if (ndx == 0)
+                first = count;
+            else if (count != first)
+                results[ndx].differs.push_back(  input_filename
+                                               + ": "
+                                               + std::to_string(count)
+                                               + " vs "
+                                               + std::to_string(first));
+        }
+    }
+
+    size_t  width = std::string("configuration").size();
+    for (const Sweep &sweep : sweeps)
+        width = std::max(width, sweep.options.size());
+
+    output << figures
+           << " figure"
+           << (figures == 1 ? "" : "s")
+           << std::endl
+           << std::left
+           << std::setw(width)
+           << "configuration"
+           << std::right
+           << std::setw(12)
+           << "solutions"
+           << std::setw(8)
+           << "differ";
+    if (print_time)
+        output << std::setw(12) << "seconds";
+    output << std::endl;
+
+    for (unsigned ndx = 0 ; ndx < sweeps.size() ; ++ndx) {
+        output << std::left
+               << std::setw(width)
+               << sweeps[ndx].options
+               << std::right
+               << std::setw(12)
+               << results[ndx].solutions
+               << std::setw(8)
+               << results[ndx].differs.size();
+        if (print_time)
+            output << std::setw(12)
+                   << std::fixed
+                   << std::setprecision(3)
+                   << results[ndx].seconds;
+        output << std::endl;
+
+        for (const std::string &differ : results[ndx].differs)
+            output << "  " << differ << std::endl;
+    }
+
+    return elapsed;
+
+}  // sweep(const std::vector<std::string>&, Soma&, ...)
+
+
+
+// Read special input file format for testing Soma::shape() API
+// For testing only. File format not intended for external use.
+// See ./figures/*.api_test for examples.
+// Minimal error checking.
+//
+bool read_pieces_file(
+      Soma          &soma      ,
+      std::istream  &input     ,
+      std::ostream  &output    ,
+const std::string   &filename  ,
+      bool           print_name)
+{
+    // 'o' normal, others pre-placed pieces
+    static std::string  PIECE_CHARS("ocpnztl3");
+
+    // flat array of x0, y0, z0, x1, y1, z1 ... positoins
+    std::array<int, Shape::NUMBER_OF_CUBICLES * 3>  coords;
+
+    std::string     line   ,  // raw input
+                    pieces ;  // one-to-one with positions, name or unspecified
+    unsigned        ndx = 0;  // indices into flat array
+
+    while (std::getline(input, line)) {
+        std::istringstream      parser(line);
+        int                     x, y, z     ;
+        std::string             piece       ;
+
+        parser >> x
+               >> y
+               >> z
+               >> piece;
+
+        // check for valid piece (or unspecified) name
+        if (PIECE_CHARS.find(piece) == std::string::npos) {
+            if (print_name)
+                output << filename
+                       << ':'
+                       << std::endl;
+            output << "Bad piece character code in line: "
+                   << line
+                   << std::endl;
+            return false;
+        }
+
+        pieces.append(piece);
+
+        // flat array
+        coords[ndx * 3    ] = x;
+        coords[ndx * 3 + 1] = y;
+        coords[ndx * 3 + 2] = z;
+        ++ndx                  ;
+    }
+
+    if (ndx < Shape::NUMBER_OF_CUBICLES) {
+        if (print_name)
+            output << filename
+                       << ':'
+                       << std::endl;
+        output << "Less than 27 cubicles ("
+               << ndx
+               << ") in .api_test file"
+                << std::endl         ;
+        return false;
+    }
+
+
+    // use Soma class API
+    std::ostringstream      errors;
+    if (!soma.shape(coords, pieces, &errors)) {
+        if (print_name)
+            output << filename
+                   << ':'
+                   << std::endl;
+        output << errors.str();
+        return false;
+    }
+
+    return true;
+
+}  // read_pieces_file(...)
+
+
+
+// commandline help text strings
+//
+
+const char  *BRIEF_HELP_TEXT = R"END_OF_TEXT(Solve SOMA figure(s).
+
+Usage: %s [OPTIONS] <FILE> [FILES...]
+
+FILE:       filename or "-" for standard input
+FILES:      additional files
+
+OPTIONS:
+  -a            all solutions (only unique solutions by default)
+  -r            include rotated and reflected solutions (forces -D 0)
+  -b            complete symmetry breaking: each unique solution found
+                once without duplicate checks (ignores -D, -S)
+  -F            forward checking: after each piece, reject if any
+                remaining piece or empty cubicle can no longer be placed
+                or covered (counted as orphans)
+  -c            only count of solutions, not solution(s) themselves
+  -t            print elapsed time to solve figures
+  -x            only whether solvable: first solution found by faster
+                exact-cover search, or "solvable"/"unsolvable" if -c
+                (ignores -a, -r, -O, -D, -S, -P)
+  -d            with -c, count solutions by solving each separated
+                shape, and each region split off by placed pieces,
+                independently (ignores -O, -S, -P, -A, --deadline,
+                --checkpoint)
+  -m            with -c, count solutions by joining partial solutions of
+                two groups of pieces (unique counts by Burnside's lemma,
+                not for figures with separated shapes or pre-placed
+                pieces; ignores same as -d)
+  -k            with -c, count solutions as numbered by --unrank (unique
+                counts not for figures with separated shapes; ignores
+                same as -d)
+  -i            print reasons if figure found unsolvable without searching
+  -n            print filename before solution(s)
+  -o <FILE>     output to file instead of standard output
+  -O <pieces>   orphans check:     1 to 7 numbers, each 1 thru 7,
+                                   or single 0 (default: %s)
   -D <pieces>   duplicates checks: as per -O (default: %s)
   -S <pieces>   symmetry checks:   as per -O (default: %s)
   -P <pieces>   piece order:       7 characters, exactly one each of
                                    "cpnztl3" (default: %s)
+  -A <pieces>   pair-anchored:     any of "pnz", or single 0
+                                   (default: %s)
+  -j <FILE>     write per-figure search counters to file, as JSON
+  -T <FILE>     write per-figure phase timeline to file, as Chrome
+                trace-event JSON (view with ui.perfetto.dev)
+  -e <N>[,<S>]  estimate solutions, search nodes, and solve time from
+                N random probes (random seed S) instead of solving
+  --unrank <N>  print solution number N (from 1) in fixed order
+                instead of solving (unique unless -r, not for figures
+                with separated shapes)
+  --sample <N>[,<S>]
+                print N uniformly random solutions (random seed S),
+                each with its --unrank number, instead of solving
+  --zdd <DIR>   also write decision diagram of all solutions of each
+                figure to DIR/<figure>.zdd (counted from it if -cr)
+  --read-zdd <DIR>
+                count all solutions of each figure, and print --unrank
+                and --sample ones, from DIR/<figure>.zdd written by
+                --zdd instead of solving (see -H)
+  --store <DIR> also write solutions found (all if -c or -a) to
+                DIR/<figure>.sdb solution store (see --query)
+  --query <EXPR>
+                count solutions in each file, solution stores instead
+                of figures, matching EXPR (with -a, also list them),
+                or with --read-zdd those of each figure's diagram
+                (see -H)
+  --marginals   for each piece placement and cubicle, number of
+                solutions using it, instead of solving (see -H)
+  --near-miss   list one-cube moves that make figure solvable, instead
+                of solving (see -H)
+  --catalog <X>x<Y>x<Z>[,support][,symmetric]
+                write all solvable figures filling box, instead of
+                solving figure files (see -H)
+  --sweep <FILE>
+                count solutions of figures with each -O/-D/-S/-P/-b/-F
+                configuration in FILE, reading each figure once, and
+                tabulate per configuration (see -H)
+  --hint <FILE>
+                place and remove pieces in each figure as per FILE's
+                commands, printing number of solutions completing
+                them, instead of solving (see -H)
+  -s            report solution statistics (totals for all figures)
+  --rotation <matrix|lambda>
+                implementation of shape rotations (default: matrix)
+  --std-set <set|unordered>
+                implementation of duplicate solution sets
+                (default: unordered)
+  --deadline <SECONDS>
+                stop solving each figure after SECONDS, reporting
+                partial count of solutions
+  --progress <N>[,<S>]
+                report solutions and estimated time remaining to
+                stderr once per second while solving, from -e style
+                estimate of N probes (random seed S) made first, at
+                the cost of N probes per figure
+  --checkpoint <FILE>
+                periodically, and on SIGINT/SIGTERM (then exit), save
+                search state to FILE
+  --checkpoint-interval <SECONDS>
+                seconds between --checkpoint saves (default: 60)
+  --resume <FILE>
+                continue from checkpoint FILE, skipping FILES before
+                checkpoint's figure (same FILES and options required)
   -h            this help text
   -H            extended help
   -w            print warranty
   -q            don't print version and copyright notice
-)END_OF_TEXT"
-#ifdef SOMA_STATISTICS
-"  -s            report solution statistics\n"
-#endif
-"\n"
-;
+
+)END_OF_TEXT";
 
 
 
@@ -671,6 +2574,9 @@ OPTIONS (partial list, see "-h" for "<pieces>" syntax)
   -D <pieces>   duplicate check pieces (default: %s)
   -S <pieces>   symmetry  check pieces (default: %s)
   -P <pieces>   piece order            (default: %s)
+  -A <pieces>   pair-anchored pieces   (default: %s)
+  -b            complete symmetry breaking
+  -F            forward checking
   -h            basic help text (full list of options)
   -H            this extended help
 
@@ -722,9 +2628,136 @@ Symmetry check (-S option):
   rotated/mirrored solutions. Duplicate checking is efficient enough
   that despite the potentially large percentage of symmetric cubicles
   (4 non-symmetric out of 27 total for the basic 3x3x3 SOMA cube shape)
-  overall performance gains are usually not significant. Note that
-  symmetry checking of the "p", "n", "z", or "l" pieces can produce
-  specious results.
+  overall performance gains are usually not significant. The "p", "n",
+  and "z" pieces are pair-anchored (see -A option) when symmetry checked.
+
+Symmetry breaking (-b option):
+  Instead of -D and -S checks, places each piece only if the placements
+  of it and all previously placed pieces are the first (comparing
+  cubicles in piece order) of all their rotations/reflections that
+  leave the previously placed pieces unchanged. The shape's remaining
+  symmetries are tracked as pieces are placed, so no duplicate
+  solutions are generated and no previously found solutions need to be
+  stored. Correct for all piece orders and for separated shapes (each
+  separately rotated/reflected, as per -D 7). Because reflections
+  exchange the "p" and "n" pieces they are only compared once both are
+  placed. Usually faster than default -D for figures with many
+  solutions.
+
+Forward checking (-F option):
+  After each piece is placed, checks that each remaining piece still
+  has at least one placement not overlapping any placed piece, and
+  that each empty cubicle is still covered by at least one such
+  placement. If not, the piece is removed as per an orphan check
+  (and counted as an orphan). Finds dead ends earlier than -O, but
+  costs more per placement, so may be faster or slower depending on
+  figure. Can be combined with any of -O, -D, -S, and -b.
+
+Engine variants (--rotation, --std-set, and -s options):
+  Alternate implementations of rotating shapes (3x3 matrices or
+  coordinate-permuting lambda functions) and of the sets of already
+  found solutions for -D (std::set or std::unordered_set), and whether
+  to keep the -s statistics, are all compiled in and chosen once per
+  figure, so there is no extra cost while searching. Solutions are
+  the same regardless, only speed differs.
+
+Solution numbering (-k, --unrank, and --sample options):
+  Solutions are numbered in a fixed order: the lowest-numbered empty
+  cubicle is filled by each piece in -P order in turn, in each of its
+  placements. Counting once per figure how many solutions complete
+  each partial solution lets --unrank go straight to any solution
+  number, and --sample pick uniformly random ones, one piece at a
+  time. Unique solutions (unless -r) are those first, comparing the
+  cubicles of each piece, of their rotations/reflections, numbered
+  in that order; listing them takes one pass over all solutions.
+  --sample keeps each random solution with probability in inverse
+  proportion to its number of distinct rotations/reflections, so each
+  unique solution is equally likely. Figures with separated shapes
+  are only numbered with -r.
+
+Solution diagrams (--zdd and --read-zdd options):
+  A zero-suppressed decision diagram holds all solutions (including
+  rotations/reflections) in one compact file per figure, named as
+  the figure's file without directory or extension. Partial
+  solutions leaving the same cubicles empty and the same pieces
+  unused share their completions, so the diagram is several times
+  smaller than "-a -r" output (more so the more solutions), and is
+  built in a fraction of the time. --read-zdd reads it back (as can
+  other programs, see zdd.hxx) to count, number (--unrank, as with
+  -r), or randomly sample solutions without solving the figure
+  again. With --query, it counts and samples only solutions matching
+  EXPR as per --store stores below, but with "&" only: each term
+  excludes the piece's placements not covering (or, with "!",
+  covering) the cubicle.
+
+Solution stores (--store and --query options):
+  --store records each solution found (so unique ones unless -r,
+  all of them with -c) once, as the number of each piece's placement,
+  plus for each piece and cubicle a bitmap of the solutions in which
+  the piece covers the cubicle. --query then answers questions about
+  a figure's solutions from those bitmaps, without solving it again.
+  EXPR is terms joined by "&" (and) and "|" (or, evaluated after all
+  "&"), each term a piece name, "@", and the "x,y,z" coordinates of a
+  cubicle as per the API (see Soma::solution(): twice the figure's
+  positions, centered on its bounding box), optionally preceded by
+  "!" (not). For example "t@-2,-2,-2|t@2,-2,-2" for the "t" piece
+  covering either of two corners. With -a, also lists each matching
+  solution's number in the store (from 1) and the coordinates of the
+  cubicles covered by each piece, decoded from its recorded
+  placement numbers.
+
+Marginals (--marginals option):
+  Counts, in one pass, how many of all solutions (including
+  rotations/reflections, as with -r) use each placement of each
+  piece, so answers many "is there a solution with this piece here"
+  questions at once instead of one pre-placed figure each. Prints,
+  per piece, how many of its placements are in some solution and
+  the cubicles of any placement in all of them (forced), then a
+  table of the number of solutions in which each piece covers each
+  cubicle (coordinates as for --query).
+
+Near misses (--near-miss option):
+  Tries every move of one cubicle (not of a pre-placed piece) to an
+  empty position next to the rest of the figure, and lists the moves
+  after which the figure has a solution, as "x,y,z -> x,y,z" positions
+  as per -i (from 0 in the figure file, so a new position can be -1).
+  Only the changed cubicle's piece placements are recomputed per move,
+  and each distinct figure (up to rotation/reflection) is checked
+  once, as per -x. Useful for fixing unsolvable ("#") figures.
+
+Catalog (--catalog option):
+  Generates every connected 27-cube figure whose bounding box is
+  exactly X by Y by Z (27 to 64 cells), once each up to rotations and
+  reflections of the box, and writes each one having a solution (as
+  per -x) in figure file format, preceded by a "# N solutions" comment
+  with its number of solutions (as per -c, -m), then a summary comment.
+  ",support": every cube above the bottom layer rests on one below.
+  ",symmetric": figure equal to some rotation/reflection of itself.
+  Figures are built cube by cube in memory with no file I/O, so
+  mostly counting solutions takes the time. Figure files are ignored.
+
+Sweep (--sweep option):
+  FILE has one configuration per line, any of "-O <steps>",
+  "-D <steps>", "-S <steps>", "-P <order>", "-b", and "-F" as above
+  (others from commandline), with "#" comments. Each figure is read
+  and analyzed once, then its solutions are counted (as per -c) with
+  each configuration in turn. Prints one line per configuration:
+  total solutions, number of figures whose count differs from the
+  first configuration's (each listed below it), and with -t solving
+  seconds. For comparing tuning option values on many figures.
+
+Hints (--hint option):
+  FILE has one command per line, with "#" comments: "place <piece>
+  <N>" puts the piece in its Nth placement (from 0, in the order
+  counted by --marginals), "undo" removes the last piece placed,
+  "count" prints the number of all solutions (including
+  rotations/reflections) completing the pieces placed, and "moves"
+  prints, per unused piece, how many of its placements still lead
+  to a solution and their total solutions (always the count, as
+  each solution uses one of them). place and undo also print the
+  count, or "not possible". Counts are remembered per set of empty
+  cubicles and unused pieces, so each takes a few table lookups once
+  explored. Prints the pieces placed at the end.
 
 Piece order (-P option):
   Order in which solver will attempt to place pieces into shape. Affects
@@ -733,6 +2766,16 @@ Piece order (-P option):
   "n" must be contiguous, in that order, if -D option is enabled for
   either.
 
+Pair anchoring (-A option):
+  Pieces are normally placed by their central cube into each empty
+  cubicle of shape, in each of their orientations. The "p", "n", and
+  "z" pieces can instead be placed by the one of their middle pair of
+  cubes whose partner is in the +X, +Y, or +Z direction. Same placements
+  in different order, so same solutions but possibly found in different
+  order and with slightly different performance. Required for symmetry
+  checking, because piece's own symmetries exchange middle pair of cubes
+  (so are done automatically for pieces in -S option).
+
 File format:
   - Z slices of SOMA figure, separated by blank line(s)
   - Each slice: Y lines of X cubicles
@@ -762,8 +2805,8 @@ File format:
   - Figures with multiple separated shapes accepted (useful for forcing
     specific solutions, and for additional removal of reflections/rotations)
   - Pre-placed pieces checked for correct number of cubicles (3 for "3" piece,
-    4 for all others) but not for geometric shape (if wrong will produce
-    incorrect solutions)
+    4 for all others) and geometric shape ("p" and "n" may be swapped if
+    both pre-placed)
   - Tab characters not allowed except after "#" comment character
 
 )END_OF_TEXT";
@@ -804,19 +2847,65 @@ int parse_arguments(
 int           argc            ,
 char        **argv            ,
 std::string  &output_filename ,
-bool         &all_solutions   ,
 bool         &reflects_rotates,
 unsigned     &orphans         ,
 unsigned     &duplicates      ,
 unsigned     &symmetries      ,
 std::string  &piece_order     ,
-#ifdef SOMA_STATISTICS
-bool         &statistics          ,
-#endif
-bool         &print_time      ,
-bool         &count_only      ,
-bool         &print_name      )
+std::string  &pair_anchored   ,
+bool         &symmetry_breaking,
+bool         &forward_checking,
+Engine       &engine          ,
+std::string  &counters_filename,
+std::string  &trace_filename  ,
+Catalog      &catalog         ,
+std::string  &sweep_filename  ,
+std::string  &hint_filename   ,
+Options      &options         )
 {
+    // long-only options, values outside of char range
+    enum {
+        CHECKPOINT_OPTION = 0x100,
+        INTERVAL_OPTION          ,
+        RESUME_OPTION            ,
+        DEADLINE_OPTION          ,
+        ROTATION_OPTION          ,
+        STD_SET_OPTION           ,
+        SAMPLE_OPTION            ,
+        UNRANK_OPTION            ,
+        ZDD_OPTION               ,
+        READ_ZDD_OPTION          ,
+        STORE_OPTION             ,
+        QUERY_OPTION             ,
+        MARGINALS_OPTION         ,
+        NEAR_MISS_OPTION         ,
+        CATALOG_OPTION           ,
+        SWEEP_OPTION             ,
+        HINT_OPTION              ,
+        PROGRESS_OPTION          ,
+    };
+    static const struct option  LONG_OPTIONS[] = {
+        {"checkpoint"         , required_argument, 0, CHECKPOINT_OPTION},
+        {"checkpoint-interval", required_argument, 0, INTERVAL_OPTION  },
+        {"resume"             , required_argument, 0, RESUME_OPTION    },
+        {"deadline"           , required_argument, 0, DEADLINE_OPTION  },
+        {"rotation"           , required_argument, 0, ROTATION_OPTION  },
+        {"std-set"            , required_argument, 0, STD_SET_OPTION   },
+        {"sample"             , required_argument, 0, SAMPLE_OPTION    },
+        {"unrank"             , required_argument, 0, UNRANK_OPTION    },
+        {"zdd"                , required_argument, 0, ZDD_OPTION       },
+        {"read-zdd"           , required_argument, 0, READ_ZDD_OPTION  },
+        {"store"              , required_argument, 0, STORE_OPTION     },
+        {"query"              , required_argument, 0, QUERY_OPTION     },
+        {"marginals"          , no_argument      , 0, MARGINALS_OPTION },
+        {"near-miss"          , no_argument      , 0, NEAR_MISS_OPTION },
+        {"catalog"            , required_argument, 0, CATALOG_OPTION   },
+        {"sweep"              , required_argument, 0, SWEEP_OPTION     },
+        {"hint"               , required_argument, 0, HINT_OPTION      },
+        {"progress"           , required_argument, 0, PROGRESS_OPTION  },
+        {0                    , 0                , 0, 0                },
+    };
+
     int             option_letter;
     std::string     orphans_chars   (DEFAULT_ORPHANS_CHARS   ),
                     duplicates_chars(DEFAULT_DUPLICATES_CHARS),
@@ -826,36 +2915,261 @@ bool         &print_name      )
                     copyright     = true ,
                     warranty      = false;
 
-    piece_order = Soma::DEFAULT_PIECE_ORDER;
+    piece_order   = Soma::DEFAULT_PIECE_ORDER  ;
+    pair_anchored = Soma::DEFAULT_PAIR_ANCHORED;
 
     // defaults (orphans, duplicates, and symmetries set below)
-    all_solutions    = false;
-    reflects_rotates = false;
-#ifdef SOMA_STATISTICS
-    statistics       = false;
-#endif
-    print_time       = false;
-    count_only       = false;
-    print_name       = false;
-    output_filename  = "-"  ;
-
-    while (  (option_letter = getopt(argc, argv, "arl:L:tcno:O:D:S:P:hHsqw"))
-           != EOF                                                          )
+    reflects_rotates  = false   ;
+    symmetry_breaking = false   ;
+    forward_checking  = false   ;
+    engine            = Engine();
+    output_filename   = "-"     ;
+    counters_filename = ""      ;
+    trace_filename    = ""      ;
+    catalog.box.fill(0)         ;
+    catalog.rules     = 0       ;
+    sweep_filename    = ""      ;
+    hint_filename     = ""      ;
+
+    options.print_name        = false;
+    options.count_only        = false;
+    options.existence         = false;
+    options.decompose         = false;
+    options.join              = false;
+    options.explain           = false;
+    options.all_solutions     = false;
+    options.print_time        = false;
+    options.marginals         = false;
+    options.near_miss         = false;
+    options.diagram_directory = ""   ;
+    options.read_directory    = ""   ;
+    options.store_directory   = ""   ;
+    options.query_expression  = ""   ;
+    options.hints.clear()            ;
+    options.estimate_probes   = 0    ;
+    options.estimate_seed     = 1    ;
+    options.progress_probes   = 0    ;
+    options.progress_seed     = 1    ;
+    options.ranking.count     = false;
+    options.ranking.samples   = 0    ;
+    options.ranking.seed      = 1    ;
+    options.ranking.number    = 0    ;
+    options.limits.checkpoint_filename = ""  ;
+    options.limits.resume_filename     = ""  ;
+    options.limits.checkpoint_interval = 60.0;
+    options.limits.deadline            =  0.0;
+    options.counters_output   = 0    ;
+
+    while (  (option_letter = getopt_long(
+                                argc                                ,
+                                argv                                ,
+                                "arbFl:L:tcxdmkino:O:D:S:P:A:j:T:e:hHsqw",
+                                LONG_OPTIONS                        ,
+                                0                                   ))
+           != EOF                                                     )
         switch (option_letter) {
-            case 'a': all_solutions     = true    ; break;
+            case 'a': options.all_solutions = true; break;
             case 'r': reflects_rotates  = true    ; break;
-            case 't': print_time        = true    ; break;
-            case 'n': print_name        = true    ; break;
+            case 'b': symmetry_breaking = true    ; break;
+            case 'F': forward_checking  = true    ; break;
+            case 't': options.print_time    = true; break;
+            case 'n': options.print_name    = true; break;
             case 'o': output_filename   = ::optarg; break;
             case 'O': orphans_chars     = ::optarg; break;
             case 'D': duplicates_chars  = ::optarg; break;
             case 'S': symmetries_chars  = ::optarg; break;
-#ifdef SOMA_STATISTICS
-            case 's': statistics        = true    ; break;
-#endif
+            case 'j': counters_filename = ::optarg; break;
+            case 'T': trace_filename    = ::optarg; break;
+
+            case CHECKPOINT_OPTION:
+                options.limits.checkpoint_filename = ::optarg;
+                break;
+
+            case RESUME_OPTION:
+                options.limits.resume_filename = ::optarg;
+                break;
+
+            case ROTATION_OPTION:
+                if (std::string(::optarg) == "matrix")
+                    engine.lambda_rotation = false;
+                else if (std::string(::optarg) == "lambda")
+                    engine.lambda_rotation = true;
+                else {
+                    std::cerr << "--rotation option must be either "
+                                 "\"matrix\" or \"lambda\""
+                              << std::endl;
+                    return -1;
+                }
+                break;
+
+            case STD_SET_OPTION:
+                if (std::string(::optarg) == "set")
+                    engine.ordered_sets = true;
+                else if (std::string(::optarg) == "unordered")
+                    engine.ordered_sets = false;
+                else {
+                    std::cerr << "--std-set option must be either "
+                                 "\"set\" or \"unordered\""
+                              << std::endl;
+                    return -1;
+                }
+                break;
+
+            case INTERVAL_OPTION:
+            case DEADLINE_OPTION: {
+                char            *end;
+                const double     seconds = strtod(::optarg, &end);
+                if (*end != '\0' || seconds <= 0.0) {
+                    std::cerr << "--"
+                              << (option_letter == INTERVAL_OPTION
+                                  ? "checkpoint-interval" : "deadline")
+                              << " option must be number of seconds > 0"
+                              << std::endl;
+                    return -1;
+                }
+                if (option_letter == INTERVAL_OPTION)
+                    options.limits.checkpoint_interval = seconds;
+                else
+                    options.limits.deadline            = seconds;
+                break;
+            }
+
+            case SAMPLE_OPTION: {
+                char    *end;
+                options.ranking.samples = strtoul(::optarg, &end, 10);
+                if (*end == ',')
+                    options.ranking.seed = strtoull(end + 1, &end, 10);
+                if (*end != '\0' || options.ranking.samples == 0) {
+                    std::cerr << "--sample option must be number of "
+                                 "solutions > 0, optionally followed by "
+                                 ",<seed>"
+                              << std::endl;
+                    return -1;
+                }
+                break;
+            }
+
+            case UNRANK_OPTION: {
+                char    *end;
+                options.ranking.number = strtoull(::optarg, &end, 10);
+                if (*end != '\0' || options.ranking.number == 0) {
+                    std::cerr << "--unrank option must be solution "
+                                 "number > 0"
+                              << std::endl;
+                    return -1;
+                }
+                break;
+            }
+
+            case ZDD_OPTION:
+                options.diagram_directory = ::optarg;
+                break;
+
+            case READ_ZDD_OPTION:
+                options.read_directory = ::optarg;
+                break;
+
+            case STORE_OPTION:
+                options.store_directory = ::optarg;
+                break;
+
+            case SWEEP_OPTION:
+                sweep_filename = ::optarg;
+                break;
+
+            case HINT_OPTION:
+                hint_filename = ::optarg;
+                break;
+
+            case PROGRESS_OPTION: {
+                char    *end;
+                options.progress_probes = strtoul(::optarg, &end, 10);
+                if (*end == ',')
+                    options.progress_seed = strtoull(end + 1, &end, 10);
+                if (*end != '\0' || options.progress_probes == 0) {
+                    std::cerr << "--progress option must be number of "
+                                 "probes > 0, optionally followed by ,<seed>"
+                              << std::endl;
+                    return -1;
+                }
+                break;
+            }
+
+            case MARGINALS_OPTION:
+                options.marginals = true;
+                break;
+
+            case NEAR_MISS_OPTION:
+                options.near_miss = true;
+                break;
+
+            case CATALOG_OPTION: {
+                char            *end  = ::optarg;
+                bool             good = true    ;
+                for (unsigned axis = 0 ; axis < 3 ; ++axis) {
+                    catalog.box[axis] = strtoul(end, &end, 10);
+                    if (axis < 2 && *end++ != 'x')
+                        good = false;
+                    if (!good || catalog.box[axis] == 0)
+                        break;
+                }
+                const unsigned   cells =   catalog.box[0]
+                                         * catalog.box[1]
+                                         * catalog.box[2];
+                std::istringstream  rules(good && *end == ',' ? end + 1 : "");
+                std::string         rule ;
+                while (std::getline(rules, rule, ','))
+                    if (rule == "support")
+                        catalog.rules |= Enumerate::SUPPORTED;
+                    else if (rule == "symmetric")
+                        catalog.rules |= Enumerate::SYMMETRIC;
+                    else
+                        good = false;
+                if (   !good
+                    || (*end != '\0' && *end != ',')
+                    || cells > Enumerate::MAX_CELLS
+                    || cells < Shape::NUMBER_OF_CUBICLES) {
+                    std::cerr << "--catalog option must be box <X>x<Y>x<Z> "
+                                 "of 27 to 64 cells, optionally followed "
+                                 "by ,support and/or ,symmetric"
+                              << std::endl;
+                    return -1;
+                }
+                break;
+            }
+
+            case QUERY_OPTION:
+                options.query_expression = ::optarg;
+                if (options.query_expression.empty()) {
+                    std::cerr << "--query option must be non-empty "
+                                 "expression"
+                              << std::endl;
+                    return -1;
+                }
+                break;
+
+            case 'e': {
+                char    *end;
+                options.estimate_probes = strtoul(::optarg, &end, 10);
+                if (*end == ',')
+                    options.estimate_seed = strtoull(end + 1, &end, 10);
+                if (*end != '\0' || options.estimate_probes == 0) {
+                    std::cerr << "-e option must be number of probes > 0, "
+                                 "optionally followed by ,<seed>"
+                              << std::endl;
+                    return -1;
+                }
+                break;
+            }
+            case 's': engine.statistics = true    ; break;
+            case 'x': options.existence     = true; break;
+            case 'd': options.decompose     = true; break;
+            case 'm': options.join          = true; break;
+            case 'k': options.ranking.count = true; break;
+            case 'i': options.explain       = true; break;
             case 'c':
-                count_only    = true;
-                all_solutions = true;
+                options.count_only    = true;
+                options.all_solutions = true;
                 break;
 
             case 'P':
@@ -887,6 +3201,23 @@ bool         &print_name      )
                               << std::endl;
                 break;
 
+            case 'A':
+                pair_anchored = ::optarg;
+                if (pair_anchored == "0")
+                    pair_anchored.clear();
+                for (char piece : pair_anchored)
+                    if (   std::string("pnz").find(piece) == std::string::npos
+                        ||    std::count(pair_anchored.begin(),
+                                         pair_anchored.end  (),
+                                         piece                )
+                           != 1                                ) {
+                        std::cerr << "-A option string must be any of "
+                                     "\"pnz\", each at most once, or 0"
+                                  << std::endl;
+                        return -1;
+                    }
+                break;
+
             case 'q':
                 copyright = false;
                 break;
@@ -922,7 +3253,10 @@ bool         &print_name      )
                 orphans_chars            .c_str(),
                 duplicates_chars         .c_str(),
                 symmetries_chars         .c_str(),
-                Soma::DEFAULT_PIECE_ORDER.c_str());
+                Soma::DEFAULT_PIECE_ORDER.c_str(),
+                  Soma::DEFAULT_PAIR_ANCHORED.empty()
+                ? "0"
+                : Soma::DEFAULT_PAIR_ANCHORED.c_str());
 
     if (extended_help)
         fprintf(stdout                           ,
@@ -931,7 +3265,10 @@ bool         &print_name      )
                 orphans_chars   .c_str()         ,
                 duplicates_chars.c_str()         ,
                 symmetries_chars.c_str()         ,
-                Soma::DEFAULT_PIECE_ORDER.c_str());
+                Soma::DEFAULT_PIECE_ORDER.c_str(),
+                  Soma::DEFAULT_PAIR_ANCHORED.empty()
+                ? "0"
+                : Soma::DEFAULT_PAIR_ANCHORED.c_str());
 
     if (warranty || help || extended_help)
         return -1;
@@ -940,7 +3277,29 @@ bool         &print_name      )
     if (!parse_steps(duplicates, duplicates_chars, "-D")) return -1;
     if (!parse_steps(symmetries, symmetries_chars, "-S")) return -1;
 
-    if (reflects_rotates) symmetries = duplicates = 0;
+    if (   !options.count_only
+        && (options.decompose || options.join || options.ranking.count))
+        std::cerr << "Warning: -d, -m, and -k only apply with -c, "
+                     "ignored"
+                  << std::endl;
+
+    // only ever one witness solution, so not numbered as if listing all
+    if (options.existence)
+        options.all_solutions = false;
+
+    if (catalog.box[0] && ::optind < argc) {
+        std::cerr << "--catalog generates figures, can't also solve "
+                     "figure files ("
+                  << argv[::optind]
+                  << " ...)"
+                  << std::endl;
+        return -1;
+    }
+
+    if (reflects_rotates) {
+        symmetries = duplicates = 0;
+        symmetry_breaking       = false;
+    }
 
     return  ::optind;
 
@@ -20,7 +20,6 @@
 
 #include <assert.h>
 #include <map>
-#include <set>
 
 #include "rotators.hxx"
 #include "shape.hxx"
@@ -31,17 +30,43 @@
 
 namespace soma {
 
+// Piece geometry, non-central cubes. Single source for both the public
+//   Piece objects below and the compile-time tables further below.
+//
+namespace {
+
+// Indexed by Piece::code() - 1
+constexpr unsigned  NUMBER_OF_CUBES[Piece::NUMBER_OF_PIECES]
+                  = {3, 3, 3, 3, 3, 3, 2};
+constexpr int   CUBES[Piece::NUMBER_OF_PIECES][Piece::MAX_NUMBER_OF_CUBES][3]
+              = { { { 1, 0, 0}, { 0, 1, 0}, { 0, 0, 1} },   // c
+                  { { 1, 0, 0}, { 1, 1, 0}, { 0, 0, 1} },   // p
+                  { {-1, 0, 0}, {-1, 1, 0}, { 0, 0, 1} },   // n
+                  { { 1, 1, 0}, { 0, 1, 0}, {-1, 0, 0} },   // z
+                  { { 1, 0, 0}, { 0, 1, 0}, {-1, 0, 0} },   // t
+                  { { 1, 1, 0}, { 1, 0, 0}, {-1, 0, 0} },   // l
+                  { { 1, 0, 0}, { 0, 1, 0}, { 0, 0, 0} } }; // 3
+
+}  // namespace
+
+
+
 // public class data   ========================================================
 
-#define P  Position
+#define P(CODE, NDX)  Position(CUBES[CODE - 1][NDX][0],   \
+                               CUBES[CODE - 1][NDX][1],   \
+                               CUBES[CODE - 1][NDX][2])
+#define CUBES_OF(CODE)  NUMBER_OF_CUBES[CODE - 1],                 \
+                        P(CODE, 0), P(CODE, 1), P(CODE, 2)
 Piece
-    Piece::corner(3, P( 1, 0, 0), P( 0, 1, 0), P( 0, 0, 1), 'c', 1),
-    Piece::   pos(3, P( 1, 0, 0), P( 1, 1, 0), P( 0, 0, 1), 'p', 2),
-    Piece::   neg(3, P(-1, 0, 0), P(-1, 1, 0), P( 0, 0, 1), 'n', 3),
-    Piece::   zee(3, P( 1, 1, 0), P( 0, 1, 0), P(-1, 0, 0), 'z', 4),
-    Piece::   tee(3, P( 1, 0, 0), P( 0, 1, 0), P(-1, 0, 0), 't', 5),
-    Piece::   ell(3, P( 1, 1, 0), P( 1, 0, 0), P(-1, 0, 0), 'l', 6),
-    Piece:: three(2, P( 1, 0, 0), P( 0, 1, 0), P( 0, 0, 0), '3', 7);
+    Piece::corner(CUBES_OF(1), 'c', 1),
+    Piece::   pos(CUBES_OF(2), 'p', 2),
+    Piece::   neg(CUBES_OF(3), 'n', 3),
+    Piece::   zee(CUBES_OF(4), 'z', 4),
+    Piece::   tee(CUBES_OF(5), 't', 5),
+    Piece::   ell(CUBES_OF(6), 'l', 6),
+    Piece:: three(CUBES_OF(7), '3', 7);
+#undef CUBES_OF
 #undef P
 
 const std::map<char, Piece*>    Piece::PIECE_NAMES = { {'c', &Piece::corner},
@@ -57,6 +82,225 @@ const char    Piece::CODE_TO_NAME[Piece::NUMBER_OF_PIECES + 1]
             = {'#', 'c', 'p', 'n', 'z', 't', 'l', '3'};
 
 
+
+// Compile-time versions of pair_partner(), and of generate_orientations()
+//   for both normal and pair-anchored orientations, so that constructing
+//   Soma objects, and changing pieces' pair-anchoring, only copies
+//   tables. Plain ints because Position isn't constexpr-usable.
+//
+namespace {
+
+// Including central cube
+constexpr unsigned  MAX_CUBES = Piece::MAX_NUMBER_OF_CUBES + 1;
+
+struct Orientations {
+    unsigned    count;
+    int         cubes[Rotators::MAX_NUMBER_OF_ORIENTATIONS]
+                     [Piece::MAX_NUMBER_OF_CUBES              ]
+                     [3                                       ];
+    unsigned    axes [Rotators::MAX_NUMBER_OF_ORIENTATIONS];  // if paired
+};
+
+struct Tables {
+    unsigned        partner;  // see Piece::pair_partner()
+    Orientations    normal ,
+                    paired ;
+};
+
+
+constexpr int rotate_axis(
+const int       cube[3] ,
+const unsigned  rotation,
+const unsigned  axis    )
+{
+    return   Rotators::AXES[rotation][axis] > 0
+           ?  cube[ Rotators::AXES[rotation][axis] - 1]
+           : -cube[-Rotators::AXES[rotation][axis] - 1];
+}
+
+
+// Same set of cubes, in any order
+constexpr bool same_cubes(
+const int       these[][3],
+const int       those[][3],
+const unsigned  size      )
+{
+    for (unsigned this_ndx = 0 ; this_ndx < size ; ++this_ndx) {
+        bool    found = false;
+        for (unsigned that_ndx = 0 ; that_ndx < size ; ++that_ndx)
+            if (   these[this_ndx][0] == those[that_ndx][0]
+                && these[this_ndx][1] == those[that_ndx][1]
+                && these[this_ndx][2] == those[that_ndx][2])
+                found = true;
+        if (!found)
+            return false;
+    }
+
+    return true;
+}
+
+
+// See Piece::pair_partner() for rules
+constexpr unsigned pair_partner(
+const int       cubes[][3],   // including central
+const unsigned  size      )
+{
+    if (size != MAX_CUBES)
+        return 0;
+
+    unsigned    degrees[MAX_CUBES] = {0},
+                adjacents          =  0 ;
+
+    for (unsigned from = 0 ; from < size ; ++from)
+        for (unsigned to = from + 1 ; to < size ; ++to) {
+            int     distance = 0;
+            for (unsigned axis = 0 ; axis < 3 ; ++axis)
+                distance +=   cubes[from][axis] > cubes[to][axis]
+                            ? cubes[from][axis] - cubes[to][axis]
+                            : cubes[to][axis] - cubes[from][axis];
+            if (distance == 1) {
+                ++degrees[from];
+                ++degrees[to  ];
+                ++adjacents;
+            }
+        }
+
+    unsigned    middles = 0,
+                partner = 0;
+    for (unsigned ndx = 0 ; ndx < size ; ++ndx)
+        if (degrees[ndx] == 2) {
+            ++middles;
+            if (ndx > 0 && partner == 0)
+                partner = ndx;
+        }
+
+    if (adjacents != MAX_CUBES - 1 || degrees[0] != 2 || middles != 2)
+        return 0;
+
+    for (unsigned ndx = 0 ; ndx < size ; ++ndx)
+        for (unsigned axis = 0 ; axis < 3 ; ++axis)
+            if (   cubes[ndx][axis] - cubes[partner][axis] >  1
+                || cubes[ndx][axis] - cubes[partner][axis] < -1)
+                return 0;
+
+    return partner;
+}
+
+
+// Normal orientations are unique by set of cubes after centering on
+//   bounding box (central cube of e.g. "t" and "l" can be rotated
+//   elsewhere) then rotating, but are rotations of uncentered cubes.
+// Pair-anchored orientations are offsets of other cubes from whichever
+//   of middle pair has its partner in positive x, y, or z direction
+//   (that axis saved for Shape::is_primary_pair()), and unique by set
+//   of offsets.
+constexpr Tables tables(
+const unsigned  piece_ndx)
+{
+    Tables          result    = {};
+    const unsigned  size      = NUMBER_OF_CUBES[piece_ndx] + 1;
+    int             cubes     [MAX_CUBES][3] = {},  // [0] is central
+                    centereds [MAX_CUBES][3] = {},
+                    uniques   [Rotators::MAX_NUMBER_OF_ORIENTATIONS]
+                              [MAX_CUBES                           ]
+                              [3                                   ] = {};
+
+    for (unsigned ndx = 1 ; ndx < size ; ++ndx)
+        for (unsigned axis = 0 ; axis < 3 ; ++axis)
+            cubes[ndx][axis] = CUBES[piece_ndx][ndx - 1][axis];
+
+    result.partner = pair_partner(cubes, size);
+
+    // As per Position::normalize() and Position::center()
+    for (unsigned axis = 0 ; axis < 3 ; ++axis) {
+        int     min = 0,
+                max = 0;
+        for (unsigned ndx = 0 ; ndx < size ; ++ndx) {
+            if (cubes[ndx][axis] < min) min = cubes[ndx][axis];
+            if (cubes[ndx][axis] > max) max = cubes[ndx][axis];
+        }
+        for (unsigned ndx = 0 ; ndx < size ; ++ndx)
+            centereds[ndx][axis] = 2 * (cubes[ndx][axis] - min) - (max - min);
+    }
+
+    for (unsigned     rotation = 0                                    ;
+                      rotation < Rotators::MAX_NUMBER_OF_ORIENTATIONS ;
+                    ++rotation                                         ) {
+        int     rotated[MAX_CUBES][3] = {},
+                offsets[MAX_CUBES][3] = {};
+
+        // Normal: unique by rotated centered cubes
+        Orientations    &normal = result.normal;
+        for (unsigned ndx = 0 ; ndx < size ; ++ndx)
+            for (unsigned axis = 0 ; axis < 3 ; ++axis)
+                uniques[normal.count][ndx][axis]
+                = rotate_axis(centereds[ndx], rotation, axis);
+
+        bool    unique = true;
+        for (unsigned ndx = 0 ; ndx < normal.count ; ++ndx)
+            if (same_cubes(uniques[ndx], uniques[normal.count], size))
+                unique = false;
+
+        if (unique) {
+            for (unsigned ndx = 1 ; ndx < size ; ++ndx)
+                for (unsigned axis = 0 ; axis < 3 ; ++axis)
+                    normal.cubes[normal.count][ndx - 1][axis]
+                    = rotate_axis(cubes[ndx], rotation, axis);
+            ++normal.count;
+        }
+
+        if (!result.partner)
+            continue;
+
+        // Pair-anchored: unique by offsets from anchor cube, which is
+        //   one of middle pair with partner in positive direction
+        Orientations    &paired = result.paired;
+        for (unsigned ndx = 0 ; ndx < size ; ++ndx)
+            for (unsigned axis = 0 ; axis < 3 ; ++axis)
+                rotated[ndx][axis] = rotate_axis(cubes[ndx], rotation, axis);
+
+        unsigned    axis = 0;
+        while (rotated[result.partner][axis] == rotated[0][axis])
+            ++axis;
+        const unsigned  anchor =   rotated[result.partner][axis]
+                                 < rotated[0][axis]
+                                 ? result.partner
+                                 : 0;
+
+        unsigned    offset = 0;
+        for (unsigned ndx = 0 ; ndx < size ; ++ndx)
+            if (ndx != anchor) {
+                for (unsigned xyz = 0 ; xyz < 3 ; ++xyz)
+                    offsets[offset][xyz] =   rotated[ndx   ][xyz]
+                                           - rotated[anchor][xyz];
+                ++offset;
+            }
+
+        unique = true;
+        for (unsigned ndx = 0 ; ndx < paired.count ; ++ndx)
+            if (same_cubes(paired.cubes[ndx], offsets, size - 1))
+                unique = false;
+
+        if (unique) {
+            for (unsigned ndx = 0 ; ndx < size - 1 ; ++ndx)
+                for (unsigned xyz = 0 ; xyz < 3 ; ++xyz)
+                    paired.cubes[paired.count][ndx][xyz]
+                    = offsets[ndx][xyz];
+            paired.axes[paired.count++] = axis;
+        }
+    }
+
+    return result;
+}
+
+constexpr Tables    TABLES[Piece::NUMBER_OF_PIECES] = { tables(0), tables(1),
+                                                        tables(2), tables(3),
+                                                        tables(4), tables(5),
+                                                        tables(6)            };
+
+}  // namespace
+
+
 // See piece.hxx
 Piece::Piece(
 int                 number_of_cubes,
@@ -68,18 +312,16 @@ uint8_t             code           )
 :   _number_of_cubes    (number_of_cubes ),
     _name               (name            ),
     _code               (code            ),
+    _pair_anchored      (false           ),
+    _counters           (0               ),
     _pre_placed         (false           ),
     _current_position   (-1              ),
-    _current_orientation(0               )
-#ifdef SOMA_STATISTICS
-                                          ,
-     _place_successes   (0               ),
-     _place_failures    (0               ),
-     _place_duplicates  (0               ),
-     _place_orphans     (0               ),
-     _total_valid_orients(0              )
-#endif
-
+    _current_orientation(0               ),
+    _place_successes    (0               ),
+    _place_failures     (0               ),
+    _place_duplicates   (0               ),
+    _place_orphans      (0               ),
+    _total_valid_orients(0               )
 {
     // GCC can't handle this in colon initializer list
     _cubes[0] = cube_0;
@@ -90,69 +332,64 @@ uint8_t             code           )
 
 
 // See piece.hxx
-void Piece::generate_orientations()
+unsigned Piece::pair_partner()
+const
 {
-    // +1 because includes central cube
-    std::array<Position, MAX_NUMBER_OF_CUBES + 1>   centered_cubes;
-
-    // Initialize and center
-    centered_cubes[0] = Position(0, 0, 0);  // central cube
-    // other cubes
-    for (unsigned ndx = 0 ; ndx < _number_of_cubes ; ++ndx)
-        centered_cubes[ndx + 1] = _cubes[ndx];
-    Position    maxes = Position::normalize<Position,
-                                            std::array<Position,
-                                                         MAX_NUMBER_OF_CUBES
-                                                       + 1>>(
-                        centered_cubes, MAX_NUMBER_OF_CUBES + 1);
-
-    Position::center<Position, std::array<Position, MAX_NUMBER_OF_CUBES + 1>>
-    (centered_cubes, MAX_NUMBER_OF_CUBES + 1, maxes, false);
-
-    // Fill _orientations with only unique (not -rotated/mirrored duplicates)
-    std::vector<unsigned>               rotators_mirrorers;
-    std::set<std::set<Position>>        uniques;
-    // Can't do range-based for on Rotators::rotations
-    //   because has plain, z-, and x-mirrored versions
-    for (unsigned     rotation_ndx = 0                                    ;
-                      rotation_ndx < Rotators::MAX_NUMBER_OF_ORIENTATIONS ;
-                    ++rotation_ndx                                         ) {
-        const auto  rotation = Rotators::rotations[rotation_ndx];
-
-        // A rotated/mirrored orientation
-        Cubes       rotated_centereds;
-        for (unsigned     cube_ndx = 0                    ;
-                          cube_ndx < _number_of_cubes + 1 ;
-                        ++cube_ndx                         ) {
-              rotated_centereds[cube_ndx]
-            = centered_cubes[cube_ndx].rotate(rotation);
-        }
+    return TABLES[_code - 1].partner;
+
+}  // pair_partner() const
+
 
-        // For testing against already-generated
-        std::set<Position>  unordered;
-        for (const Position &cube : rotated_centereds)
-            unordered.insert(cube);
 
-        // See if duplicate of already generated
-        unsigned    before = uniques.size();
-        uniques.insert(unordered);
-        if (uniques.size() != before)
-            rotators_mirrorers.push_back(rotation_ndx);
+// See piece.hxx
+bool Piece::is_planar()
+const
+{
+    // Central cube is at 0,0,0
+    for (unsigned axis = 0 ; axis < 3 ; ++axis) {
+        bool    flat = true;
+        for (unsigned ndx = 0 ; ndx < _number_of_cubes ; ++ndx)
+            if (_cubes[ndx][axis] != 0)
+                flat = false;
+        if (flat)
+            return true;
     }
 
-    // Copy uniques into _orientations
-    for (unsigned rotator : rotators_mirrorers) {
-        Cubes   rotated;
-        rotate(rotated                     ,
-               _cubes                      ,
-               Rotators::rotations[rotator],
-               _number_of_cubes            );
-        _orientations.push_back(rotated);
+    return false;
+
+}  // is_planar() const
+
+
+
+// See piece.hxx
+bool Piece::generate_orientations(
+const bool  pair_anchored)
+{
+    _orientations.clear();
+    _pair_axes   .clear();
+    _pair_anchored = pair_anchored && pair_anchorable();
+
+    const Orientations  &orientations =   _pair_anchored
+                                        ? TABLES[_code - 1].paired
+                                        : TABLES[_code - 1].normal;
+
+    for (unsigned ndx = 0 ; ndx < orientations.count ; ++ndx) {
+        Cubes   cubes;
+        for (unsigned cube = 0 ; cube < _number_of_cubes ; ++cube)
+            cubes[cube] = Position(orientations.cubes[ndx][cube][0],
+                                   orientations.cubes[ndx][cube][1],
+                                   orientations.cubes[ndx][cube][2]);
+        _orientations.push_back(cubes);
+
+        if (_pair_anchored)
+            _pair_axes.push_back(orientations.axes[ndx]);
     }
 
     _current_orientation = 0;
 
-}  // generate_orientations()
+    return _pair_anchored || !pair_anchored;
+
+}  // generate_orientations(const bool)
 
 
 
@@ -175,9 +412,7 @@ const unsigned  piece_number)
                                 true                                 )) {
             _valid_orientations[cubicle_ndx].push_back(orientation_ndx);
         }
-#ifdef SOMA_STATISTICS
     _total_valid_orients += _valid_orientations[cubicle_ndx].size();
-#endif
 }
 
 
@@ -186,13 +421,127 @@ const unsigned  piece_number)
 bool Piece::place(
 unsigned    piece_number    ,
 bool        check_orphans   ,
-bool        check_duplicates)
+bool        check_duplicates,
+bool        check_canonical ,
+bool        check_forward   ,
+const Engine &engine        )
+{
+    return (this->*placer(check_orphans   ,
+                          check_duplicates,
+                          check_canonical ,
+                          check_forward   ,
+                          engine          ))(piece_number);
+
+}   // place()
+
+
+
+// See piece.hxx
+Piece::Placer Piece::placer(
+bool        check_orphans   ,
+bool        check_duplicates,
+bool        check_canonical ,
+bool        check_forward   ,
+const Engine &engine        )
+const
+{
+    return select_placer<>(check_orphans         ,
+                           check_duplicates      ,
+                           check_canonical       ,
+                           check_forward         ,
+                           engine.statistics     ,
+                           engine.lambda_rotation,
+                           engine.ordered_sets   ,
+                           _pair_anchored        );
+
+}   // placer(bool, bool, bool, bool, const Engine&) const
+
+
+
+// Each run-time flag in turn becomes next compile-time CHECKS value
+template<bool... CHECKS, typename... Flags>
+Piece::Placer Piece::select_placer(
+bool        flag ,
+Flags...    flags)
+const
+{
+    return   flag
+           ? select_placer<CHECKS..., true >(flags...)
+           : select_placer<CHECKS..., false>(flags...);
+
+}   // select_placer(bool, Flags...) const
+
+
+
+// All flags converted, only number of cubes left
+// Rotation and set variants are only used by duplicate checks, and
+//   only full-size pieces are pair-anchorable, so those combinations
+//   are folded instead of instantiating unreachable place_checked()s.
+template<bool       CHECK_ORPHANS   ,
+         bool       CHECK_DUPLICATES,
+         bool       CHECK_CANONICAL ,
+         bool       CHECK_FORWARD   ,
+         bool       STATISTICS      ,
+         bool       LAMBDA_ROTATION ,
+         bool       ORDERED_SETS    ,
+         bool       PAIR_ANCHORED   >
+Piece::Placer Piece::select_placer()
+const
+{
+    static const bool       LAMBDA  = CHECK_DUPLICATES && LAMBDA_ROTATION,
+                            ORDERED = CHECK_DUPLICATES && ORDERED_SETS   ;
+    static const unsigned   SMALLER =   PAIR_ANCHORED
+                                      ? MAX_NUMBER_OF_CUBES
+                                      : MAX_NUMBER_OF_CUBES - 1;
+
+    return   _number_of_cubes == MAX_NUMBER_OF_CUBES
+           ? &Piece::place_checked<CHECK_ORPHANS      ,
+                                   CHECK_DUPLICATES   ,
+                                   CHECK_CANONICAL    ,
+                                   CHECK_FORWARD      ,
+                                   STATISTICS         ,
+                                   LAMBDA             ,
+                                   ORDERED            ,
+                                   PAIR_ANCHORED      ,
+                                   MAX_NUMBER_OF_CUBES>
+           : &Piece::place_checked<CHECK_ORPHANS      ,
+                                   CHECK_DUPLICATES   ,
+                                   CHECK_CANONICAL    ,
+                                   CHECK_FORWARD      ,
+                                   STATISTICS         ,
+                                   LAMBDA             ,
+                                   ORDERED            ,
+                                   PAIR_ANCHORED      ,
+                                   SMALLER            >;
+
+}   // select_placer() const
+
+
+
+// See Placer in piece.hxx
+template<bool       CHECK_ORPHANS   ,
+         bool       CHECK_DUPLICATES,
+         bool       CHECK_CANONICAL ,
+         bool       CHECK_FORWARD   ,
+         bool       STATISTICS      ,
+         bool       LAMBDA_ROTATION ,
+         bool       ORDERED_SETS    ,
+         bool       PAIR_ANCHORED   ,
+         unsigned   NUMBER_OF_CUBES >
+bool Piece::place_checked(
+unsigned    piece_number)
 {
     // Do nothing if pre-placed, but still need to keep track of
     //   "placed" vs non for forward and backtracking in solution tree space.
     if (is_pre_placed()) {
-        if (_current_orientation == 0) {
+        if (   _current_orientation == 0
+            && (   !CHECK_CANONICAL
+                || _shape->is_canonical(piece_number, this))
+            && (   !CHECK_FORWARD
+                || _shape->forward_check(piece_number, this))) {
             ++_current_orientation;
+            if (_counters)
+                ++(*_counters)[piece_number].nodes;
             return true;
         }
         else {
@@ -206,13 +555,14 @@ bool        check_duplicates)
     //
     if (is_placed()) {
         _shape->remove_piece(this, piece_number);
-        if (!place_next()) {
+        if (!place_next<PAIR_ANCHORED>()) {
             _current_position = -1;
             return false;
         }
     }
     else {
-        _current_position = _shape->first_free();
+        _current_position    = PAIR_ANCHORED ? _shape->first_unoccupied()
+                                             : _shape->first_free      ();
         _current_orientation = 0;
 
         if (_current_position >= static_cast<int>(Shape::NUMBER_OF_CUBICLES)) {
@@ -226,18 +576,29 @@ bool        check_duplicates)
     while (true) {
         // Repeatedly try to place until success or place_next() finished
         while (   _valid_orientations[_current_position].size() == 0
-               || !_shape->place_piece(_current_position,
+               || (PAIR_ANCHORED && !primary_pair(piece_number))
+               || !_shape->place_piece<NUMBER_OF_CUBES>(
+                                       _current_position                   ,
                                        this                                ,
                                        piece_number                        ,
-                                       _number_of_cubes                    ,
                                        _orientations[
                                          _valid_orientations[
                                            _current_position][
                                              _current_orientation]].data())) {
-            if (!place_next())
+            if (   _counters
+                && _valid_orientations[_current_position].size()
+                && (!PAIR_ANCHORED || primary_pair(piece_number)))
+                ++(*_counters)[piece_number].tries;
+
+            if (!place_next<PAIR_ANCHORED>())
                 return false;   // no more positions/orientations to try
         }
 
+        if (_counters) {
+            ++(*_counters)[piece_number].tries;
+            ++(*_counters)[piece_number].fits ;
+        }
+
         // Has been placed, but might need to remove
         //
 
@@ -245,49 +606,212 @@ bool        check_duplicates)
         bool    is_duplicate = false,
                 has_orphan   = false;
 
-        // Do duplicate check first because is faster than orphan check
-        if (check_duplicates) {
-            if (!(is_duplicate = _shape->is_duplicate_solution(piece_number)))
-                _shape->add_solution(piece_number);
-#ifdef SOMA_STATISTICS
-            else
+        // Do duplicate checks first because are faster than orphan check
+        if (CHECK_CANONICAL && !_shape->is_canonical(piece_number, this)) {
+            is_duplicate = true;
+            if (_counters)
+                ++(*_counters)[piece_number].duplicates;
+            if (STATISTICS)
                 ++_place_duplicates;
-#endif
+        }
+        else if (CHECK_DUPLICATES) {
+            is_duplicate = _shape->is_duplicate_solution<ORDERED_SETS>(
+                                                                 piece_number);
+            if (!is_duplicate)
+                _shape->add_solution<LAMBDA_ROTATION, ORDERED_SETS>(
+                                                                 piece_number);
+            else {
+                if (_counters)
+                    ++(*_counters)[piece_number].duplicates;
+                if (STATISTICS)
+                    ++_place_duplicates;
+            }
         }
 
         // No need to check for orphans if already known to be duplicate
-        if (!is_duplicate && check_orphans && _shape->has_orphan()) {
+        if (!is_duplicate && CHECK_ORPHANS && _shape->has_orphan()) {
+            has_orphan = true;
+            if (_counters)
+                ++(*_counters)[piece_number].orphans;
+            if (STATISTICS)
+                ++_place_orphans;
+        }
+
+        // Slowest, so last
+        if (   !is_duplicate
+            && !has_orphan
+            && CHECK_FORWARD
+            && !_shape->forward_check(piece_number, this)) {
             has_orphan = true;
-#ifdef SOMA_STATISTICS
-            ++_place_orphans;
-#endif
+            if (_counters)
+                ++(*_counters)[piece_number].orphans;
+            if (STATISTICS)
+                ++_place_orphans;
         }
 
         if (is_duplicate || has_orphan) {
             _shape->remove_piece(this, piece_number);
-#ifdef SOMA_STATISTICS
-            ++_place_failures;
-#endif
+            if (STATISTICS)
+                ++_place_failures;
 
             // See if any more positins/orientations
-            if (!place_next())
+            if (!place_next<PAIR_ANCHORED>())
                 return false;
         }
         else
             break;
     }
 
-#ifdef SOMA_STATISTICS
-    ++_place_successes;
-#endif
+    if (_counters)
+        ++(*_counters)[piece_number].nodes;
+    if (STATISTICS)
+        ++_place_successes;
 
     return true;   // piece is now placed in shape
 
-}   // place()
+}   // place_checked()
+
+
+
+// See piece.hxx
+bool Piece::place_at(
+unsigned    piece_number,
+int         position    ,
+unsigned    orientation )
+{
+    if (is_pre_placed()) {
+        _current_orientation = orientation;
+        return true;
+    }
+
+    if (is_placed())
+        _shape->remove_piece(this, piece_number);
+
+    // Only possible if from Soma::resume() with bad checkpoint
+    if (   position    <  0
+        || position    >= static_cast<int>(Shape::NUMBER_OF_CUBICLES)
+        || orientation >= _valid_orientations[position].size()        ) {
+        reset_position_orientation();
+        return false;
+    }
+
+    _current_position    = position   ;
+    _current_orientation = orientation;
+
+    if (!_shape->place_piece(_current_position                       ,
+                             this                                    ,
+                             piece_number                            ,
+                             _number_of_cubes                        ,
+                             _orientations[
+                               _valid_orientations[
+                                 _current_position][
+                                   _current_orientation]].data())) {
+        reset_position_orientation();
+        return false;
+    }
+
+    return true;
+
+}   // place_at()
+
+
+
+// See piece.hxx
+void Piece::placements(
+std::vector<Placement>  &placements)
+const
+{
+    placements.clear();
+
+    if (is_pre_placed())
+        return;
+
+    for (unsigned     position = 0                         ;
+                      position < Shape::NUMBER_OF_CUBICLES ;
+                    ++position                              )
+        for (unsigned     orientation = 0                                  ;
+                          orientation < _valid_orientations[position].size() ;
+                        ++orientation                                       ) {
+            const uint32_t  mask = _shape->placement_mask(
+                                     position        ,
+                                     _number_of_cubes,
+                                     _orientations[
+                                       _valid_orientations[
+                                         position][
+                                           orientation]].data());
+            if (mask)
+                placements.push_back(Placement{mask                     ,
+                                               static_cast<int>(position),
+                                               orientation              });
+        }
+
+}   // placements(std::vector<Placement>&) const
+
+
+
+// See piece.hxx
+void Piece::orientations(
+std::vector<std::vector<Position>>  &cubes)
+const
+{
+    cubes.clear();
+
+    for (const Cubes &orientation : _orientations) {
+        cubes.emplace_back(1, Position(0, 0, 0));
+        cubes.back().insert(cubes.back().end()                     ,
+                            orientation.begin()                    ,
+                            orientation.begin() + _number_of_cubes);
+    }
+
+}   // orientations(std::vector<std::vector<Position>>&) const
+
+
+
+// See piece.hxx
+bool Piece::pre_placed_fits(
+const Piece     &shape_of)
+const
+{
+    const uint32_t  cubicles = _shape->occupant_mask(_code);
+
+    for (unsigned     position = 0                         ;
+                      position < Shape::NUMBER_OF_CUBICLES ;
+                    ++position                              ) {
+        if (!(cubicles & (1 << position)))
+            continue;
+
+        for (const auto &orientation : shape_of._orientations)
+            if (   _shape->placement_mask(position         ,
+                                          _number_of_cubes ,
+                                          orientation.data(),
+                                          _code            )
+                == cubicles                                  )
+                return true;
+    }
+
+    return false;
+
+}   // pre_placed_fits(const Piece&) const
+
+
+
+// See piece.hxx
+bool Piece::primary_pair(
+const unsigned  piece_number)
+const
+{
+    return _shape->is_primary_pair(piece_number     ,
+                                   _current_position,
+                                   _pair_axes[
+                                     _valid_orientations[
+                                       _current_position][
+                                         _current_orientation]]);
+}  // primary_pair(const unsigned) const
 
 
 
 // Set next _current_position and/or _current_orientation
+template<bool PAIR_ANCHORED>
 bool Piece::place_next()
 {
     // Increment to next _current_orientation
@@ -295,8 +819,10 @@ bool Piece::place_next()
         >= _valid_orientations[_current_position].size()) {
         // At end of _valid_orientations, reset to first and
         //   go to next position
-        _current_orientation = 0                                   ;
-        _current_position    = _shape->next_free(_current_position);
+        _current_orientation = 0;
+        _current_position    = PAIR_ANCHORED
+                               ? _shape->next_unoccupied(_current_position)
+                               : _shape->next_free      (_current_position);
 
         if (_current_position >= static_cast<int>(Shape::NUMBER_OF_CUBICLES)) {
             // No more valid positions, reset and return failure
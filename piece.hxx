@@ -21,19 +21,18 @@
 #ifndef PIECE_H
 #define PIECE_H
 
+#include <array>
 #include <limits>
 #include <map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "counters.hxx"
+#include "engine.hxx"
 #include "position.hxx"
 #include "rotators.hxx"
 
-#if SOMA_MATRIX_ROTATION + SOMA_LAMBDA_ROTATION != 1
-#error #define one and only one of SOMA_MATRIX_ROTATION or SOMA_LAMBDA_ROTATION
-#endif
-
 
 
 namespace soma {
@@ -91,16 +90,31 @@ class Piece {
         _current_orientation =  0 ;
     }
 
-    // Initialize unique-considering-symmetries _orientations
-    // Can't be done in or called from constructor because
-    //   #ifdef SOMA_LAMBDA_ROTATION version of Rotators::rotations
-    //   needs pre-main static initialization as do static Piece instances
-    //   and former may be done after latter
-    void    generate_orientations();
+    // Initialize unique-considering-symmetries _orientations, copied
+    //   from tables generated at compile time (see piece.cxx)
+    // If pair_anchored, orientations are positioned by piece's middle
+    //   pair of cubes instead of by central cube (see _pair_anchored).
+    //   Returns false, and generates normal orientations, if not
+    //   pair_anchorable().
+    bool    generate_orientations(const bool    pair_anchored = false);
+
+    // True for "p", "n", and "z": paths of 4 cubes, whose middle
+    //   two cubes are mapped onto themselves by all of the piece's
+    //   own rotations/reflections, but exchanged by some of them
+    bool    pair_anchorable() const { return pair_partner() != 0; }
+
+    bool    is_pair_anchored() const { return _pair_anchored; }
+
+    // All cubes in one plane, so can fit in one-cube-thick shape
+    //   (all but "c", "p", and "n")
+    bool    is_planar() const;
 
     // See _shape member variable
     void    register_shape(Shape *shape) {_shape = shape; }
 
+    // See _counters member variable. Zero to disable.
+    void    register_counters(Counters *counters) {_counters = counters; }
+
     // For user-facing Shape::write()
     static char code2name(
     const unsigned code)
@@ -122,24 +136,81 @@ class Piece {
     bool     is_pre_placed      () const {return _pre_placed            ; }
     bool     is_placed          () const { return _current_position >= 0; }
 
+    // Current state, for later place_at()
+    int      position           () const { return _current_position     ; }
+    unsigned orientation        () const { return _current_orientation  ; }
+
     // Main solver algorithm
     // Repeatedly calls Shape::place_piece() using own internal state
     //   _current_position and _current_orientation.
     // If successful, piece has been placed in shape, and returns true.
     // Otherwise uses place_next() until no more valid positions/orientations
     //   and returns false.
-    bool    place(unsigned  piece_number    ,
-                  bool      check_orphans   ,
-                  bool      check_duplicates);
-
-#ifdef SOMA_STATISTICS
+    // If check_canonical, placements that fail Shape::is_canonical()
+    //   are skipped (and counted) as per duplicates, including
+    //   pre-placed piece.
+    // If check_forward, placements that fail Shape::forward_check()
+    //   are skipped (and counted) as per orphans, including
+    //   pre-placed piece.
+    // Duplicate checks and statistics as per engine, which must
+    //   match the one given to Shape::engine().
+    bool    place(unsigned       piece_number                ,
+                  bool           check_orphans               ,
+                  bool           check_duplicates            ,
+                  bool           check_canonical = false     ,
+                  bool           check_forward   = false     ,
+                  const Engine  &engine          = Engine() );
+
+    // Version of place() specialized at compile time for one
+    //   combination of its check_* and engine arguments and of piece's
+    //   is_pair_anchored() and size(), so inner loop has no run-time
+    //   configuration tests. Call as (piece->*placer)(piece_number).
+    // Only valid until generate_orientations() called again.
+    // Used by Soma::solve(), selected once per figure.
+    using Placer = bool (Piece::*)(unsigned piece_number);
+    Placer  placer(bool          check_orphans               ,
+                   bool          check_duplicates            ,
+                   bool          check_canonical = false     ,
+                   bool          check_forward   = false     ,
+                   const Engine &engine          = Engine() ) const;
+
+    // Directly place at position and orientation previously returned
+    //   by position() and orientation() after successful place().
+    // No orphan or duplicate checks. If pre-placed only restores
+    //   orientation() (see place()) and position is ignored.
+    // Subsequent place() continues from this state as if place() had
+    //   returned it.
+    bool    place_at(unsigned   piece_number,
+                     int        position    ,
+                     unsigned   orientation );
+
+    // Every valid position and orientation (in place_at() terms) with
+    //   bitmask of cubicles occupied (see Shape::placement_mask()),
+    //   for exact cover algorithms. Empty if pre-placed.
+    struct Placement {
+        uint32_t    mask       ;
+        int         position   ;
+        unsigned    orientation;
+    };
+    void    placements(std::vector<Placement>   &placements) const;
+
+    // Cubes of each orientation, central (or pair-anchoring, see
+    //   generate_orientations()) one first at 0,0,0, e.g. for placing
+    //   piece in figures other than Shape (see Figure)
+    void    orientations(std::vector<std::vector<Position>> &cubes) const;
+
+    // If pre-placed, true if its cubicles in shape are one of the
+    //   orientations of shape_of (normally itself, but see
+    //   Soma::check_preplaced() regarding mirrored "p" and "n").
+    bool    pre_placed_fits(const Piece     &shape_of) const;
+
+    // Only updated if Engine::statistics
     unsigned    num_orientations   () const { return _orientations.size() ; }
     unsigned    place_successes    () const { return _place_successes     ; }
     unsigned    place_failures     () const { return _place_failures      ; }
     unsigned    place_duplicates   () const { return _place_duplicates    ; }
     unsigned    place_orphans      () const { return _place_orphans       ; }
     unsigned num_valid_orientations() const { return _total_valid_orients ; }
-#endif
 
 
 
@@ -150,34 +221,41 @@ class Piece {
     using Cubes = std::array<Position, MAX_NUMBER_OF_CUBES + 1>;
 
     // See piece.cxx
+    template<bool PAIR_ANCHORED>
     bool    place_next();
 
+    // See Placer, and placer() in piece.cxx
+    template<bool       CHECK_ORPHANS   ,
+             bool       CHECK_DUPLICATES,
+             bool       CHECK_CANONICAL ,
+             bool       CHECK_FORWARD   ,
+             bool       STATISTICS      ,
+             bool       LAMBDA_ROTATION ,
+             bool       ORDERED_SETS    ,
+             bool       PAIR_ANCHORED   ,
+             unsigned   NUMBER_OF_CUBES >
+    bool    place_checked(unsigned  piece_number);
+
+    template<bool... CHECKS, typename... Flags>
+    Placer  select_placer(bool flag, Flags... flags) const;
+    template<bool       CHECK_ORPHANS   ,
+             bool       CHECK_DUPLICATES,
+             bool       CHECK_CANONICAL ,
+             bool       CHECK_FORWARD   ,
+             bool       STATISTICS      ,
+             bool       LAMBDA_ROTATION ,
+             bool       ORDERED_SETS    ,
+             bool       PAIR_ANCHORED   >
+    Placer  select_placer(                         ) const;
+
+    // If _pair_anchored, whether current position and orientation
+    //   is allowed by symmetry checking. See Shape::is_primary_pair().
+    bool    primary_pair(const unsigned piece_number) const;
+
+    // Index of other middle cube (see pair_anchorable()) in _cubes,
+    //   +1 for central cube, or 0 if not pair_anchorable()
+    unsigned    pair_partner() const;
 
-    // Rotate piece
-    //
-#ifdef SOMA_MATRIX_ROTATION
-    static inline void rotate(
-          Cubes     &rotated_cubes  ,
-    const Cubes     &original_cubes ,
-    const int        matrix[3][3]   ,
-    const unsigned   number_of_cubes)
-    {
-        for (unsigned ndx = 0; ndx < number_of_cubes; ndx++)
-            rotated_cubes[ndx] = original_cubes[ndx] * matrix;
-    }
-#endif
-
-#ifdef SOMA_LAMBDA_ROTATION
-    static void rotate(
-          Cubes      &rotated_cubes           ,
-    const Cubes      &original_cubes          ,
-          Position  (*rotator)(const Position),
-    const unsigned    number_of_cubes         )
-    {
-        for (unsigned ndx = 0; ndx < number_of_cubes; ndx++)
-            rotated_cubes[ndx] = rotator(original_cubes[ndx]);
-    }
-#endif
 
     // Member variables
     //
@@ -193,6 +271,19 @@ class Piece {
     // Unique (non-rotated/mirrored symmetric) rotations
     std::vector<Cubes>   _orientations;
 
+    // Alternate scheme for pair_anchorable() pieces: _orientations
+    //   are relative to the one of the piece's middle pair of cubes
+    //   whose partner is in the positive x, y, or z direction, instead
+    //   of to the central cube. Each placement in shape then has a
+    //   position that is mapped correctly by Shape symmetry checks
+    //   (with central cube, a symmetric piece such as "z" can be
+    //   rotated so its central cube lands on a different cubicle).
+    bool                 _pair_anchored;
+    // If _pair_anchored, axis (0, 1, 2 for x, y, z) of middle pair,
+    //   1-to-1 with _orientations
+    std::vector<unsigned>
+                         _pair_axes;
+
     // Subset of _orientations, per-cubicle in shape (no need to
     //   repeatedly try other orientations during recursive tree solving
     //   if piece will not fit in shape regardless of other, previously
@@ -203,6 +294,10 @@ class Piece {
     // For communication with Shape
     Shape               *_shape;
 
+    // Runtime search counters, or null if not enabled
+    // See Soma::counters()
+    Counters            *_counters;
+
     // Piece is in fixed, user-specified position and orientation
     bool                 _pre_placed;
 
@@ -212,13 +307,12 @@ class Piece {
     int                  _current_position   ;    // cubicle 0 to 26, or -1
     unsigned             _current_orientation;    // index into _orientations
 
-#ifdef SOMA_STATISTICS
+    // Statistics, see Engine::statistics
     unsigned             _place_successes    ,
                          _place_failures     ,
                          _place_duplicates   ,
                          _place_orphans      ,
                          _total_valid_orients;
-#endif
 
 };   // class Piece
 
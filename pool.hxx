@@ -0,0 +1,116 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+
+
+#ifndef POOL_HXX
+#define POOL_HXX
+
+#include <cstddef>
+#include <new>
+
+
+
+namespace soma {
+
+// Allocator for node-based containers (Shape's duplicate solution
+//   sets) that keeps single-node blocks freed by clear() or erase()
+//   on a per-node-type, per-thread free list and hands them back out
+//   on the next insert(), instead of returning them to the heap.
+// After the first few figures, and once the sets have reached their
+//   largest size, solving further figures does no heap allocation
+//   for them. Blocks are only freed at thread exit.
+// Multi-element requests (std::unordered_set bucket arrays) go
+//   straight to the heap: they are kept across clear() anyway.
+//
+template<typename T> class NodePool {
+  public:
+    using value_type = T;
+
+    NodePool() = default;
+    template<typename U> NodePool(const NodePool<U>&) {}
+
+    T *allocate(
+    const std::size_t   count)
+    {
+        if (count == 1 && sizeof(T) >= sizeof(Block)) {
+            FreeList    &free_list = FreeList::instance();
+
+            if (Block *block = free_list.head) {
+                free_list.head = block->next;
+                return reinterpret_cast<T*>(block);
+            }
+        }
+
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(
+    T* const            pointer,
+    const std::size_t   count  )
+    {
+        if (count == 1 && sizeof(T) >= sizeof(Block)) {
+            FreeList    &free_list = FreeList::instance();
+            Block       *block     = reinterpret_cast<Block*>(pointer);
+
+            block->next    = free_list.head;
+            free_list.head = block         ;
+        }
+        else
+            ::operator delete(pointer);
+    }
+
+    // Stateless: any instance can free any other's blocks
+    template<typename U> bool operator==(const NodePool<U>&) const
+    { return true; }
+    template<typename U> bool operator!=(const NodePool<U>&) const
+    { return false; }
+
+
+  protected:
+    struct Block {
+        Block   *next;
+    };
+
+    // One per T (so all blocks same size) per thread
+    struct FreeList {
+        static FreeList &instance()
+        {
+            static thread_local FreeList    free_list;
+            return free_list;
+        }
+
+        ~FreeList()
+        {
+            while (head) {
+                Block   *next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+
+        Block   *head = nullptr;
+    };
+
+};  // template<typename T> class NodePool
+
+}  // namespace soma
+
+#endif  // #ifndef POOL_HXX
@@ -23,11 +23,7 @@
 
 #include <algorithm>  // DEBUG (if sorting in center())
 #include <cstdint>
-
-
-#if SOMA_MATRIX_ROTATION + SOMA_LAMBDA_ROTATION != 1
-#error #define one and only one of SOMA_MATRIX_ROTATION or SOMA_LAMBDA_ROTATION
-#endif
+#include <limits>
 
 
 
@@ -51,6 +47,10 @@ class Position {
     :   _coords{in_x, in_y, in_z, 0}
     {}
 
+    // Explicit because of user-declared operator=() below, which would
+    //   otherwise deprecate implicit copy
+    constexpr Position(const Position &other) = default;
+
 
     // See inline, below
     template<typename Type, typename Container>
@@ -115,7 +115,6 @@ class Position {
     }
 
 
-#ifdef SOMA_MATRIX_ROTATION
     Position operator*(
     const int       rotation[3][3])
     const
@@ -137,7 +136,6 @@ class Position {
         return  result;
 
     }
-#endif
 
     bool operator==(
     const Position  &check)
@@ -200,21 +198,20 @@ class Position {
     int8_t &y() { return _coords[1]; }
     int8_t &z() { return _coords[2]; }
 
-#ifdef SOMA_MATRIX_ROTATION
+    // See Rotators::rotate()
     Position rotate(
     const int   matrix[3][3])
+    const
     {
         return *this * matrix;
     }
-#endif
 
-#ifdef SOMA_LAMBDA_ROTATION
     Position rotate(
     Position(*rotator)(const Position))
+    const
     {
         return rotator(*this);
     }
-#endif
 
 
   private:
@@ -0,0 +1,393 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "rank.hxx"
+
+
+
+namespace soma {
+
+// See rank.hxx
+Rank::Rank(
+const uint32_t                               cells,
+const std::vector<std::vector<uint32_t>>    &items,
+const unsigned                               pos  ,
+const unsigned                               neg  )
+:   _cells (cells),
+    _items (items),
+    _pos   (pos  ),
+    _neg   (neg  ),
+    _unique(false),
+    _listed(false)
+{
+    for (unsigned item = 0 ; item < _items.size() ; ++item)
+        for (unsigned     placement = 0                     ;
+                          placement < _items[item].size()   ;
+                        ++placement                          )
+            _lowest[__builtin_ctz(_items[item][placement])]
+            .emplace_back(item, placement);
+
+}  // Rank(...)
+
+
+
+// See rank.hxx
+void Rank::unique(
+const std::vector<Image>    &images  ,
+const std::vector<bool>     &mirrored)
+{
+    std::vector<std::unordered_set<uint32_t>>   placements;
+
+    for (const std::vector<uint32_t> &item : _items)
+        placements.emplace_back(item.begin(), item.end());
+
+    _images  .clear();
+    _mirrored.clear();
+
+    for (unsigned ndx = 0 ; ndx < images.size() ; ++ndx) {
+        bool    maps = true;
+
+        for (unsigned item = 0 ; item < _items.size() && maps ; ++item) {
+            unsigned    target = item;
+            if (mirrored[ndx]) {
+                if      (item == _pos) target = _neg;
+                else if (item == _neg) target = _pos;
+            }
+
+            for (const uint32_t mask : _items[item]) {
+                uint32_t    mapped = 0;
+                for (uint32_t bits = mask ; bits ; bits &= bits - 1)
+                    mapped |= 1 << images[ndx][__builtin_ctz(bits)];
+
+                if (!placements[target].count(mapped)) {
+                    maps = false;
+                    break;
+                }
+            }
+        }
+
+        if (maps) {
+            _images  .push_back(images  [ndx]);
+            _mirrored.push_back(mirrored[ndx]);
+        }
+    }
+
+    _unique = true ;
+    _listed = false;
+    _uniques.clear();
+
+}  // unique(const std::vector<Image>&, const std::vector<bool>&)
+
+
+
+// See rank.hxx
+uint64_t Rank::count()
+{
+    if (!_unique)
+        return tally(_cells, (1 << _items.size()) - 1);
+
+    if (!_listed) {
+        Cover   cover;
+
+        cover.fill(0);
+        list(_cells, (1 << _items.size()) - 1, cover, 0);
+        _listed = true;
+    }
+
+    return _uniques.size();
+
+}  // count()
+
+
+
+// See rank.hxx
+bool Rank::unrank(
+const uint64_t   index,
+      Cover     &cover)
+{
+    if (index >= count())
+        return false;
+
+    descend(_unique ? _uniques[index] : index, cover);
+
+    return true;
+
+}  // unrank(const uint64_t, Cover&)
+
+
+
+// See rank.hxx
+bool Rank::rank(
+const Cover     &cover,
+      uint64_t  &index)
+{
+    if (!_unique)
+        return position(cover, index);
+
+    count();  // list _uniques if not yet
+
+    if (!position(canonical(cover), index))
+        return false;
+
+    index =   std::lower_bound(_uniques.begin(), _uniques.end(), index)
+            - _uniques.begin();
+
+    return true;
+
+}  // rank(const Cover&, uint64_t&)
+
+
+
+// See rank.hxx
+bool Rank::sample(
+std::mt19937_64     &random,
+Cover               &cover )
+{
+    const uint64_t  total = tally(_cells, (1 << _items.size()) - 1);
+
+    if (!total)
+        return false;
+
+    std::uniform_int_distribution<uint64_t>     any(0, total - 1);
+
+    if (!_unique) {
+        descend(any(random), cover);
+        return true;
+    }
+
+    std::uniform_int_distribution<unsigned>     image(0, _images.size() - 1);
+
+    while (true) {
+        unsigned    fixed;
+
+        descend(any(random), cover);
+
+        const Cover least = canonical(cover, &fixed);
+        if (image(random) < fixed) {
+            cover = least;
+            return true;
+        }
+    }
+
+}  // sample(std::mt19937_64&, Cover&)
+
+
+
+// Memoized number of covers of cells by unused items (whose sizes
+//   must sum to number of cells). Lowest cell covered by each item in
+//   turn.
+//
+uint64_t Rank::tally(
+const uint32_t  cells ,
+const unsigned  unused)
+{
+    if (!cells)
+        return 1;
+
+    const uint64_t  key = static_cast<uint64_t>(cells) << MAX_ITEMS | unused;
+    const std::unordered_map<uint64_t, uint64_t>::iterator
+                    found = _counts.find(key);
+
+    if (found != _counts.end())
+        return found->second;
+
+    uint64_t    total = 0;
+
+    for (const std::pair<unsigned, unsigned> &candidate
+         : _lowest[__builtin_ctz(cells)]) {
+        const uint32_t  mask = _items[candidate.first][candidate.second];
+
+        if ((unused & (1 << candidate.first)) && !(mask & ~cells))
+            total += tally(cells  & ~mask                 ,
+                           unused & ~(1 << candidate.first));
+    }
+
+    _counts[key] = total;
+
+    return total;
+
+}  // tally(const uint32_t, const unsigned)
+
+
+
+// Index among all covers of cover, by summing numbers of covers
+//   completing candidates ordered before cover's at each step.
+//   False if not a cover.
+//
+bool Rank::position(
+const Cover     &cover,
+      uint64_t  &index)
+{
+    uint32_t    cells  = _cells                    ;
+    unsigned    unused = (1 << _items.size()) - 1;
+
+    index = 0;
+    while (cells) {
+        bool    found = false;
+
+        for (const std::pair<unsigned, unsigned> &candidate
+             : _lowest[__builtin_ctz(cells)]) {
+            const unsigned  item = candidate.first                ;
+            const uint32_t  mask = _items[item][candidate.second];
+
+            if (!(unused & (1 << item)) || (mask & ~cells))
+                continue;
+
+            if (cover[item] == mask) {
+                cells  &= ~mask       ;
+                unused &= ~(1 << item);
+                found   = true        ;
+                break;
+            }
+
+            index += tally(cells & ~mask, unused & ~(1 << item));
+        }
+
+        if (!found)
+            return false;
+    }
+
+    return true;
+
+}  // position(const Cover&, uint64_t&)
+
+
+
+// Cover at index among all covers (which must be < their number), by
+//   choosing at each step the candidate whose covers include it
+//
+void Rank::descend(
+uint64_t     index,
+Cover       &cover)
+{
+    uint32_t    cells  = _cells                    ;
+    unsigned    unused = (1 << _items.size()) - 1;
+
+    cover.fill(0);
+    while (cells)
+        for (const std::pair<unsigned, unsigned> &candidate
+             : _lowest[__builtin_ctz(cells)]) {
+            const unsigned  item = candidate.first                ;
+            const uint32_t  mask = _items[item][candidate.second];
+
+            if (!(unused & (1 << item)) || (mask & ~cells))
+                continue;
+
+            const uint64_t  number = tally(cells  & ~mask       ,
+                                           unused & ~(1 << item));
+
+            if (index < number) {
+                cover[item]  =   mask        ;
+                cells       &= ~mask        ;
+                unused      &= ~(1 << item);
+                break;
+            }
+
+            index -= number;
+        }
+
+}  // descend(uint64_t, Cover&)
+
+
+
+// Recursively every cover, in order (skipping subtrees with none),
+//   appending index of each unique one to _uniques. Index is that of
+//   first cover completing cover.
+//
+void Rank::list(
+const uint32_t   cells ,
+const unsigned   unused,
+      Cover     &cover ,
+      uint64_t   index )
+{
+    if (!cells) {
+        if (canonical(cover) == cover)
+            _uniques.push_back(index);
+        return;
+    }
+
+    for (const std::pair<unsigned, unsigned> &candidate
+         : _lowest[__builtin_ctz(cells)]) {
+        const unsigned  item = candidate.first                ;
+        const uint32_t  mask = _items[item][candidate.second];
+
+        if (!(unused & (1 << item)) || (mask & ~cells))
+            continue;
+
+        const uint64_t  number = tally(cells  & ~mask       ,
+                                       unused & ~(1 << item));
+        if (!number)
+            continue;
+
+        cover[item] = mask;
+        list(cells & ~mask, unused & ~(1 << item), cover, index);
+        cover[item] = 0;
+
+        index += number;
+    }
+
+}  // list(const uint32_t, const unsigned, Cover&, uint64_t)
+
+
+
+// Lexicographically least of images of cover, exchanging "p" and "n"
+//   items if mirrored. If fixed non-null, number of images mapping
+//   cover to itself.
+//
+Rank::Cover Rank::canonical(
+const Cover     &cover,
+      unsigned  *fixed)
+const
+{
+    Cover   least;
+    least.fill(UINT32_MAX);
+
+    if (fixed)
+        *fixed = 0;
+
+    for (unsigned ndx = 0 ; ndx < _images.size() ; ++ndx) {
+        Cover   mapped;
+        mapped.fill(0);
+
+        for (unsigned item = 0 ; item < _items.size() ; ++item) {
+            unsigned    target = item;
+            if (_mirrored[ndx]) {
+                if      (item == _pos) target = _neg;
+                else if (item == _neg) target = _pos;
+            }
+
+            for (uint32_t bits = cover[item] ; bits ; bits &= bits - 1)
+                mapped[target] |= 1 << _images[ndx][__builtin_ctz(bits)];
+        }
+
+        least = std::min(least, mapped);
+
+        if (fixed && mapped == cover)
+            ++*fixed;
+    }
+
+    return least;
+
+}  // canonical(const Cover&, unsigned*) const
+
+}  // namespace soma
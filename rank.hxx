@@ -0,0 +1,151 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef RANK_HXX
+#define RANK_HXX
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+
+
+namespace soma {
+
+// Numbers exact covers of up to 32 cells by one placement (bitmask of
+//   cells) from each of up to 8 items (pieces), in fixed order:
+//   lowest uncovered cell covered by each item in turn, in item
+//   order and then order of item's placements. Number of covers
+//   completing each partial cover is memoized (by cells still
+//   uncovered and items still unused), so after first count() a
+//   cover can be found from its index (unrank()), an index from its
+//   cover (rank()), or a uniformly random cover (sample()), each
+//   choosing just one placement per item.
+// Independent of Shape/Piece search in Soma::solve(). Used for
+//   Soma::ranked(), unrank(), rank(), and sample().
+//
+class Rank {
+  public:
+    static const unsigned   MAX_ITEMS = 8;
+
+    // Cells to cells
+    typedef std::array<uint8_t , 32       >     Image;
+
+    // Per item, cells covered by its placement
+    typedef std::array<uint32_t, MAX_ITEMS>     Cover;
+
+    // cells:  bitmask of cells to be covered
+    // items:  per item, all its candidate placements
+    // pos,
+    // neg:    mutually mirrored items ("p" and "n" pieces)
+    Rank(const uint32_t                                 cells,
+         const std::vector<std::vector<uint32_t>>      &items,
+         const unsigned                                 pos  ,
+         const unsigned                                 neg  );
+
+    // From now on only number one cover of each set equivalent under
+    //   group of images (each with corresponding mirrored flag,
+    //   exchanging pos and neg items, identity included): the one
+    //   lexicographically least as a Cover. Images not mapping every
+    //   item's placements onto its own (e.g. moving a pre-placed
+    //   piece) are dropped, leaving a subgroup that does.
+    // Index of a unique cover is its position in order of all covers
+    //   among other unique ones, so first count(), rank(), or
+    //   unrank() afterwards lists them all (see _uniques).
+    void        unique(const std::vector<Image>    &images  ,
+                       const std::vector<bool>     &mirrored);
+    bool        is_unique() const { return _unique; }
+
+    // Number of covers
+    uint64_t    count();
+
+    // Cover number index (from 0), false if index >= count()
+    bool        unrank(const uint64_t    index,
+                             Cover      &cover);
+
+    // Inverse of unrank(), false if cover isn't one. If unique(),
+    //   index of equivalent unique cover.
+    bool        rank  (const Cover      &cover,
+                             uint64_t   &index);
+
+    // Uniformly random cover, false if none. If unique(), by
+    //   rejection: each cover accepted with probability (number of
+    //   images leaving it unchanged) / (number of images), so each
+    //   equivalent set equally likely, then replaced by unique one.
+    bool        sample(std::mt19937_64  &random,
+                       Cover            &cover );
+
+    // Number of covers of cells (subset of those given to constructor)
+    //   by unused items (bitmask), e.g. completing a partial cover,
+    //   memoized as for count()
+    uint64_t    completions(const uint32_t  cells ,
+                            const unsigned  unused) { return tally(cells ,
+                                                                   unused); }
+
+    // Statistics
+    size_t      states() const { return _counts.size(); }
+
+
+
+  protected:
+    uint64_t    tally    (const uint32_t    cells ,
+                          const unsigned    unused);
+
+    bool        position (const Cover      &cover ,
+                                uint64_t   &index );
+    void        descend  (      uint64_t    index ,
+                                Cover      &cover );
+
+    void        list     (const uint32_t    cells ,
+                          const unsigned    unused,
+                                Cover      &cover ,
+                                uint64_t    index );
+
+    Cover       canonical(const Cover      &cover ,
+                                unsigned   *fixed = 0) const;
+
+    uint32_t                                    _cells   ;
+    std::vector<std::vector<uint32_t>>          _items   ;
+    const unsigned                              _pos     ,
+                                                _neg     ;
+
+    // Per cell, (item, placement) pairs with that as lowest cell
+    std::array<std::vector<std::pair<unsigned, unsigned>>, 32>
+                                                _lowest  ;
+
+    // Number of covers, keyed by cells << MAX_ITEMS | unused items
+    std::unordered_map<uint64_t, uint64_t>      _counts  ;
+
+    // See unique()
+    bool                                        _unique  ;
+    std::vector<Image>                          _images  ;
+    std::vector<bool>                           _mirrored;
+
+    // Indices among all covers of unique ones, in order, once _listed
+    std::vector<uint64_t>                       _uniques ;
+    bool                                        _listed  ;
+
+};  // class Rank
+
+}  // namespace soma
+
+#endif  // #ifndef RANK_HXX
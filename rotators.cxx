@@ -25,8 +25,9 @@ namespace soma {
 
 // See rotators.hxx
 
-#ifdef SOMA_MATRIX_ROTATION
-const int       Rotators::rotations[][3][3] = {
+constexpr int   Rotators::AXES[][3];
+
+const int       Rotators::matrices[][3][3] = {
     // normal
     { { 1,  0,  0},     // +Z up        // 0
       { 0,  1,  0},
@@ -249,10 +250,8 @@ const int       Rotators::rotations[][3][3] = {
       { 0,  0, -1},
       { 1,  0,  0} },
 };
-#endif
 
-#ifdef SOMA_LAMBDA_ROTATION
-Position (*Rotators::rotations[])(const Position) = {
+Position (*Rotators::lambdas[])(const Position) = {
 #define R(X, Y, Z) \
     [](const Position pos) { return Position(X(), Y(), Z()); },
 
@@ -355,6 +354,5 @@ Position (*Rotators::rotations[])(const Position) = {
 
 #undef R
 };
-#endif
 
 }  // namespace soma
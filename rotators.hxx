@@ -21,10 +21,6 @@
 #ifndef ROTATORS_H
 #define ROTATORS_H
 
-#if SOMA_MATRIX_ROTATION + SOMA_LAMBDA_ROTATION != 1
-#error #define one and only one of SOMA_MATRIX_ROTATION or SOMA_LAMBDA_ROTATION
-#endif
-
 #include "position.hxx"
 
 
@@ -33,7 +29,8 @@ namespace soma {
 
 
 // Utility for rotating Position objects around X,Y,Z coordinate system axes
-// Two compile-time chosen techniques:
+// Two techniques, both compiled in and chosen per figure by
+//   Engine::lambda_rotation (see rotate()):
 //    1) 3x3 matrix multiply of X,Y,Z values
 //    2) Lambda functions to permute X,Y,Z components
 // 24 different rotations: Original +Z coordinate axis rotated to
@@ -79,36 +76,75 @@ class Rotators {
     static const unsigned   Z_MIRRORED_OFFSET = MAX_NUMBER_OF_ORIENTATIONS    ,
                             X_MIRRORED_OFFSET = MAX_NUMBER_OF_ORIENTATIONS * 2;
 
+    // Same (non-mirrored) rotations as matrices[] and lambdas[], as
+    //   source of each rotated x,y,z coordinate: 1,2,3 for x,y,z,
+    //   negative if negated. For compile-time use (see piece.cxx).
+    static constexpr int    AXES[MAX_NUMBER_OF_ORIENTATIONS][3] = {
+        { 1,  2,  3},   // POSX_POSY_POSZ
+        {-2,  1,  3},   // NEGY_POSX_POSZ
+        {-1, -2,  3},   // NEGX_NEGY_POSZ
+        { 2, -1,  3},   // POSY_NEGX_POSZ
+
+        {-1,  2, -3},   // NEGX_POSY_NEGZ
+        {-2, -1, -3},   // NEGY_NEGX_NEGZ
+        { 1, -2, -3},   // POSX_NEGY_NEGZ
+        { 2,  1, -3},   // POSY_POSX_NEGZ
+
+        { 1, -3,  2},   // POSX_NEGZ_POSY
+        { 3,  1,  2},   // POSZ_POSX_POSY
+        {-1,  3,  2},   // NEGX_POSZ_POSY
+        {-3, -1,  2},   // NEGZ_NEGX_POSY
+
+        { 1,  3, -2},   // POSX_POSZ_NEGY
+        {-3,  1, -2},   // NEGZ_POSX_NEGY
+        {-1, -3, -2},   // NEGX_NEGZ_NEGY
+        { 3, -1, -2},   // POSZ_NEGX_NEGY
+
+        {-3,  2,  1},   // NEGZ_POSY_POSX
+        {-2, -3,  1},   // NEGY_NEGZ_POSX
+        { 3, -2,  1},   // POSZ_NEGY_POSX
+        { 2,  3,  1},   // POSY_POSZ_POSX
+
+        { 3,  2, -1},   // POSZ_POSY_NEGX
+        {-2,  3, -1},   // NEGY_POSZ_NEGX
+        {-3, -2, -1},   // NEGZ_NEGY_NEGX
+        { 2, -3, -1},   // POSY_NEGZ_NEGX
+    };
 
-#ifdef SOMA_MATRIX_ROTATION
-using RotatorGetter = const int(*)[3];
-    static RotatorGetter rotator(
-    const unsigned index)
-    {
-        return rotations[index];
-    }
-#endif
 
-#ifdef SOMA_LAMBDA_ROTATION
-using RotatorGetter = Position(*)(Position);
-    static RotatorGetter rotator(
-    const unsigned  index)
-    {
-        return rotations[index];
-    }
-#endif
+    // Rotate/reflect position by index (including Z_MIRRORED_OFFSET
+    //   and X_MIRRORED_OFFSET ones) into matrices[] if LAMBDA_ROTATION
+    //   false, else into lambdas[]
+    template<bool LAMBDA_ROTATION>
+    static Position rotate(const Position   position,
+                           const unsigned   index   );
 
 
-#ifdef SOMA_MATRIX_ROTATION
-    static const int    rotations[MAX_NUMBER_OF_ORIENTATIONS * 3][3][3];
-#endif
+    static const int    matrices[MAX_NUMBER_OF_ORIENTATIONS * 3][3][3];
 
-#ifdef SOMA_LAMBDA_ROTATION
-    static Position (*rotations[MAX_NUMBER_OF_ORIENTATIONS * 3])(const Position);
-#endif
+    static Position   (*lambdas [MAX_NUMBER_OF_ORIENTATIONS * 3])(
+                                                            const Position);
 
 };  // class Rotators
 
+
+
+template<>
+inline Position Rotators::rotate<false>(
+const Position  position,
+const unsigned  index   )
+{
+    return position.rotate(matrices[index]);
+}
+
+template<>
+inline Position Rotators::rotate<true>(
+const Position  position,
+const unsigned  index   )
+{
+    return position.rotate(lambdas[index]);
+}
+
 }  // namespace soma
 
 #endif   // ifndef ROTATORS_H
@@ -22,9 +22,12 @@
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <string>
+#include <utility>
 
 #include "rotators.hxx"
 #include "signature.hxx"
+#include "trace.hxx"
 
 #include "shape.hxx"
 
@@ -37,23 +40,27 @@ namespace soma {
 Shape::Shape(
 unsigned    number_of_cubicles)
 :
-#ifdef SOMA_STD_SET_UNORDERED
-    // pre-allocate hash table for efficiency
-    _solutions_sets{SignatureSet(1<<14),
-                    SignatureSet(1<<14),
-                    SignatureSet(1<<14),
-                    SignatureSet(1<<14),
-                    SignatureSet(1<<14),
-                    SignatureSet(1<<14),
-                    SignatureSet(1<<14)},
-#endif
-    _num_cubicles(number_of_cubicles)
-#ifdef SOMA_STATISTICS
-    ,
-    _statuses_uniques   {0},
-    _statuses_duplicates{0}
-#endif
-{}
+    _canonical_pre_placed(0                 ),
+    _mirrors_deferred    (false             ),
+    _num_cubicles        (number_of_cubicles),
+    _statuses_uniques    {0                 },
+    _statuses_duplicates {0                 }
+{
+    for (auto &primary_pairs : _primary_pairs)
+        primary_pairs.fill(ALL_CUBICLES_MASK);
+}
+
+
+
+// See shape.hxx
+Shape::~Shape()
+{
+    reset();
+
+    for (Shape *child : _child_pool)
+        delete child;
+
+}   // ~Shape()
 
 
 
@@ -65,12 +72,17 @@ void Shape::reset()
     _solutions         .clear();
     _solution_ps       .clear();
     _solution_ns       .clear();
+    _symmetry_group    .clear();
 
-    for (SignatureSet &solutions : _solutions_sets)
+    for (SignatureSet<false> &solutions : solutions_sets<false>())
+        solutions.clear();
+    for (SignatureSet<true > &solutions : solutions_sets<true >())
         solutions.clear();
 
-    for (Shape *child : _children)
-        delete child;
+    for (Shape *child : _children) {
+        child->reset();
+        _child_pool.push_back(child);
+    }
     _children.clear();
 
     for (Cubicle &cubicle : _cubicles) {
@@ -83,6 +95,54 @@ void Shape::reset()
 
 
 
+// See shape.hxx
+void Shape::restart()
+{
+    _rotators_mirrorers.clear();
+    _solutions         .clear();
+    _solution_ps       .clear();
+    _solution_ns       .clear();
+    _symmetry_group    .clear();
+
+    for (SignatureSet<false> &solutions : solutions_sets<false>())
+        solutions.clear();
+    for (SignatureSet<true > &solutions : solutions_sets<true >())
+        solutions.clear();
+
+    // Children's cubicles are copies with pre-placed occupants only
+    for (Shape *child : _children) {
+        child->_rotators_mirrorers.clear();
+        child->_solutions         .clear();
+        child->_solution_ps       .clear();
+        child->_solution_ns       .clear();
+        for (unsigned ndx = 0 ; ndx < child->_num_cubicles ; ++ndx)
+            child->_cubicles[ndx].status = Cubicle::Status::UNSET;
+    }
+
+    // Pieces' pre-placed state was cleared by Soma::reconfigure()
+    for (unsigned ndx = 0 ; ndx < _num_cubicles ; ++ndx) {
+        set_cubicle_piece(_cubicles[ndx],
+                          Piece::code2name(_prepared_occupants[ndx]));
+        _cubicles[ndx].status = Cubicle::Status::UNSET;
+    }
+
+}   // restart()
+
+
+
+// See shape.hxx
+void Shape::engine(
+const Engine    &engine)
+{
+    _engine = engine;
+
+    for (Shape *child : _children)
+        child->_engine = engine;
+
+}   // engine(const Engine&)
+
+
+
 // See shape.hxx
 bool Shape::read(
 std::istream    &input ,
@@ -302,36 +362,553 @@ std::ostream    *errors)
 
 
 // See shape.hxx
-bool Shape::is_duplicate_solution(
-const unsigned  piece_number)
+Shape::Occupancy Shape::occupancy(
+const unsigned  codes)
+const
 {
     Signature   signature;
+    current_signature(signature);
 
-    if (_children.size() == 1)
-        generate_signature(signature);
+    return occupancy(signature, codes);
+
+}   // occupancy(const unsigned) const
+
+
+
+// See shape.hxx
+void Shape::orbit(
+const unsigned           piece_number,
+const unsigned           codes       ,
+std::vector<Occupancy>  &occupancies )
+{
+    static const unsigned   ALL_CODES = (1 << (Piece::NUMBER_OF_PIECES + 1)) - 2;
+
+    Signature   signature;
+    current_signature(signature);
+    const Occupancy     current = occupancy(signature, ALL_CODES);
+
+    // Valid if same number of cubicles per piece. Mirrored child shapes
+    //   with only one of "p" or "n" have two of the other.
+    auto    add = [&](const Signature &rotated)
+    {
+        const Occupancy     pieces = occupancy(rotated, ALL_CODES);
+        for (unsigned code = 1 ; code <= Piece::NUMBER_OF_PIECES ; ++code)
+            if (   __builtin_popcount(pieces [code])
+                != __builtin_popcount(current[code]))
+                return;
+        occupancies.push_back(occupancy(rotated, codes));
+    };
+
+    occupancies.clear();
+
+    clear_solutions(piece_number);
+    add_solution   (piece_number);
+
+    if (_engine.ordered_sets)
+        for (const Signature &rotated : solutions_sets<true >()[piece_number])
+            add(rotated);
+    else
+        for (const Signature &rotated : solutions_sets<false>()[piece_number])
+            add(rotated);
+
+    clear_solutions(piece_number);
+
+}   // orbit(const unsigned, const unsigned, std::vector<Occupancy>&)
+
+
+
+// See shape.hxx
+void Shape::child_symmetries(
+std::vector<std::vector<Symmetry>>  &symmetries)
+const
+{
+    symmetries.clear();
+
+    for (const Shape *child : _children) {
+        // Rotators/reflectors are in this, not child, if only one
+        const Shape *const  shape = _children.size() == 1 ? this : child;
+
+        // Index in this of shape's cubicle. Top-level _cubicles have
+        //   been sorted since Cubicle::parent was set.
+        auto    top = [this, shape](const unsigned ndx) -> unsigned {
+                          return   shape == this
+                                 ? ndx
+                                 : shape->_cubicles[ndx].parent - _cubicles.data();
+                      };
+
+        // Just identity if not generated
+        const std::vector<unsigned>   identity(1, Rotators::POSX_POSY_POSZ);
+        const std::vector<unsigned>  &rotators_mirrorers
+                                    =   shape->_rotators_mirrorers.empty()
+                                      ? identity
+                                      : shape->_rotators_mirrorers       ;
+
+        symmetries.emplace_back();
+
+        for (const unsigned rotator_mirrorer : rotators_mirrorers) {
+            Symmetry    symmetry;
+
+            for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx)
+                symmetry.image[ndx] = ndx;
+            symmetry.cubicles = 0;
+            symmetry.mirrored =  rotator_mirrorer
+                               >= Rotators::Z_MIRRORED_OFFSET;
+
+            for (unsigned ndx = 0 ; ndx < shape->_num_cubicles ; ++ndx) {
+                symmetry.image[top(ndx)]
+                    = top(  _engine.lambda_rotation
+                          ? shape->rotated_cubicle<true >(ndx             ,
+                                                          rotator_mirrorer)
+                          : shape->rotated_cubicle<false>(ndx             ,
+                                                          rotator_mirrorer));
+                symmetry.cubicles |= 1 << top(ndx);
+            }
+
+            symmetries.back().push_back(symmetry);
+        }
+    }
+
+}   // child_symmetries(std::vector<std::vector<Symmetry>>&) const
+
+
+
+// See shape.hxx
+void Shape::init_canonical()
+{
+    const unsigned  pos_code = Piece::pos.code(),
+                    neg_code = Piece::neg.code();
+
+    // Reflection of pre-placed "p" without "n" (or vice-versa) may
+    //   still be valid, depending on where other is placed. Child
+    //   shape reflections are only valid if reflected child(ren) have
+    //   both or neither.
+    _mirrors_deferred =    _children.size() > 1
+                        || !occupant_mask(pos_code) != !occupant_mask(neg_code);
+
+    std::vector<std::vector<Symmetry>>  symmetries;
+    child_symmetries(symmetries);
+
+    _symmetry_group.clear();
+
+    for (const std::vector<Symmetry> &child : symmetries)
+        // Identity is first
+        for (unsigned sym_ndx = 1 ; sym_ndx < child.size() ; ++sym_ndx) {
+            const Symmetry  &symmetry = child[sym_ndx];
+
+            // Must leave pre-placed pieces in place
+            bool    valid = true;
+            for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx) {
+                unsigned    occupant = _cubicles[ndx].occupant;
+
+                if (!occupant || !(symmetry.cubicles & (1 << ndx)))
+                    continue;
+
+                if (   symmetry.mirrored
+                    && (occupant == pos_code || occupant == neg_code)) {
+                    if (_mirrors_deferred)
+                        continue;  // see canonical_order()
+                    occupant = occupant == pos_code ? neg_code : pos_code;
+                }
+
+                if (_cubicles[symmetry.image[ndx]].occupant != occupant) {
+                    valid = false;
+                    break;
+                }
+            }
+
+            if (valid)
+                _symmetry_group.push_back(symmetry);
+        }
+
+    // Separated child shapes can also be reflected in pairs, making
+    //   "p" in one into "n" and vice-versa (see add_solution(const
+    //   unsigned))
+    const unsigned  num_singles = _symmetry_group.size();
+    for (unsigned first = 0 ; first < num_singles ; ++first)
+        for (unsigned second = first + 1 ; second < num_singles ; ++second) {
+            const Symmetry  &one = _symmetry_group[first ],
+                            &two = _symmetry_group[second];
+
+            if (   !one.mirrored
+                || !two.mirrored
+                || (one.cubicles & two.cubicles))  // same child
+                continue;
+
+            Symmetry    pair = one;
+            for (uint32_t bits = two.cubicles ; bits ; bits &= bits - 1) {
+                const unsigned  ndx = __builtin_ctz(bits);
+                pair.image[ndx] = two.image[ndx];
+            }
+            pair.cubicles |= two.cubicles;
+
+            _symmetry_group.push_back(pair);
+        }
+
+    _canonical_ties[0].clear();
+    for (unsigned ndx = 0 ; ndx < _symmetry_group.size() ; ++ndx)
+        _canonical_ties[0].push_back(ndx);
+
+    _canonical_pre_placed = 0;
+
+}   // init_canonical()
+
+
+
+// See shape.hxx
+bool Shape::is_canonical(
+const unsigned      piece_number,
+const Piece* const  piece       )
+{
+    const unsigned  pos_code = Piece::pos.code(),
+                    neg_code = Piece::neg.code(),
+                    code     = piece->code()    ;
+
+    uint32_t    mask = 0;
+    if (piece->is_pre_placed()) {
+        mask                  = occupant_mask(code);
+        _canonical_pre_placed |=   1 << piece_number ;
+    }
     else {
-        unsigned    offset = 0;
-        for (Shape *child : _children) {
-            child->generate_signature_child(signature, offset);
-            offset += child->_num_cubicles;
+        for (unsigned ndx = 0 ; ndx < piece->size() ; ++ndx)
+            mask |= 1 << (_piece_cubicles[piece_number][ndx] - _cubicles.data());
+        _canonical_pre_placed &= ~(1 << piece_number);
+    }
+    _canonical_masks[piece_number] = mask;
+    _canonical_codes[piece_number] = code;
+
+    // Reflections exchange "p" and "n", so can't be compared while
+    //   only one is placed
+    unsigned    before = 0;
+    for (unsigned ndx = 0 ; ndx < piece_number ; ++ndx)
+        if (   _canonical_codes[ndx] == pos_code
+            || _canonical_codes[ndx] == neg_code)
+            ++before;
+    const unsigned  after = before + (code == pos_code || code == neg_code);
+
+    auto    deferred = [this](const unsigned num_pos_neg) {
+                           return    num_pos_neg == 1
+                                  || (num_pos_neg == 0 && _mirrors_deferred);
+                       };
+    const bool      pending   = deferred(after)            ,
+                    resolving = deferred(before) && !pending;
+
+    std::vector<unsigned>   &ties = _canonical_ties[piece_number + 1];
+    ties.clear();
+
+    for (const unsigned ndx : _canonical_ties[piece_number]) {
+        const Symmetry  &symmetry = _symmetry_group[ndx];
+
+        if (symmetry.mirrored && pending) {
+            ties.push_back(ndx);
+            continue;
         }
+
+        if (symmetry.mirrored && resolving) {
+            const int   order = canonical_order(symmetry, piece_number);
+            if (order < 0)
+                return false;
+            if (order == 0)
+                ties.push_back(ndx);
+            continue;
+        }
+
+        if (!(mask & symmetry.cubicles)) {  // other child shape
+            ties.push_back(ndx);
+            continue;
+        }
+
+        uint32_t    image = 0;
+        for (uint32_t bits = mask ; bits ; bits &= bits - 1)
+            image |= 1 << symmetry.image[__builtin_ctz(bits)];
+
+        if (image < mask)
+            return false;
+        if (image == mask)
+            ties.push_back(ndx);
     }
 
-    // Check if in already seen solutions (or their rotations/reflections)
-    return    _solutions_sets[piece_number].find(signature)
-           != _solutions_sets[piece_number].end (         );
+    return true;
+
+}   // is_canonical(const unsigned, const Piece* const)
+
+
+
+// See shape.hxx
+void Shape::init_forward(
+const std::array<std::vector<uint32_t>, Piece::NUMBER_OF_PIECES>
+                                                        &placements)
+{
+    const uint32_t  empty = occupant_mask(0);
+
+    for (unsigned     piece_number = 0                       ;
+                      piece_number < Piece::NUMBER_OF_PIECES ;
+                    ++piece_number                            ) {
+        _forward_placements[piece_number].clear();
+        for (const uint32_t placement : placements[piece_number])
+            if (!(placement & ~empty))
+                _forward_placements[piece_number].push_back(placement);
+    }
+
+}   // init_forward(...)
+
+
+
+// See shape.hxx
+bool Shape::forward_check(
+const unsigned      piece_number,
+const Piece* const  piece       )
+{
+    const std::array<std::vector<uint32_t>, Piece::NUMBER_OF_PIECES>
+                   &before =   piece_number
+                             ? _forward_live[piece_number - 1]
+                             : _forward_placements             ;
+    std::array<std::vector<uint32_t>, Piece::NUMBER_OF_PIECES>
+                   &after  = _forward_live[piece_number];
+
+    // Pre-placed pieces' cubicles were never in placements
+    uint32_t    mask = 0;
+    if (!piece->is_pre_placed())
+        for (unsigned ndx = 0 ; ndx < piece->size() ; ++ndx)
+            mask |= 1 << (_piece_cubicles[piece_number][ndx] - _cubicles.data());
+
+    uint32_t    coverable = 0;
+    for (unsigned     later = piece_number + 1        ;
+                      later < Piece::NUMBER_OF_PIECES ;
+                    ++later                            ) {
+        after[later].clear();
+
+        // Pre-placed, nothing to check
+        if (before[later].empty())
+            continue;
+
+        for (const uint32_t placement : before[later])
+            if (!(placement & mask)) {
+                after[later].push_back(placement);
+                coverable |= placement;
+            }
+
+        if (after[later].empty())
+            return false;
+    }
+
+    return !(occupant_mask(0) & ~coverable);
+
+}   // forward_check(const unsigned, const Piece* const)
+
+
+
+// For is_canonical() with reflection deferred until both "p" and "n"
+//   placed. Negative if symmetry maps placements at piece numbers
+//   0..piece_number to lexicographically lesser ones, zero if same,
+//   positive if greater or if reflection is not valid (moves
+//   pre-placed pieces, or reflected child shape(s) have only one of
+//   "p" and "n").
+//
+int Shape::canonical_order(
+const Symmetry      &symmetry    ,
+const unsigned       piece_number)
+const
+{
+    const unsigned  pos_code = Piece::pos.code(),
+                    neg_code = Piece::neg.code();
+
+    unsigned    pos_ndx = 0,
+                neg_ndx = 0;
+    for (unsigned ndx = 0 ; ndx <= piece_number ; ++ndx)
+        if      (_canonical_codes[ndx] == pos_code) pos_ndx = ndx;
+        else if (_canonical_codes[ndx] == neg_code) neg_ndx = ndx;
+
+    const bool  has_pos = _canonical_masks[pos_ndx] & symmetry.cubicles,
+                has_neg = _canonical_masks[neg_ndx] & symmetry.cubicles;
+    if (has_pos != has_neg)
+        return 1;
+
+    std::array<uint32_t, Piece::NUMBER_OF_PIECES>   images;
+    for (unsigned ndx = 0 ; ndx <= piece_number ; ++ndx) {
+        // Reflected "p" is "n" and vice-versa
+        uint32_t    mask = _canonical_masks[ndx];
+        if (has_pos && ndx == pos_ndx) mask = _canonical_masks[neg_ndx];
+        if (has_neg && ndx == neg_ndx) mask = _canonical_masks[pos_ndx];
+
+        images[ndx] = 0;
+        for (uint32_t bits = mask ; bits ; bits &= bits - 1)
+            images[ndx] |= 1 << symmetry.image[__builtin_ctz(bits)];
+
+        if (   (_canonical_pre_placed & (1 << ndx))
+            && images[ndx] != _canonical_masks[ndx])
+            return 1;
+    }
+
+    for (unsigned ndx = 0 ; ndx <= piece_number ; ++ndx)
+        if (images[ndx] != _canonical_masks[ndx])
+            return images[ndx] < _canonical_masks[ndx] ? -1 : 1;
+
+    return 0;
+
+}   // canonical_order(const Symmetry&, const unsigned) const
+
+
+
+// See shape.hxx
+// One line of status codes per piece number, one line of three hex
+//   _primary_pairs masks per piece number, then per piece number
+//   a line with count of solution set signatures followed by one
+//   line of hex Piece::code()s per signature.
+void Shape::write_state(
+std::ostream    &output)
+const
+{
+    for (unsigned piece = 0 ; piece < Piece::NUMBER_OF_PIECES ; ++piece) {
+        for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx)
+            output << static_cast<unsigned>(_statuses[piece][ndx]);
+        output << '\n';
+    }
+
+    output << std::hex;
+    for (const auto &primary_pairs : _primary_pairs)
+        output << primary_pairs[0]
+               << ' '
+               << primary_pairs[1]
+               << ' '
+               << primary_pairs[2]
+               << '\n';
+    output << std::dec;
+
+    // Whichever of _solutions_sets is in use, see engine()
+    auto    write_sets = [&output](const auto &solutions_sets) {
+        for (const auto &solutions : solutions_sets) {
+            output << solutions.size() << '\n';
+            for (const Signature &signature : solutions) {
+                for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx)
+                    output << "0123456789abcdef"[signature[ndx]];
+                output << '\n';
+            }
+        }
+    };
+
+    if (_engine.ordered_sets)
+        write_sets(std::get<true >(_solutions_sets));
+    else
+        write_sets(std::get<false>(_solutions_sets));
+
+}   // write_state(std::ostream&) const
+
+
+
+// See shape.hxx and write_state()
+bool Shape::read_state(
+std::istream    &input)
+{
+    std::string     line;
+
+    for (unsigned piece = 0 ; piece < Piece::NUMBER_OF_PIECES ; ++piece) {
+        if (   !(input >> line)
+            || line.size() != NUMBER_OF_CUBICLES
+            || line.find_first_not_of("0123") != std::string::npos)
+            return false;
+        for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx)
+            _statuses[piece][ndx] = static_cast<Cubicle::Status>(line[ndx]
+                                                                 - '0'   );
+    }
+
+    for (auto &primary_pairs : _primary_pairs)
+        if (!(  input
+             >> std::hex
+             >> primary_pairs[0]
+             >> primary_pairs[1]
+             >> primary_pairs[2]
+             >> std::dec        ))
+            return false;
+
+    // Into whichever of _solutions_sets is in use, see engine()
+    auto    read_sets = [&input, &line](auto &solutions_sets) {
+        for (auto &solutions : solutions_sets) {
+            size_t  count;
+            if (!(input >> count))
+                return false;
+
+            solutions.clear();
+            while (count--) {
+                if (   !(input >> line)
+                    || line.size() != NUMBER_OF_CUBICLES
+                    || line.find_first_not_of("0123456789abcdef")
+                       != std::string::npos                      )
+                    return false;
+
+                Signature   signature;
+                for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx)
+                    signature[ndx] = static_cast<uint8_t>(
+                                       line[ndx] <= '9'
+                                       ? line[ndx] - '0'
+                                       : line[ndx] - 'a' + 10);
+                solutions.insert(signature);
+            }
+        }
+        return true;
+    };
+
+    if (_engine.ordered_sets)
+        return read_sets(std::get<true >(_solutions_sets));
+    else
+        return read_sets(std::get<false>(_solutions_sets));
+
+}   // read_state(std::istream&)
+
+
+
+// See shape.hxx
+bool Shape::is_duplicate_solution(
+const unsigned  piece_number)
+{
+    return   _engine.ordered_sets
+           ? is_duplicate_solution<true >(piece_number)
+           : is_duplicate_solution<false>(piece_number);
 
 }   // is_duplicate_solution(const unsigned)
 
 
 
+// See shape.hxx
+template<bool ORDERED_SETS>
+bool Shape::is_duplicate_solution(
+const unsigned  piece_number)
+{
+    Signature   signature;
+    current_signature(signature);
+
+    // Check if in already seen solutions (or their rotations/reflections)
+    return    solutions_sets<ORDERED_SETS>()[piece_number].find(signature)
+           != solutions_sets<ORDERED_SETS>()[piece_number].end (         );
+
+}   // is_duplicate_solution<>(const unsigned)
+
+
+
 // See shape.hxx
 void Shape::add_solution(
+const unsigned  piece_number)
+{
+    if (_engine.lambda_rotation) {
+        if (_engine.ordered_sets) add_solution<true , true >(piece_number);
+        else                      add_solution<true , false>(piece_number);
+    }
+    else {
+        if (_engine.ordered_sets) add_solution<false, true >(piece_number);
+        else                      add_solution<false, false>(piece_number);
+    }
+
+}  // add_solution(const unsigned)
+
+
+
+// See shape.hxx
+template<bool LAMBDA_ROTATION, bool ORDERED_SETS>
+void Shape::add_solution(
 const unsigned  piece_number)   // can be called after any piece is placed
 {
 
     if (_children.size() == 1) {   // No need to combine/permute child solutions
-        add_solution_no_children(piece_number);
+        add_solution_no_children<LAMBDA_ROTATION, ORDERED_SETS>(piece_number);
         return;
     }
 
@@ -348,11 +925,11 @@ const unsigned  piece_number)   // can be called after any piece is placed
         child->_solutions  .clear();
         child->_solution_ps.clear();
         child->_solution_ns.clear();
-        add_solution(child)      ;
+        add_solution<LAMBDA_ROTATION, ORDERED_SETS>(child);
     }
 
     // Indices of each child's rotated/mirrored solutions
-    std::vector<unsigned>   combinations(_children.size(), 0);
+    std::array<unsigned, NUMBER_OF_CUBICLES>    combinations{};
 
     // Go through all solutions for each child
     while (  combinations[_children.size() - 1]
@@ -388,7 +965,7 @@ const unsigned  piece_number)   // can be called after any piece is placed
             }
         }
 
-        _solutions_sets[piece_number].insert(solution);
+        solutions_sets<ORDERED_SETS>()[piece_number].insert(solution);
 
         next_combination:
         // increment to next permutation
@@ -404,7 +981,7 @@ const unsigned  piece_number)   // can be called after any piece is placed
         }
     }
 
-}  // add_solution(const unsigned)
+}  // add_solution<>(const unsigned)
 
 
 
@@ -451,6 +1028,126 @@ const bool          just_test      )
 
 
 
+// See shape.hxx
+uint32_t Shape::placement_mask(
+const unsigned      cubicle_ndx    ,
+const unsigned      number_of_cubes,
+const Position      cubes[]        ,
+const unsigned      free_code      )
+const
+{
+    const Cubicle   *center = &_cubicles[cubicle_ndx];
+
+    if (center->occupant != free_code)
+        return 0;
+
+    uint32_t    mask = 1 << cubicle_ndx;
+    for (unsigned ndx = 0; ndx < number_of_cubes; ++ndx) {
+        const Cubicle   *peripheral = find_cubicle(center, cubes[ndx]);
+
+        if (!peripheral || peripheral->occupant != free_code)
+            return 0;
+
+        mask |= 1 << (peripheral - _cubicles.data());
+    }
+
+    return mask;
+
+}   // placement_mask(const unsigned  ,
+    //                const unsigned  ,
+    //                const Position[],
+    //                const unsigned  ) const
+
+
+
+// See shape.hxx
+// Centered coordinates are 2*input-max (see Position::center()), and
+//   adjacent cubicles always differ in color.
+uint32_t Shape::color_mask()
+const
+{
+    uint32_t    mask = 0;
+
+    for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx) {
+        const Position  position = input_position(ndx);
+        if ((position.x() + position.y() + position.z()) & 1)
+            mask |= 1 << ndx;
+    }
+
+    return mask;
+
+}   // color_mask() const
+
+
+
+// See shape.hxx
+unsigned Shape::free_regions(
+std::array<uint32_t, NUMBER_OF_CUBICLES>    &regions)
+const
+{
+    unsigned    num_regions = 0                ;
+    uint32_t    unvisited   = occupant_mask(0);
+
+    while (unvisited) {
+        uint32_t    region  = 0,
+                    pending = unvisited & -unvisited;  // lowest set bit
+
+        while (pending) {
+            const unsigned  ndx = __builtin_ctz(pending);
+
+            pending   &= ~(1 << ndx);
+            region    |=   1 << ndx ;
+            unvisited &= ~(1 << ndx);
+
+            for (const Cubicle *adjacent : _cubicles[ndx].ortho_adjacents)
+                if (adjacent) {
+                    const unsigned  adjacent_ndx = adjacent - _cubicles.data();
+                    if (unvisited & (1 << adjacent_ndx) & ~region)
+                        pending |= 1 << adjacent_ndx;
+                }
+        }
+
+        regions[num_regions++] = region;
+    }
+
+    return num_regions;
+
+}   // free_regions(std::array<uint32_t, NUMBER_OF_CUBICLES>&) const
+
+
+
+// See shape.hxx
+uint32_t Shape::adjacent_mask(
+const unsigned  ndx)
+const
+{
+    uint32_t    mask = 0;
+
+    for (const Cubicle *adjacent : _cubicles[ndx].ortho_adjacents)
+        if (adjacent)
+            mask |= 1 << (adjacent - _cubicles.data());
+
+    return mask;
+
+}   // adjacent_mask(const unsigned) const
+
+
+
+// See shape.hxx
+Position Shape::input_position(
+const unsigned  ndx)
+const
+{
+    const Cubicle   &cubicle = _cubicles[ndx];
+
+    return Position((cubicle.x() + _max_pos.x()) / 2,
+                    (cubicle.y() + _max_pos.y()) / 2,
+                    (cubicle.z() + _max_pos.z()) / 2);
+
+}   // input_position(const unsigned) const
+
+
+
 // See shape.hxx
 bool Shape::has_orphan()
 const
@@ -501,7 +1198,7 @@ const
 // Protected ===================================================================
 
 // Decode letter into Piece
-// Used by read() and specify()
+// Used by read(), specify(), and restart()
 //
 void Shape::set_cubicle_piece(
 Cubicle     &cubicle,
@@ -554,24 +1251,51 @@ const char   letter )
 bool Shape::prepare_solve(
 std::ostream    *errors)
 {
-    normalize             ();
-    center                ();
-    generate_symmetries   ();
-    find_adjacent_cubicles();
+    Trace::Span     trace_prepare("prepare_solve");
+
+    { Trace::Span   trace("normalize"             ); normalize             (); }
+    { Trace::Span   trace("center"                ); center                (); }
+    { Trace::Span   trace("generate_symmetries"   ); generate_symmetries   (); }
+    { Trace::Span   trace("find_adjacent_cubicles"); find_adjacent_cubicles(); }
+
+    bool    created;
+    { Trace::Span   trace("create_children"); created = create_children(); }
 
-    if (!create_children()) {
+    if (!created) {
         if (errors)
             *errors << "Has child shape with unsolvable number of cubicles"
                      << std::endl;
         return false;
     }
 
+    for (unsigned ndx = 0 ; ndx < _num_cubicles ; ++ndx)
+        _prepared_occupants[ndx] = _cubicles[ndx].occupant;
+
     return true;
 
 }  // prepare_solve(std::ostream*)
 
 
 
+// See shape.hxx
+bool Shape::is_planar()
+const
+{
+    for (const Shape *child : _children) {
+        unsigned    num_2_or_3d = 0;
+        if (child->_max_pos.z() > 0) ++num_2_or_3d;
+        if (child->_max_pos.y() > 0) ++num_2_or_3d;
+        if (child->_max_pos.x() > 0) ++num_2_or_3d;
+        if (num_2_or_3d != 2)
+            return false;
+    }
+
+    return true;
+
+}   // is_planar() const
+
+
+
 // Initialize Cubicle::.adjacents[][][] for each _cubicle
 // Fills in only needed 6 orthogonal elements of .adjacents
 //   ((plus superfluous 0,0,0)
@@ -625,7 +1349,20 @@ bool Shape::create_children()
             // For each unprocessed cubicle, populate_child() will
             //   traverse all orthogonally-connected cubicles
             //   and mark as processed.
-            Shape   *child = new Shape(0);
+            Shape   *child;
+            if (_child_pool.empty()) {
+                // Full size up front, so never reallocates when reused
+                child = new Shape(0);
+                child->_rotators_mirrorers.reserve(MAX_ROTATOR_REFLECTORS);
+                child->_solutions         .reserve(MAX_ROTATOR_REFLECTORS);
+                child->_solution_ps       .reserve(MAX_ROTATOR_REFLECTORS);
+                child->_solution_ns       .reserve(MAX_ROTATOR_REFLECTORS);
+            }
+            else {
+                child = _child_pool.back();
+                _child_pool.pop_back();
+                child->_num_cubicles = 0;
+            }
             _children.push_back(child)     ;
             populate_child(child, &cubicle);
         }
@@ -776,9 +1513,9 @@ Shape* const     shape ,
 std::ostream    *errors)
 {
 
-    // not necessary because only called at initialization, but
-    // amount of memory is trivial
-    _rotators_mirrorers.reserve(MAX_ROTATOR_REFLECTORS);
+    // full size so reused (see reset()) shape never reallocates,
+    // and amount of memory is trivial
+    shape->_rotators_mirrorers.reserve(MAX_ROTATOR_REFLECTORS);
 
     // Check solvable
     unsigned    num_2_or_3d = 0;
@@ -822,11 +1559,9 @@ const bool      mirror  )
     }
 
     // Rotate/mirror shape
-    for (unsigned ndx = 0 ; ndx  < shape->_num_cubicles ; ++ndx) {
-        Position    position = shape->_cubicles[ndx];
-        rotated[ndx](position.rotate(  Rotators::rotator(symmetry
-                                     + mirror_offset             )));
-    }
+    for (unsigned ndx = 0 ; ndx  < shape->_num_cubicles ; ++ndx)
+        rotated[ndx](rotate(shape->_cubicles[ndx], symmetry + mirror_offset));
+
 
     // Rotation has changed canonical linear ordering
     std::sort(rotated.begin(), rotated.begin() + shape->_num_cubicles);
@@ -842,9 +1577,31 @@ const bool      mirror  )
 }  // check_add_symmetric(Shape* const, const nusigned, const bool)
 
 
+// See set_statuses() in shape.hxx
+template<bool LAMBDA_ROTATION>
+void Shape::set_rotated_statuses(
+const unsigned  piece_number ,
+const char      piece_name   ,
+const bool      pair_anchored)
+{
+    if (_children.size() == 1)
+        set_statuses_no_children<LAMBDA_ROTATION>(piece_number, piece_name);
+    else
+        for (Shape *child : _children)
+            set_statuses<LAMBDA_ROTATION>(child, piece_number, piece_name);
+
+    // Separated shapes never symmetry checked, see Soma::init_shape()
+    if (pair_anchored && _children.size() == 1)
+        set_pair_statuses<LAMBDA_ROTATION>(piece_number);
+
+}  // set_rotated_statuses<>(const unsigned, const char, const bool)
+
+
+
 // Set Cubicle::status for each _cubicle
 // For doing symmetry check.
 //
+template<bool LAMBDA_ROTATION>
 void Shape::set_statuses(
 Shape* const    child       ,
 const unsigned  piece_number,
@@ -874,7 +1631,8 @@ const char      piece_name  )
             break;
 
         Signature   rotated_signature;
-        child->generate_rotated_signature(rotated_signature, rotator_mirrorer);
+        child->generate_rotated_signature<LAMBDA_ROTATION>(rotated_signature,
+                                                           rotator_mirrorer );
 
         // Add if this rotation/reflection is symmetric
         if (rotated_signature == signature)
@@ -924,8 +1682,9 @@ const char      piece_name  )
                     continue;  // already processed
 
                 Position      rotated
-                            = duplicate.rotate(  Rotators
-                                               ::rotator(rotator_mirrorer));
+                            = Rotators::rotate<LAMBDA_ROTATION>(
+                                duplicate       ,
+                                rotator_mirrorer);
 
                 if (rotated == primary) {
                     // Is rotation/reflection of primary
@@ -937,11 +1696,12 @@ const char      piece_name  )
         }
     }
 
-}  // set_statuses(Shape* const, const unsigned, const char)
+}  // set_statuses<>(Shape* const, const unsigned, const char)
 
 
 // Slightly more efficient version of set_statuses(), above,
 //
+template<bool LAMBDA_ROTATION>
 void Shape::set_statuses_no_children(
 const unsigned  piece_number,
 const char      piece_name  )
@@ -965,7 +1725,8 @@ const char      piece_name  )
             break;
 
         Signature   rotated_signature;
-        generate_rotated_signature(rotated_signature, rotator_mirrorer);
+        generate_rotated_signature<LAMBDA_ROTATION>(rotated_signature,
+                                                    rotator_mirrorer );
 
         if (rotated_signature == signature)
             _piece_rotators_mirrorers[piece_number].push_back(rotator_mirrorer);
@@ -1007,8 +1768,9 @@ const char      piece_name  )
                     continue;
 
                 Position      rotated
-                            = duplicate.rotate(  Rotators
-                                               ::rotator(rotator_mirrorer));
+                            = Rotators::rotate<LAMBDA_ROTATION>(
+                                duplicate       ,
+                                rotator_mirrorer);
 
                 if (rotated == primary) {
                     duplicate.parent->status = Cubicle::Status::DUPLICATE;
@@ -1019,7 +1781,95 @@ const char      piece_name  )
         }
     }
 
-}  // set_statuses_no_children(const unsigned, const char)
+}  // set_statuses_no_children<>(const unsigned, const char)
+
+
+
+// Like set_statuses_no_children(), above, but for pairs of cubicles
+//   instead of single ones, using _piece_rotators_mirrorers it found.
+//
+template<bool LAMBDA_ROTATION>
+void Shape::set_pair_statuses(
+const unsigned  piece_number)
+{
+    static const Position   AXES[3] = { Position(1, 0, 0),
+                                        Position(0, 1, 0),
+                                        Position(0, 0, 1) };
+
+    std::array<uint32_t, 3>     &primaries = _primary_pairs[piece_number];
+    std::array<uint32_t, 3>      unset     = {0, 0, 0};
+
+    for (unsigned ndx = 0 ; ndx < _num_cubicles ; ++ndx) {
+        if (_cubicles[ndx].occupant)
+            continue;
+        for (unsigned axis = 0 ; axis < 3 ; ++axis) {
+            const Cubicle   *partner = find_cubicle(&_cubicles[ndx], AXES[axis]);
+            if (partner && !partner->occupant)
+                unset[axis] |= 1 << ndx;
+        }
+    }
+
+    primaries.fill(0);
+
+    for (unsigned ndx = 0 ; ndx < _num_cubicles ; ++ndx)
+        for (unsigned axis = 0 ; axis < 3 ; ++axis) {
+            if (!(unset[axis] & (1 << ndx)))
+                continue;
+
+            // Mark as primary, and all rotations/reflections as processed
+            primaries[axis] |=   1 << ndx ;
+            unset    [axis] &= ~(1 << ndx);
+
+            const unsigned    partner_ndx
+                            =   find_cubicle(&_cubicles[ndx], AXES[axis])
+                              - _cubicles.data();
+
+            for (const unsigned   rotator_mirrorer
+                                : _piece_rotators_mirrorers[piece_number]) {
+                unsigned    anchor  = rotated_cubicle<LAMBDA_ROTATION>(
+                                                      ndx             ,
+                                                      rotator_mirrorer),
+                            partner = rotated_cubicle<LAMBDA_ROTATION>(
+                                                      partner_ndx     ,
+                                                      rotator_mirrorer);
+
+                // Normalize so partner is in positive direction
+                unsigned    rotated_axis = 0;
+                while (   rotated_axis < 3
+                       &&    find_cubicle(&_cubicles[anchor], AXES[rotated_axis])
+                          != &_cubicles[partner]                              )
+                    ++rotated_axis;
+                if (rotated_axis == 3) {
+                    std::swap(anchor, partner);
+                    rotated_axis = 0;
+                    while (   find_cubicle(&_cubicles[anchor], AXES[rotated_axis])
+                           != &_cubicles[partner]                              )
+                        ++rotated_axis;
+                }
+
+                unset[rotated_axis] &= ~(1 << anchor);
+            }
+        }
+
+}  // set_pair_statuses<>(const unsigned)
+
+
+
+// Index in (sorted) _cubicles of rotated/reflected _cubicles[cubicle_ndx]
+template<bool LAMBDA_ROTATION>
+unsigned Shape::rotated_cubicle(
+const unsigned  cubicle_ndx     ,
+const unsigned  rotator_mirrorer)
+const
+{
+    return   std::lower_bound(_cubicles.cbegin()                ,
+                              _cubicles.cbegin() + _num_cubicles,
+                              Rotators::rotate<LAMBDA_ROTATION>(
+                                _cubicles[cubicle_ndx],
+                                rotator_mirrorer      ))
+           - _cubicles.cbegin();
+
+}  // rotated_cubicle<>(const unsigned, const unsigned) const
 
 
 
@@ -1031,6 +1881,7 @@ const char      piece_name  )
 //   generate_rotated_signature() without need to dereference
 //   Cubicle::_parent
 //
+template<bool LAMBDA_ROTATION, bool ORDERED_SETS>
 void Shape::add_solution_no_children(
 const unsigned      piece_number)
 {
@@ -1045,8 +1896,9 @@ const unsigned      piece_number)
         for (unsigned ndx = 0 ; ndx  < _num_cubicles ; ++ndx) {
             Position    cubicle_position = _cubicles[ndx];
 
-            rotated[ndx]( cubicle_position
-                         .rotate(Rotators::rotator(rotator_mirrorer)));
+            rotated[ndx](Rotators::rotate<LAMBDA_ROTATION>(
+                           cubicle_position,
+                           rotator_mirrorer));
 
             // Exchange "p" and "n" pieces if mirrored
             unsigned    piece = _cubicles[ndx].occupant;
@@ -1065,10 +1917,10 @@ const unsigned      piece_number)
         Signature   rotated_signature;
         generate_cubicles_signature(rotated_signature, rotated, _num_cubicles);
 
-        _solutions_sets[piece_number].insert(rotated_signature);
+        solutions_sets<ORDERED_SETS>()[piece_number].insert(rotated_signature);
     }
 
-}   // add_solution_no_children(const unsigned)
+}   // add_solution_no_children<>(const unsigned)
 
 
 
@@ -1076,6 +1928,7 @@ const unsigned      piece_number)
 //   information (num_ps, num_ns) for checking combinations
 //   of rotated/reflected children in add_solution((), above.
 //
+template<bool LAMBDA_ROTATION, bool ORDERED_SETS>
 void Shape::add_solution(
 Shape* const    child)
 {
@@ -1087,7 +1940,6 @@ Shape* const    child)
         if (piece == Piece::neg.code()) ++num_ns;
     }
 
-    SignatureSet    child_solutions_set;
     for (const unsigned rotator_mirrorer : child->_rotators_mirrorers) {
         std::array<Cubicle, NUMBER_OF_CUBICLES>     rotated         ;
 
@@ -1098,24 +1950,28 @@ Shape* const    child)
             continue;
 
         Signature   rotated_signature;
-        child->generate_rotated_signature(rotated_signature, rotator_mirrorer);
-
-        // Only insert if not already seen
-        unsigned    before = child_solutions_set.size();
-        child_solutions_set.insert(rotated_signature);
-        if (child_solutions_set.size() != before) {
+        child->generate_rotated_signature<LAMBDA_ROTATION>(rotated_signature,
+                                                           rotator_mirrorer );
+
+        // Only add if not already seen. Linear search because at most
+        //   MAX_ROTATOR_REFLECTORS, and no set to allocate per solution.
+        if (std::find(child->_solutions.begin(),
+                      child->_solutions.end  (),
+                      rotated_signature        )
+            == child->_solutions.end()) {
             child->_solutions  .push_back(rotated_signature);
             child->_solution_ps.push_back(num_ps / 4);  // 4 cubicles / piece
             child->_solution_ns.push_back(num_ns / 4);  // "    "     /   "
         }
     }
-}   // add_solution(Shape* const)
+}   // add_solution<>(Shape* const)
 
 
 
 // Similar to inline code in add_solution_no_children(), above
 //   except dereferences Cubicle::_parent pointer to get cubicle occupant
 //
+template<bool LAMBDA_ROTATION>
 void Shape:: generate_rotated_signature(
       Signature     &signature       ,
 const unsigned       rotator_mirrorer)
@@ -1130,8 +1986,8 @@ const
     for (unsigned ndx = 0 ; ndx  < _num_cubicles ; ++ndx) {
         Position    cubicle_position = _cubicles[ndx];
 
-        rotated[ndx]( cubicle_position
-                     .rotate(Rotators::rotator(rotator_mirrorer)));
+        rotated[ndx](Rotators::rotate<LAMBDA_ROTATION>(cubicle_position,
+                                                       rotator_mirrorer));
 
         // occupant not copied from parent (inefficient, would have
         //   to be done in place_piece() every time)
@@ -1154,7 +2010,23 @@ const
 
     generate_cubicles_signature(signature, rotated, _num_cubicles);
 
-}  // generate_rotated_signature(Signature&, const unsigned) const
+}  // generate_rotated_signature<>(Signature&, const unsigned) const
+
+
+
+// Used by Piece::place_checked() and set_statuses() in other files
+template bool Shape::is_duplicate_solution<false>(const unsigned);
+template bool Shape::is_duplicate_solution<true >(const unsigned);
+template void Shape::add_solution<false, false>  (const unsigned);
+template void Shape::add_solution<false, true >  (const unsigned);
+template void Shape::add_solution<true , false>  (const unsigned);
+template void Shape::add_solution<true , true >  (const unsigned);
+template void Shape::set_rotated_statuses<false>(const unsigned,
+                                                 const char    ,
+                                                 const bool    );
+template void Shape::set_rotated_statuses<true >(const unsigned,
+                                                 const char    ,
+                                                 const bool    );
 
 
 }  // namespace soma
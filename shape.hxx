@@ -23,28 +23,19 @@
 
 #include <array>
 #include <iostream>
-#ifdef SOMA_STD_SET_SET
 #include <set>
-#endif
-#ifdef SOMA_STD_SET_UNORDERED
+#include <tuple>
+#include <type_traits>
 #include <unordered_set>
-#endif
 #include <vector>
 
+#include "engine.hxx"
 #include "piece.hxx"
+#include "pool.hxx"
 #include "position.hxx"
 #include "rotators.hxx"
 #include "signature.hxx"
 
-#if SOMA_STD_SET_SET + SOMA_STD_SET_UNORDERED == 0
-#warning using #define SOMA_STD_SET_SET (not #define SOMA_STD_SET_UNORDERED)
-#define SOMA_STD_SET_SET
-#endif
-
-#if SOMA_STD_SET_SET + SOMA_STD_SET_UNORDERED != 1
-#error #define one and only one of SOMA_STD_SET_SET or SOMA_STD_SET_UNORDERED
-#endif
-
 
 
 namespace soma {
@@ -77,11 +68,26 @@ class Shape {
 
     Shape(unsigned  number_of_cubicles = NUMBER_OF_CUBICLES);
 
-    ~Shape() { reset(); }
+    ~Shape();
 
-    // Reset for new SOMA shape solve
+    // Reset for new SOMA shape solve. Keeps child shapes, and all
+    //   containers' memory, for reuse by next figure.
     void    reset();
 
+    // Undo everything since read() or specify() (solutions, duplicate
+    //   and symmetry state, and all but pre-placed pieces), keeping
+    //   what prepare_solve() found (centered cubicles, adjacency,
+    //   bounding box symmetries, and child shapes), so figure can be
+    //   solved again with different Soma configuration without
+    //   re-reading it. Marks pre-placed pieces again, so call after
+    //   Piece::reset(). Only after successful read() or specify().
+    void    restart();
+
+    // Rotation and set implementations, and statistics, for figure
+    //   (see Engine). Must match the one given to Piece::placer().
+    //   Propagated to child shapes.
+    void    engine(const Engine    &engine);
+
     // See EXTENDED_HELP_TEXT in file main.cxx for file format
     bool        read(std::istream   &input     ,
                      std::ostream   *errors = 0);
@@ -104,11 +110,113 @@ class Shape {
 
     unsigned    num_children() const { return _children.size(); }
 
+    // Every child shape is two-dimensional: one cube thick (not
+    //   necessarily all in same plane) but wider than one cube in
+    //   both other directions (one-dimensional ones are reported by
+    //   generate_rotator_reflectors()), so no non-Piece::is_planar()
+    //   piece can fit
+    bool        is_planar() const;
+
+    // Bitmask (bit N for _cubicles[N]) of cubicles with given
+    //   Piece::code() occupant, default (0) those without pre-placed
+    //   (or currently placed) pieces
+    uint32_t occupant_mask(
+    const unsigned  occupant = 0)
+    const
+    {
+        uint32_t    mask = 0;
+        for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx)
+            if (_cubicles[ndx].occupant == occupant)
+                mask |= 1 << ndx;
+        return mask;
+    }
+
+    // For pre-search analysis, see Soma::analyze()
+    //
+    // 3D checkerboard coloring, bitmask of "black" cubicles
+    uint32_t                color_mask     ()                   const;
+    // Orthogonally connected regions of unoccupied cubicles, returns
+    //   how many in regions[0..]
+    unsigned                free_regions   (std::array<uint32_t,
+                                                       NUMBER_OF_CUBICLES>
+                                                          &regions) const;
+    // Bitmask of cubicles orthogonally adjacent to _cubicles[ndx]
+    uint32_t                adjacent_mask  (const unsigned ndx) const;
+    // Normalized (as in input file, 0..max) x,y,z of _cubicles[ndx]
+    Position                input_position (const unsigned ndx) const;
+
     // See _rotators_mirrorers
     // Optionally called by Soma::init_shape() if culling
     //   rotated/mirrored solutions
     bool    generate_rotator_reflectors(std::ostream    *errors);
 
+    // Cubicles occupied by each piece in currently placed pieces, as
+    //   bitmasks of Signature indices (as compared by
+    //   is_duplicate_solution()) indexed by Piece::code(), only for
+    //   codes in bitmask "codes" (others 0)
+    using Occupancy = std::array<uint32_t, Piece::NUMBER_OF_PIECES + 1>;
+    Occupancy   occupancy(const unsigned    codes) const;
+
+    // Occupancy of each distinct rotation/reflection of currently
+    //   placed pieces, as add_solution(piece_number) would add (so only
+    //   current one if generate_rotator_reflectors() not called),
+    //   except those which are not valid placements of the pieces.
+    // Uses and leaves _solution_sets[piece_number] empty.
+    // Used by Soma::estimate().
+    void        orbit(const unsigned             piece_number,
+                      const unsigned             codes       ,
+                            std::vector<Occupancy> &occupancies );
+
+    // Element of symmetry group of shape, or of one of its separated
+    //   child shapes
+    struct Symmetry {
+        // _cubicles index to rotated/mirrored index, identity outside
+        //   of child shape
+        std::array<uint8_t, NUMBER_OF_CUBICLES>     image   ;
+        uint32_t                                    cubicles;  // child's
+        bool                                        mirrored;
+    };
+
+    // Per separated child shape (or just this if none), its
+    //   _rotators_mirrorers as Symmetry elements, identity first (and
+    //   only, if generate_rotator_reflectors() not called).
+    void    child_symmetries(std::vector<std::vector<Symmetry>> &symmetries)
+                                                                    const;
+
+    // Complete symmetry breaking, see Soma::symmetry_breaking()
+    // init_canonical() after generate_rotator_reflectors(), with only
+    //   pre-placed pieces in shape.
+    // is_canonical() after placing piece (or revisiting pre-placed one)
+    //   at piece_number, with all lower piece numbers already placed.
+    //   False if some rotation/reflection of shape (or individually of
+    //   separated child shapes) maps pieces placed so far onto a
+    //   lexicographically lesser sequence of placements, comparing
+    //   bitmasks of cubicles in piece number order. Elements of the
+    //   symmetry group still tied after piece_number are kept for
+    //   piece_number + 1 (the residual symmetry group of the partial
+    //   solution), so each full solution is found once and only once
+    //   per set of its rotations/reflections. Used by Piece::place().
+    void    init_canonical();
+    bool    is_canonical  (const unsigned       piece_number,
+                           const Piece* const   piece       );
+
+    // Forward checking, see Soma::forward_checking()
+    // init_forward() after Soma::init_shape() has set valid
+    //   orientations, with all placements (bitmasks of cubicles) of
+    //   each non-pre-placed piece, by piece number.
+    // forward_check() after placing piece (or revisiting pre-placed
+    //   one) at piece_number, with all lower piece numbers already
+    //   placed and checked. Keeps placements of higher piece numbers
+    //   not overlapping any placed piece, derived from those kept at
+    //   piece_number - 1. False if any such piece has none left, or
+    //   any empty cubicle is covered by none of them. Used by
+    //   Piece::place().
+    void    init_forward (const std::array<std::vector<uint32_t>,
+                                           Piece::NUMBER_OF_PIECES>
+                                                        &placements  );
+    bool    forward_check(const unsigned                 piece_number,
+                          const Piece* const             piece       );
+
     // Check against already found solutions in _solution_sets[piece_number]
     // Partial solutions if piece_number < 6, full solutions if == 6
     // See _solution_sets
@@ -123,14 +231,51 @@ class Shape {
     //   place in shape (piece_number 0 to 6)
     void    add_solution(const unsigned     piece_number);
 
+    // Versions of above with engine() variants as template parameters
+    //   instead of tested at run time. For Piece::place().
+    template<bool ORDERED_SETS>
+    bool    is_duplicate_solution(const unsigned    piece_number);
+    template<bool LAMBDA_ROTATION, bool ORDERED_SETS>
+    void    add_solution         (const unsigned    piece_number);
+
 
     // Used by Soma::solve() when backtracking in solution tree space.
     void clear_solutions(
     const unsigned   piece_number)
     {
-        _solutions_sets[piece_number].clear();
+        if (_engine.ordered_sets)
+            solutions_sets<true >()[piece_number].clear();
+        else
+            solutions_sets<false>()[piece_number].clear();
+    }
+
+    // Pre-allocate hash tables (unless Engine::ordered_sets) for
+    //   add_solution(), for efficiency. Only first call does anything.
+    // Used by Soma::init_shape() if duplicate checking, instead of in
+    //   constructor, so Soma objects are cheap to construct.
+    void reserve_solutions()
+    {
+        if (!_engine.ordered_sets)
+            for (SignatureSet<false> &solutions : solutions_sets<false>())
+                if (solutions.bucket_count() < 1 << 14)
+                    solutions.rehash(1 << 14);
     }
 
+    // Save/restore _statuses and _solutions_sets, for Soma::checkpoint()
+    //   and Soma::resume(). Text format, see shape.cxx.
+    void    write_state(std::ostream    &output) const;
+    bool    read_state (std::istream    &input );
+
+    // Bitmask (bit N for _cubicles[N]) of cubicles piece would occupy
+    //   if placed as per place_piece(), or 0 if would not fit.
+    // Cubicles are available if occupant is free_code (normally 0 for
+    //   empty, or pre-placed piece's own code to check its geometry).
+    // Used by Piece::placements() and Piece::pre_placed_fits()
+    uint32_t    placement_mask(const unsigned   cubicle_ndx      ,
+                               const unsigned   number_of_cubes  ,
+                               const Position   cubes[]          ,
+                               const unsigned   free_code = 0    ) const;
+
     // Attempt to place piece, center cubicle of piece at cubicle_ndx
     // Used by Piece::place()
     bool    place_piece(const unsigned          cubicle_ndx      ,
@@ -140,6 +285,38 @@ class Shape {
                         const Position          cubes[]          ,
                         const bool              just_test = false);
 
+    // As per place_piece(), above, for Piece::place() with
+    //   compile-time number of cubes (see Piece::Placer)
+    template<unsigned NUMBER_OF_CUBES>
+    bool    place_piece(const unsigned          cubicle_ndx ,
+                              Piece*   const    piece       ,
+                        const unsigned          piece_number,
+                        const Position          cubes[]     )
+    {
+        Cubicle *const  center = &_cubicles[cubicle_ndx];
+        Cubicle        *peripherals[NUMBER_OF_CUBES];
+        for (unsigned ndx = 0; ndx < NUMBER_OF_CUBES; ++ndx) {
+            Cubicle *const  peripheral = find_cubicle(center, cubes[ndx]);
+
+            if (!peripheral || peripheral->occupant)
+                return  false;
+
+            peripherals[ndx] = peripheral;
+        }
+
+        center->occupant = piece->code();
+
+        // NUMBER_OF_CUBES doesn't include central one
+        _piece_cubicles[piece_number][NUMBER_OF_CUBES] = center;
+
+        for (unsigned ndx = 0; ndx < NUMBER_OF_CUBES; ++ndx) {
+            peripherals[ndx]->occupant = piece->code();
+            _piece_cubicles[piece_number][ndx] = peripherals[ndx];
+        }
+
+        return  true;
+    }
+
     // Return index of first/next in _cubicles that does not have
     //   piece placed in it.
     // Used by Piece::place() and Piece::place_next()
@@ -164,6 +341,47 @@ class Shape {
         return current;
     }
 
+    // Like first_free() and next_free() but also cubicles marked
+    //   DUPLICATE by set_statuses(). Used by Piece::place() and
+    //   Piece::place_next() for pair-anchored pieces, whose symmetry
+    //   checks are instead done by is_primary_pair().
+    //
+    unsigned first_unoccupied()
+    const
+    {
+        unsigned    first = 0;
+        while (   first < NUMBER_OF_CUBICLES
+               && _cubicles[first].status == Cubicle::Status::OCCUPIED)
+             ++first;
+        return first;
+    }
+    //
+    unsigned next_unoccupied(
+    unsigned    current)
+    const
+    {
+        while (            ++current < NUMBER_OF_CUBICLES
+               &&  _cubicles[current].status == Cubicle::Status::OCCUPIED)
+           ;
+        return current;
+    }
+
+    // Whether pair of cubicles at cubicle_ndx and its neighbor in
+    //   positive axis (0, 1, 2 for x, y, z) direction is not a
+    //   rotation/reflection of another such pair. As per Cubicle::Status
+    //   PRIMARY vs DUPLICATE, but for pair-anchored pieces (see
+    //   Piece::generate_orientations()).
+    // Always true unless set_statuses() with check_symmetry and
+    //   pair_anchored.
+    bool is_primary_pair(
+    const unsigned  piece_number,
+    const unsigned  cubicle_ndx ,
+    const unsigned  axis        )
+    const
+    {
+        return _primary_pairs[piece_number][axis] & (1 << cubicle_ndx);
+    }
+
     // Undo place_piece().
     // Used by Piece::place() after place_piece() but detecting
     //   is_duplicate_solution() or has_orphan(), or when resuming
@@ -199,14 +417,19 @@ class Shape {
     //   in shape.
     // Sets to default values if check_symmetry==false, or calls
     //   set_statuses(Shape*, unsigned, char) or
-    //   set_statuses_no_children(unsigned) otherwise.
+    //   set_statuses_no_children(unsigned) otherwise, plus
+    //   set_pair_statuses() if pair_anchored (all via
+    //   set_rotated_statuses(), per Engine::lambda_rotation).
     // Called by Soma::solve() and Soma::init_shape() for Nth and
     //   first piece to solve, respectively.
     void set_statuses(
-    const unsigned  piece_number  ,
-    const char      piece_name    ,
-    const bool      check_symmetry)
+    const unsigned  piece_number         ,
+    const char      piece_name           ,
+    const bool      check_symmetry       ,
+    const bool      pair_anchored = false)
     {
+        _primary_pairs[piece_number].fill(ALL_CUBICLES_MASK);
+
         if (!check_symmetry) {
             for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx)
                 if (_cubicles[ndx].occupant) {
@@ -221,21 +444,25 @@ class Shape {
         }
 
         reset_statuses();
-        if (_children.size() == 1)
-            set_statuses_no_children(piece_number, piece_name);
+        if (_engine.lambda_rotation)
+            set_rotated_statuses<true >(piece_number ,
+                                        piece_name   ,
+                                        pair_anchored);
         else
-            for (Shape *child : _children)
-                set_statuses(child, piece_number, piece_name);
+            set_rotated_statuses<false>(piece_number ,
+                                        piece_name   ,
+                                        pair_anchored);
 
-        for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx) {
+        for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx)
             _statuses[piece_number][ndx] = _cubicles[ndx].status;
-#ifdef SOMA_STATISTICS
-            if (_cubicles[ndx].status == Cubicle::Status::PRIMARY)
-                ++_statuses_uniques[piece_number];
-            else if (_cubicles[ndx].status == Cubicle::Status::DUPLICATE)
-                ++_statuses_duplicates[piece_number];
-#endif
-        }
+
+        if (_engine.statistics)
+            for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx) {
+                if (_cubicles[ndx].status == Cubicle::Status::PRIMARY)
+                    ++_statuses_uniques[piece_number];
+                else if (_cubicles[ndx].status == Cubicle::Status::DUPLICATE)
+                    ++_statuses_duplicates[piece_number];
+            }
     }
 
     // Used by Soma::solve() and Soma::post_solve() when backtracking
@@ -249,7 +476,7 @@ class Shape {
             _cubicles[ndx].status = _statuses[piece_number][ndx];
     }
 
-#ifdef SOMA_STATISTICS
+    // Only updated if Engine::statistics
     unsigned statuses_uniques(
     const unsigned  piece_number)
     const
@@ -263,7 +490,6 @@ class Shape {
     {
         return _statuses_duplicates[piece_number];
     }
-#endif
 
 
 
@@ -271,16 +497,25 @@ class Shape {
     // datatypes
     //
 
-#ifdef SOMA_STD_SET_SET
-    using SignatureSet = std::set<Signature>;
-    using IntSet       = std::set<int      >;
-#endif
-#ifdef SOMA_STD_SET_UNORDERED
-    using SignatureSet = std::unordered_set<Signature       ,
-                                            Signature::Hash ,
-                                            Signature::Equal>;
-    using IntSet       = std::unordered_set<int             >;
-#endif
+    // See Engine::ordered_sets. Nodes recycled across clear() and
+    //   reset(), see NodePool.
+    template<bool ORDERED_SETS>
+    using SignatureSet = typename std::conditional<
+                                    ORDERED_SETS                        ,
+                                    std::set<Signature                ,
+                                             std::less<Signature>     ,
+                                             NodePool<Signature>      >,
+                                    std::unordered_set<Signature       ,
+                                                       Signature::Hash ,
+                                                       Signature::Equal,
+                                                       NodePool<Signature>>
+                                  >::type;
+    template<bool ORDERED_SETS>
+    using SignatureSets = std::array<SignatureSet<ORDERED_SETS>,
+                                     Piece::NUMBER_OF_PIECES   >;
+    using IntSet        = std::unordered_set<int>;
+
+    static const uint32_t     ALL_CUBICLES_MASK = (1 << NUMBER_OF_CUBICLES) - 1;
 
     // *2 because normal and mirrored versions of each _rotators_mirrorers
     static const unsigned     MAX_ROTATOR_REFLECTORS
@@ -368,6 +603,32 @@ class Shape {
         for (unsigned ndx = 0 ; ndx < num_cubes ; ++ndx)
             signature[ndx] = cubes[ndx].occupant;
     }
+    // Current solution as compared by is_duplicate_solution()
+    void current_signature(
+    Signature   &signature)
+    const
+    {
+        if (_children.size() == 1)
+            generate_signature(signature);
+        else {
+            unsigned    offset = 0;
+            for (const Shape *child : _children) {
+                child->generate_signature_child(signature, offset);
+                offset += child->_num_cubicles;
+            }
+        }
+    }
+    // See occupancy()
+    static Occupancy occupancy(
+    const Signature     &signature,
+    const unsigned       codes    )
+    {
+        Occupancy   occupancy{};
+        for (unsigned ndx = 0 ; ndx < NUMBER_OF_CUBICLES ; ++ndx)
+            if (codes & (1 << signature[ndx]))
+                occupancy[signature[ndx]] |= 1 << ndx;
+        return occupancy;
+    }
     // For concatenating rotated children
     void generate_signature_child(
     Signature       &signature,
@@ -435,19 +696,58 @@ class Shape {
 
 
 
+    // Engine::lambda_rotation as template parameter, see set_statuses()
+    template<bool LAMBDA_ROTATION>
+    void    set_rotated_statuses(const unsigned     piece_number ,
+                                 const char         piece_name   ,
+                                 const bool         pair_anchored);
+
+    template<bool LAMBDA_ROTATION>
     void    set_statuses(Shape* const       child       ,
                          const unsigned     piece_number,
                          const char         piece_name  );
 
+    template<bool LAMBDA_ROTATION>
     void    set_statuses_no_children(const unsigned     piece_number,
                                      const char         piece_name  );
 
+    template<bool LAMBDA_ROTATION>
+    void    set_pair_statuses       (const unsigned     piece_number);
+    template<bool LAMBDA_ROTATION>
+    unsigned rotated_cubicle        (const unsigned     cubicle_ndx ,
+                                     const unsigned     rotator_mirrorer)
+                                                                   const;
+
+    // Rotators::rotate() as per _engine, for use outside of search
+    Position rotate(
+    const Position  position        ,
+    const unsigned  rotator_mirrorer)
+    const
+    {
+        return   _engine.lambda_rotation
+               ? Rotators::rotate<true >(position, rotator_mirrorer)
+               : Rotators::rotate<false>(position, rotator_mirrorer);
+    }
+
+    // Only one of _solutions_sets in use, per _engine
+    template<bool ORDERED_SETS>
+    SignatureSets<ORDERED_SETS> &solutions_sets()
+    {
+        return std::get<ORDERED_SETS>(_solutions_sets);
+    }
+
+    template<bool LAMBDA_ROTATION, bool ORDERED_SETS>
     void    add_solution_no_children(const unsigned     piece_number);
+    template<bool LAMBDA_ROTATION, bool ORDERED_SETS>
     void    add_solution            (Shape* const       child       );
 
+    template<bool LAMBDA_ROTATION>
     void generate_rotated_signature(Signature       &signature       ,
                                     const unsigned   rotator_mirrorer) const;
 
+    int     canonical_order(const Symmetry      &symmetry    ,
+                            const unsigned       piece_number) const;
+
 
 
     // data members
@@ -479,8 +779,9 @@ class Shape {
     //
     // Finished solutions
     std::vector<Signature>  _solutions;
-    // After Nth piece has been placed
-    std::array<SignatureSet, Piece::NUMBER_OF_PIECES>   _solutions_sets;
+    // After Nth piece has been placed, unordered and ordered (see
+    //   solutions_sets())
+    std::tuple<SignatureSets<false>, SignatureSets<true>>  _solutions_sets;
 
     // To ensure sets of concatenated rotated/mirrored child shapes
     //   contain only one each of "p" and "n" piece.
@@ -492,21 +793,59 @@ class Shape {
     //   backtracking in solution tree space
     Cubicle::Status     _statuses[Piece::NUMBER_OF_PIECES][NUMBER_OF_CUBICLES];
 
+    // See is_primary_pair(). Bitmask of cubicles per axis.
+    std::array<std::array<uint32_t, 3>, Piece::NUMBER_OF_PIECES>
+                        _primary_pairs;
+
     // Saved to avoid recomputing
     std::array<std::vector<unsigned>, Piece::NUMBER_OF_PIECES>
         _piece_rotators_mirrorers;
 
+    // For is_canonical()
+    //
+    // Non-identity rotations/reflections of shape, or of each child
+    //   shape if separated
+    std::vector<Symmetry>   _symmetry_group;
+    // Indices into _symmetry_group mapping pieces at lower piece
+    //   numbers onto themselves (or not yet comparable, see
+    //   canonical_order()), per piece number
+    std::array<std::vector<unsigned>, Piece::NUMBER_OF_PIECES + 1>
+                            _canonical_ties;
+    // Bitmask of cubicles, Piece::code(), per piece number
+    std::array<uint32_t, Piece::NUMBER_OF_PIECES>   _canonical_masks;
+    std::array<unsigned, Piece::NUMBER_OF_PIECES>   _canonical_codes;
+    // Bit per pre-placed piece number
+    unsigned                _canonical_pre_placed;
+    // Reflections not comparable until both "p" and "n" placed
+    bool                    _mirrors_deferred    ;
+
+    // For forward_check(), per piece number: all placements, and
+    //   per piece number those still possible after placing it
+    std::array<std::vector<uint32_t>, Piece::NUMBER_OF_PIECES>
+                            _forward_placements;
+    std::array<std::array<std::vector<uint32_t>, Piece::NUMBER_OF_PIECES>,
+               Piece::NUMBER_OF_PIECES>
+                            _forward_live;
+
     // One for each separated (not orthogonally contiguous) sub-shape.
     // Just one if no sub-shapes.
     std::vector<Shape*>     _children;
+    // Previous figures' children, reset() and available for reuse by
+    //   create_children(). Deleted only by destructor.
+    std::vector<Shape*>     _child_pool;
 
     // != NUMBER_OF_CUBICLES in child shapes if multiple ones
     unsigned    _num_cubicles;// variable in child shapes
 
-#ifdef SOMA_STATISTICS
+    // Cubicle::occupant after prepare_solve(), for restart()
+    std::array<unsigned, NUMBER_OF_CUBICLES>    _prepared_occupants;
+
+    // See engine()
+    Engine      _engine;
+
+    // Statistics, see Engine::statistics
     unsigned    _statuses_uniques   [Piece::NUMBER_OF_PIECES],
                 _statuses_duplicates[Piece::NUMBER_OF_PIECES];
-#endif
 
 
 
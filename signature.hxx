@@ -88,7 +88,7 @@ class Signature {
         return false;
     }
 
-#ifdef SOMA_STD_SET_UNORDERED
+    // For std::unordered_set (see Engine::ordered_sets)
     struct Hash {
         std::size_t operator()(
         const Signature     &signature)
@@ -115,7 +115,6 @@ class Signature {
     };
 
     friend class Hash;
-#endif
 
 
 
@@ -18,10 +18,25 @@
 // <https://www.gnu.org/licenses/gpl.html>
 
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iomanip>   // DEBUG
+#include <random>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "counters.hxx"
+#include "cover.hxx"
+#include "decompose.hxx"
+#include "figure.hxx"
+#include "join.hxx"
 #include "piece.hxx"
 #include "shape.hxx"
+#include "trace.hxx"
 
 #include "soma.hxx"
 
@@ -29,7 +44,8 @@
 
 namespace soma {
 
-const std::string   Soma::DEFAULT_PIECE_ORDER("ztcpnl3");
+const std::string   Soma::DEFAULT_PIECE_ORDER  ("ztcpnl3"),
+                    Soma::DEFAULT_PAIR_ANCHORED(""       );
 const unsigned      Soma::DEFAULT_P_PIECE_NDX(3        ),  // must match above
                     Soma::DEFAULT_N_PIECE_NDX(4        );  //  "     "     "
 
@@ -46,20 +62,45 @@ const std::string   &piece_order_str )
     _symmetry_checks (symmetry_checks    ),
     _dup_chks_adjstd (duplicate_checks   ),
     _sym_chks_adjstd (symmetry_checks    ),
+    _symmetry_breaking(false             ),
+    _forward_checking(false              ),
     _active_piece    (0                  ),
     _p_piece_ndx     (DEFAULT_P_PIECE_NDX),
-    _n_piece_ndx     (DEFAULT_N_PIECE_NDX)
+    _n_piece_ndx     (DEFAULT_N_PIECE_NDX),
+    _counters_enabled(false              ),
+    _stop            (0                  ),
+    _deadline        (std::chrono::steady_clock::time_point::max()),
+    _poll_countdown  (POLL_INTERVAL      ),
+    _interrupted     (false              ),
+    _hint_cells      (0                  ),
+    _hint_unused     (0                  ),
+    _hint_started    (false              )
 {
     piece_order(piece_order_str);
 
+    pair_anchored(DEFAULT_PAIR_ANCHORED);
+
     for (Piece *piece : _pieces) {
         piece->register_shape(&_shape);
+        piece->register_counters(0);
         piece->generate_orientations();
     }
 }
 
 
 
+// See soma.hxx
+void Soma::counters(
+const bool  enable)
+{
+    _counters_enabled = enable;
+
+    for (Piece *piece : _pieces)
+        piece->register_counters(enable ? &_counters : 0);
+}
+
+
+
 bool Soma::piece_order(
 const std::string   &pieces_str)
 {
@@ -97,15 +138,51 @@ const std::string   &pieces_str)
 
 
 
+// See soma.hxx
+bool Soma::pair_anchored(
+const std::string   &pieces_str)
+{
+    bool    error = false;
+    for (const char piece_char : pieces_str) {
+        auto    piece = Piece::PIECE_NAMES.find(piece_char);
+        if (   piece == Piece::PIECE_NAMES.end()
+            || !piece->second->pair_anchorable()) {
+            error = true;
+            break;
+        }
+    }
+
+    _pair_anchored = error ? DEFAULT_PAIR_ANCHORED : pieces_str;
+
+    return !error;
+}
+
+
+
 // See soma.hxx
 void Soma::reset()
 {
     _shape.reset();
 
+    reset_search();
+}
+
+
+
+// Everything but shape, for reset() and reconfigure()
+void Soma::reset_search()
+{
     for (Piece  *piece : _pieces)
         piece->reset();
 
+    _counters.reset();
+
     _active_piece = 0;
+    _interrupted  = false;
+    _infeasibility.clear();
+    _rank.reset();
+    _hint_placed.clear();
+    _hint_started = false;
 }
 
 
@@ -115,6 +192,8 @@ bool Soma::read(
 std::istream    &input ,
 std::ostream    *errors)
 {
+    Trace::Span     trace("read");
+
     reset();
 
     if (!_shape.read(input, errors))
@@ -131,6 +210,8 @@ const std::array<int, Shape::NUMBER_OF_CUBICLES * 3>     coords,
 const std::string                                        pieces,
 std::ostream                                            *errors)
 {
+    Trace::Span     trace("specify");
+
     reset();
 
     if (!_shape.specify(coords, pieces, errors))
@@ -141,39 +222,66 @@ std::ostream                                            *errors)
 
 
 
+// See soma.hxx
+bool Soma::reconfigure(
+std::ostream    *errors)
+{
+    Trace::Span     trace("reconfigure");
+
+    reset_search();
+
+    _shape.restart();
+
+    return init_shape(errors);
+}
+
+
+
 // See soma.hxx
 bool Soma::solve()
 {
+    if (!_infeasibility.empty())
+        return false;
+
     bool    is_last_piece = _active_piece == Piece::NUMBER_OF_PIECES - 1;
 
-    if (is_last_piece)
+    // If interrupted, state is at top of loop below, not after solution
+    if (is_last_piece && !_interrupted)
         post_solve();
+    _interrupted = false;
 
     // Traverse solution tree space (forward and recursing backward)
     // Returns true when first/next solution found,
     while (true) {  // explicit return statements inside loop
-        is_last_piece = _active_piece == Piece::NUMBER_OF_PIECES - 1;
+        if (--_poll_countdown == 0) {
+            _poll_countdown = POLL_INTERVAL;
+            if (   (_stop && *_stop)
+                || (   _deadline != std::chrono::steady_clock::time_point::max()
+                    && std::chrono::steady_clock::now() >= _deadline         )) {
+                _interrupted = true;
+                return false;
+            }
+        }
 
-        // Checks to do for current piece
-        bool    check_orphan   ,
-                check_duplicate,
-                check_symmetry ;
+        is_last_piece = _active_piece == Piece::NUMBER_OF_PIECES - 1;
 
-        // Need to do this because can't rely on Piece::place() to
-        // do check_duplicate==true if last piece is pre-placed
-        if (is_last_piece)
-            check_orphan = check_duplicate = check_symmetry = false;
-        else {
-            // normal
-            check_orphan    =   _orphan_checks & (1 << _active_piece),
-            check_duplicate = _dup_chks_adjstd & (1 << _active_piece),
-            check_symmetry  = _sym_chks_adjstd & (1 << _active_piece);
+        // Try to place piece, with checks selected by init_shape()
+        // Timing only if counting, and even then outside of
+        //   Piece::place() so its inner loop is unaffected
+        Piece *const            piece  = _pieces [_active_piece];
+        const Piece::Placer     placer = _placers[_active_piece];
+        bool                    placed;
+        if (_counters_enabled) {
+            const auto  begin = std::chrono::steady_clock::now();
+            placed = (piece->*placer)(_active_piece);
+              _counters[_active_piece].nanoseconds
+            += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now() - begin).count();
         }
+        else
+            placed = (piece->*placer)(_active_piece);
 
-        // Try to place piece
-        if ( _pieces[_active_piece]->place(_active_piece  ,
-                                           check_orphan   ,
-                                           check_duplicate)) {
+        if (placed) {
             // Found solution
             //
             if (is_last_piece) {
@@ -186,9 +294,17 @@ bool Soma::solve()
                     return true;
                 }
                 // Is duplicate, recurse to previous piece
+                // Counted by Piece::place() as a node, but duplicates
+                //   at other depths are rejected before that
+                if (_counters_enabled) {
+                    --_counters[_active_piece].nodes     ;
+                    ++_counters[_active_piece].duplicates;
+                }
                 post_solve();
             }
             else {
+                const bool  check_duplicate =   _dup_chks_adjstd
+                                              & (1 << _active_piece);
                 ++_active_piece;  // try next piece
                 if (check_duplicate) {
                     // Clear possible existing duplicate solutions (from
@@ -204,9 +320,11 @@ bool Soma::solve()
                 }
 
                 // For symmetry checking
+                const Piece *const  active = _pieces[_active_piece];
                 _shape.set_statuses(_active_piece                          ,
-                                    _pieces[_active_piece]->name()         ,
-                                    _sym_chks_adjstd & (1 << _active_piece));
+                                    active->name()                         ,
+                                    _sym_chks_adjstd & (1 << _active_piece),
+                                    active->is_pair_anchored()             );
             }
         }
         else {  // failed to place piece
@@ -224,83 +342,1533 @@ bool Soma::solve()
 
 
 
-// After read() or shape() of new shape to solve.
-bool Soma::init_shape(
-std::ostream    *errors)
+// See soma.hxx
+Soma::Estimate Soma::estimate(
+const unsigned      probes,
+const uint64_t      seed  )
 {
-    if (!check_preplaced(errors))
-        return false;
+    const unsigned      NUM_DEPTHS = Piece::NUMBER_OF_PIECES,
+                        LAST_PIECE = NUM_DEPTHS - 1         ;
+    const auto          begin      = std::chrono::steady_clock::now();
 
-    // Valid orienatations are subset of each piece's orientations on
-    //   per-shape-cubicle basis because no need to keep checking
-    //   an orientation at each step of recursive solve if piece cannot
-    //   fit into shape at a cubicle regardless of other pieces placed
-    //   in shape or not.
-    for (unsigned     piece_ndx = 0                       ;
-                      piece_ndx < Piece::NUMBER_OF_PIECES ;
-                    ++piece_ndx                            ) {
-        if (!_pieces[piece_ndx]->is_pre_placed())
-            for (unsigned     cubicle_ndx = 0                         ;
-                              cubicle_ndx < Shape::NUMBER_OF_CUBICLES ;
-                            ++cubicle_ndx                              )
-                _pieces[piece_ndx]->set_valid_orientations(cubicle_ndx,
-                                                           piece_ndx  );
+    // solve() returns immediately, and init_shape() may not have
+    //   set up pieces for search
+    if (!_infeasibility.empty()) {
+        Estimate    estimate = {};
+        estimate.probes = probes;
+        return estimate;
     }
 
-    // Need if checking either at any piece number
-    if (_duplicate_checks != 0 || _symmetry_checks != 0) {
-        if (!_shape.generate_rotator_reflectors(errors))
-            return false;
+    // Count tries with private counters instead of (possibly enabled)
+    //   _counters, restored at end. Also used for per-depth time per
+    //   try, which varies greatly with orphan and duplicate checks.
+    Counters    sampled;
+    for (Piece *piece : _pieces)
+        piece->register_counters(&sampled);
+
+    // Solutions from solve() are unique only if checking last piece,
+    //   so each leaf is weighted by the inverse of the number of
+    //   leaves among its rotations/reflections (as per
+    //   Shape::add_solution(), including for separated child shapes).
+    // First consecutive duplicate-checked pieces are placed only once
+    //   per set of rotated/mirrored partial solutions. If only the first
+    //   one (always, for separated shapes), leaves are those rotations/
+    //   reflections with the first piece, and any pre-placed ones,
+    //   placed as in one of the roots. If more, approximated as the
+    //   ratio of the full to the canonical partial solution's number
+    //   of rotations/reflections.
+    const bool  final_dedupe = _dup_chks_adjstd & (1 << LAST_PIECE),
+                weighted     = final_dedupe && !_symmetry_breaking;
+    unsigned    canonical    = 0;
+    while (canonical < LAST_PIECE && (_dup_chks_adjstd & (1 << canonical)))
+        ++canonical;
+
+    unsigned    root_codes = 1 << _pieces[0]->code();
+    for (const Piece *piece : _pieces)
+        if (piece->is_pre_placed())
+            root_codes |= 1 << piece->code();
+
+    std::set<Shape::Occupancy>      root_occupancies;
+    std::vector<Shape::Occupancy>   occupancies     ;
+
+    // Per-probe estimates, for means and confidence intervals
+    std::vector<double>                         nodes    (probes, 0.0),
+                                                leaves   (probes, 0.0),
+                                                solutions(probes, 0.0);
+    std::vector<std::array<double, NUM_DEPTHS>> tries    (probes      );
+
+    // Root node is same for every probe, so only enumerate once
+    std::vector<std::pair<int, unsigned>>       roots   ,
+                                                children;
+
+    std::mt19937_64     random(seed);
+
+    // Time of solve()'s final duplicate check (unlike tries, grows
+    //   with number of solutions found) measured on sampled leaves
+    uint64_t            final_checks      = 0;
+    std::chrono::steady_clock::duration     final_check_time(0);
+
+    for (unsigned piece = 0 ; piece < NUM_DEPTHS ; ++piece)
+        _shape.clear_solutions(piece);
+
+    for (unsigned probe = 0 ; probe < probes ; ++probe) {
+        double      weight = 1.0;  // product of branching factors
+        unsigned    partial = 0,  // see canonical
+                    depth   = 0;
+
+        tries[probe].fill(0.0);
+
+        while (true) {
+            const bool      is_last_piece = depth == LAST_PIECE;
+            Piece   *const  piece         = _pieces[depth];
+
+            // Same checks as solve(), except duplicate checks have
+            //   sibling scope (solve() has wider scope unless previous
+            //   piece is duplicate checked)
+            const bool  check_orphan    =    !is_last_piece
+                                          && (_orphan_checks   & (1 << depth)),
+                        check_duplicate =    !is_last_piece
+                                          && (_dup_chks_adjstd & (1 << depth));
+
+            if (depth > 0) {
+                _shape.clear_solutions(depth);
+                if (depth == _p_piece_ndx)
+                    _shape.clear_solutions(_n_piece_ndx);
+                _shape.set_statuses(depth                          ,
+                                    piece->name()                  ,
+                                    _sym_chks_adjstd & (1 << depth),
+                                    piece->is_pair_anchored()      );
+            }
+
+            // All children of current node
+            if (depth > 0 || probe == 0) {
+                const uint64_t  previous = sampled[depth].tries;
+                const auto      start    = std::chrono::steady_clock::now();
+
+                children.clear();
+                while (piece->place(depth             ,
+                                    check_orphan      ,
+                                    check_duplicate   ,
+                                    _symmetry_breaking,
+                                    _forward_checking ,
+                                    _engine           ))
+                    children.emplace_back(piece->position(),
+                                          piece->orientation());
+
+                  sampled[depth].nanoseconds
+                += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start).count();
+                tries[probe][depth] = weight * (   sampled[depth].tries
+                                                 - previous            );
+                if (depth == 0) {
+                    roots = children;
+                    if (weighted && canonical <= 1)
+                        for (const auto &root : roots) {
+                            piece->place_at(0, root.first, root.second);
+                            root_occupancies.insert(
+                              _shape.occupancy(root_codes));
+                            _shape.reset_piece(piece, 0);
+                        }
+                }
+            }
+            else {
+                children          = roots        ;
+                tries[probe][0] = tries[0][0];
+            }
+
+            if (children.empty())
+                break;
+
+            weight       *= children.size();
+            nodes[probe] += weight         ;
+
+            if (is_last_piece) {
+                leaves   [probe] = weight;
+                solutions[probe] = weight;
+
+                if (weighted) {
+                    double  inverses = 0.0;
+                    for (const auto &child : children) {
+                        piece->place_at(depth, child.first, child.second);
+                        _shape.orbit(depth, root_codes, occupancies);
+                        if (canonical <= 1) {
+                            unsigned    found = 0;  // by solve()
+                            for (const auto &occupancy : occupancies)
+                                found += root_occupancies.count(occupancy);
+                            inverses += 1.0 / found;
+                        }
+                        else
+                            inverses += double(partial) / occupancies.size();
+                        _shape.reset_piece(piece, depth);
+                    }
+                    solutions[probe] = weight / children.size() * inverses;
+                }
+
+                if (final_dedupe && !piece->is_pre_placed()) {
+                    const auto  &child = children[random() % children.size()];
+                    piece->place_at(depth, child.first, child.second);
+
+                    const auto  start = std::chrono::steady_clock::now();
+                    if (!_shape.is_duplicate_solution(depth))
+                        _shape.add_solution(depth);
+                    final_check_time += std::chrono::steady_clock::now() - start;
+                    ++final_checks;
+
+                    _shape.reset_piece(piece, depth);
+                }
+                break;
+            }
+
+            // Descend to random child
+            if (piece->is_pre_placed())
+                piece->place(depth            ,
+                             false            ,
+                             false            ,
+                             _symmetry_breaking,
+                             _forward_checking,
+                             _engine          );
+            else {
+                const auto  &child = children[random() % children.size()];
+                piece->place_at(depth, child.first, child.second);
+                // Residual symmetries and remaining placements for next
+                //   depth are from last child enumerated, not this one
+                if (_symmetry_breaking)
+                    _shape.is_canonical(depth, piece);
+                if (_forward_checking)
+                    _shape.forward_check(depth, piece);
+            }
+
+            if (++depth == canonical && weighted && canonical > 1) {
+                _shape.orbit(depth - 1, 0, occupancies);
+                partial = occupancies.size();
+            }
+        }
+
+        // Back to state after init_shape(). Piece at final depth
+        //   already removed by last (failed) place().
+        for (unsigned piece = 0 ; piece < depth ; ++piece)
+            _shape.reset_piece(_pieces[piece], piece);
+        _shape.restore_statuses(0);
     }
 
-    // Have to handle edge cases separated shapes.
-    if (_shape.num_children() == 1) {
-        _dup_chks_adjstd = _duplicate_checks;
-        _sym_chks_adjstd = _symmetry_checks ;
+    for (unsigned piece = 0 ; piece < NUM_DEPTHS ; ++piece)
+        _shape.clear_solutions(piece);
+    _active_piece = 0;
+    counters(_counters_enabled);
+
+
+    // Convert per-probe tries to seconds using measured time per try
+    //   at each depth, and sum all depths' tries
+    std::array<double, NUM_DEPTHS>  per_try;
+    for (unsigned depth = 0 ; depth < NUM_DEPTHS ; ++depth)
+        per_try[depth] = sampled[depth].tries
+                         ?   sampled[depth].nanoseconds / 1e9
+                           / sampled[depth].tries
+                         : 0.0;
+
+    std::vector<double>     total_tries(probes, 0.0),
+                            seconds    (probes, 0.0);
+    for (unsigned probe = 0 ; probe < probes ; ++probe)
+        for (unsigned depth = 0 ; depth < NUM_DEPTHS ; ++depth) {
+            total_tries[probe] += tries[probe][depth]                 ;
+            seconds    [probe] += tries[probe][depth] * per_try[depth];
+        }
+    if (final_checks) {
+        const double    per_check =   std::chrono::duration<double>(
+                                        final_check_time).count()
+                                    / final_checks;
+        for (unsigned probe = 0 ; probe < probes ; ++probe)
+            seconds[probe] += leaves[probe] * per_check;
     }
-    else {
-        // turn off all but last piece
-        _dup_chks_adjstd = 1 | 1 << 6;  // force like "-D 17" commandline option
-        _sym_chks_adjstd = 0         ;  // turn off all
+
+    // Mean and 95% confidence interval half-width
+    auto    mean_error = [probes](const std::vector<double>  &values,
+                                        double               &mean  ,
+                                        double               &error )
+    {
+        double  sum     = 0.0,
+                squares = 0.0;
+        for (const double value : values) {
+            sum     += value        ;
+            squares += value * value;
+        }
+        mean  = probes ? sum / probes : 0.0;
+        error = 0.0;
+        if (probes > 1) {
+            const double    variance =   (squares - sum * mean)
+                                       / (probes - 1)          ;
+            error = 1.96 * std::sqrt(std::max(variance, 0.0) / probes);
+        }
+    };
+
+    Estimate    estimate;
+    estimate.probes = probes;
+    mean_error(nodes      , estimate.nodes    , estimate.nodes_error    );
+    mean_error(total_tries, estimate.tries    , estimate.tries_error    );
+    mean_error(solutions  , estimate.solutions, estimate.solutions_error);
+    mean_error(seconds    , estimate.seconds  , estimate.seconds_error  );
+    estimate.elapsed =   std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - begin).count();
+
+    return estimate;
+
+}  // estimate(const unsigned, const uint64_t)
+
+
+
+// See soma.hxx
+uint64_t Soma::count()
+{
+    Trace::Span     trace("count");
+
+    if (!_infeasibility.empty())
+        return 0;
+
+    std::vector<std::vector<Shape::Symmetry>>   symmetries;
+    std::vector<Decompose::Part>                parts     ;
+
+    _shape.child_symmetries(symmetries);
+
+    for (const std::vector<Shape::Symmetry> &child : symmetries) {
+        Decompose::Part     part;
+
+        part.cells = 0;
+        for (const Shape::Symmetry &symmetry : child) {
+            Decompose::Image    image;
+
+            for (unsigned ndx = 0 ; ndx < image.size() ; ++ndx)
+                image[ndx] =   ndx < Shape::NUMBER_OF_CUBICLES
+                             ? symmetry.image[ndx]
+                             : ndx                ;
+            part.cells |= symmetry.cubicles;
+
+            if (symmetry.mirrored)
+                part.reflections.push_back(image);
+            else
+                part.rotations  .push_back(image);
+        }
+
+        parts.push_back(part);
     }
 
-    // For first piece
-    _shape.set_statuses(0                                      ,
-                        _pieces[0]->name()                     ,
-                        static_cast<bool>(_sym_chks_adjstd & 1));
+    std::vector<std::vector<uint32_t>>  items    ;
+    std::vector<uint32_t>               adjacents;
+    placement_masks(items, adjacents);
+
+    Decompose   decompose(parts, items, adjacents, _p_piece_ndx, _n_piece_ndx);
+
+    return decompose.count(unique());
+
+}  // count()
+
+
+
+// See soma.hxx
+bool Soma::join_count(
+uint64_t    &count)
+{
+    Trace::Span     trace("join_count");
+
+    const bool  unique = this->unique();
+
+    // Burnside's lemma needs group acting on all solutions, but
+    //   rotations/reflections can move pre-placed pieces, and
+    //   separated child shapes' ones can exchange "p" and "n" pieces
+    //   in only one child
+    bool    pre_placed = false;
+    for (const Piece *piece : _pieces)
+        if (piece->is_pre_placed())
+            pre_placed = true;
+
+    if (unique && (_shape.num_children() > 1 || pre_placed))
+        return false;
+
+    count = 0;
+    if (!_infeasibility.empty())
+        return true;
+
+    std::vector<std::vector<uint32_t>>  items    ;
+    std::vector<uint32_t>               adjacents;
+    placement_masks(items, adjacents);
+
+    // All cubicles, including pre-placed pieces' (only placements)
+    Join    join((1u << Shape::NUMBER_OF_CUBICLES) - 1,
+                 items                                ,
+                 adjacents                            ,
+                 _p_piece_ndx                         ,
+                 _n_piece_ndx                         );
+
+    if (!unique) {
+        count = join.count();
+        return true;
+    }
+
+    std::vector<std::vector<Shape::Symmetry>>   symmetries;
+    std::vector<Join::Image>                    images    ;
+    std::vector<bool>                           mirrored  ;
+
+    _shape.child_symmetries(symmetries);
+
+    for (const Shape::Symmetry &symmetry : symmetries[0]) {
+        Join::Image     image;
+
+        for (unsigned ndx = 0 ; ndx < image.size() ; ++ndx)
+            image[ndx] =   ndx < Shape::NUMBER_OF_CUBICLES
+                         ? symmetry.image[ndx]
+                         : ndx                ;
+
+        images  .push_back(image            );
+        mirrored.push_back(symmetry.mirrored);
+    }
+
+    count = join.unique(images, mirrored);
 
     return true;
-}  // init_shape(std::ostream*)
 
+}  // join_count(uint64_t&)
+
+
+
+// See soma.hxx
+bool Soma::ranked(
+uint64_t    &count)
+{
+    Trace::Span     trace("ranked");
+
+    if (!ranking())
+        return false;
+
+    count = _rank ? _rank->count() : 0;
+
+    return true;
+
+}  // ranked(uint64_t&)
+
+
+
+// See soma.hxx
+bool Soma::unrank(
+const uint64_t  index)
+{
+    Trace::Span     trace("unrank");
+
+    Rank::Cover     cover;
+
+    return    ranking() && _rank && _rank->unrank(index, cover)
+           && place(cover);
+
+}  // unrank(const uint64_t)
+
+
+
+// See soma.hxx
+bool Soma::rank(
+uint64_t    &index)
+{
+    Trace::Span     trace("rank");
+
+    Rank::Cover     cover;
 
+    for (const Piece *piece : _pieces)
+        if (!piece->is_pre_placed() && !piece->is_placed())
+            return false;
+
+    this->cover(cover);
+
+    return ranking() && _rank && _rank->rank(cover, index);
+
+}  // rank(uint64_t&)
+
+
+
+// See soma.hxx
+bool Soma::sample(
+std::mt19937_64     &random)
+{
+    Trace::Span     trace("sample");
+
+    Rank::Cover     cover;
+
+    return    ranking() && _rank && _rank->sample(random, cover)
+           && place(cover);
+
+}  // sample(std::mt19937_64&)
 
-// Simplistic check. Only confirms  correct number of cubes per pre-placed
-//   pieces, not correct piece shape.
-// Solve will succeed if incorrect piece shape but be meaningless.
+
+
+// Create _rank for figure, unless already (with current unique
+//   setting) or figure infeasible (leaving it null). False if unique
+//   and figure has separated shapes (see Rank::unique() regarding
+//   pre-placed pieces).
 //
-bool Soma::check_preplaced(
-std::ostream    *errors)
+bool Soma::ranking()
 {
-    bool    result = true;
+    const bool  unique = this->unique();
 
-    for (const Piece *piece : _pieces) {
-        unsigned    count;
-        if (   piece->is_pre_placed()
-            && (count = _shape.num_piece_cubicles(piece)) != piece->size()) {
-            if (errors)
-                *errors << "Pre-placed piece '"
-                        << piece->name()
-                        << "' has "
-                        << count
-                        << " cubes instead of correct "
-                        << piece->size()
-                        << std::endl;
-            result = false;
+    // Separated child shapes rotate/reflect independently (see
+    //   Shape::add_solution()), not as one group
+    if (unique && _shape.num_children() > 1)
+        return false;
+
+    if (!_infeasibility.empty() || (_rank && _rank->is_unique() == unique))
+        return true;
+
+    create_rank();
+
+    if (unique) {
+        std::vector<std::vector<Shape::Symmetry>>   symmetries;
+        std::vector<Rank::Image>                    images    ;
+        std::vector<bool>                           mirrored  ;
+
+        _shape.child_symmetries(symmetries);
+
+        for (const Shape::Symmetry &symmetry : symmetries[0]) {
+            Rank::Image     image;
+
+            for (unsigned ndx = 0 ; ndx < image.size() ; ++ndx)
+                image[ndx] =   ndx < Shape::NUMBER_OF_CUBICLES
+                             ? symmetry.image[ndx]
+                             : ndx                ;
+
+            images  .push_back(image            );
+            mirrored.push_back(symmetry.mirrored);
         }
+
+        _rank->unique(images, mirrored);
     }
 
-    return result;
-}
+    return true;
+
+}  // ranking()
+
+
+
+// New non-unique _rank (see Rank::unique()) for figure
+void Soma::create_rank()
+{
+    std::vector<std::vector<uint32_t>>  items;
+
+    cover_items(items);
+
+    // All cubicles, including pre-placed pieces' (only placements)
+    _rank.reset(new Rank((1u << Shape::NUMBER_OF_CUBICLES) - 1,
+                         items                                ,
+                         _p_piece_ndx                         ,
+                         _n_piece_ndx                         ));
+
+}  // create_rank()
+
+
+
+// See soma.hxx
+bool Soma::hint_start()
+{
+    Trace::Span     trace("hint_start");
+
+    _hint_placed.clear();
+    _hint_started = false;
+
+    if (!_infeasibility.empty())
+        return false;
+
+    // Any unique setting, only completions (Rank::tally()) needed
+    if (!_rank)
+        create_rank();
+
+    _hint_cells  = (1u << Shape::NUMBER_OF_CUBICLES) - 1;
+    _hint_unused = (1u << Piece::NUMBER_OF_PIECES  ) - 1;
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx)
+        if (_pieces[ndx]->is_pre_placed()) {
+            _hint_cells  &= ~_shape.occupant_mask(_pieces[ndx]->code());
+            _hint_unused &= ~(1 << ndx);
+        }
+        else if (_pieces[ndx]->is_placed())
+            _shape.reset_piece(_pieces[ndx], ndx);
+
+    _hint_started = true;
+
+    return true;
+
+}  // hint_start()
+
+
+
+// See soma.hxx
+bool Soma::hint_place(
+const unsigned  piece    ,
+const unsigned  placement)
+{
+    if (   !_hint_started
+        || piece >= Piece::NUMBER_OF_PIECES
+        || !(_hint_unused & (1 << piece))
+        || placement >= _rank_placements[piece].size()
+        || (_rank_placements[piece][placement].mask & ~_hint_cells))
+        return false;
+
+    const Piece::Placement  &chosen = _rank_placements[piece][placement];
+
+    _pieces[piece]->place_at(piece, chosen.position, chosen.orientation);
+
+    _hint_cells  &= ~chosen.mask  ;
+    _hint_unused &= ~(1 << piece);
+    _hint_placed.emplace_back(piece, chosen.mask);
+
+    return true;
+
+}  // hint_place(const unsigned, const unsigned)
+
+
+
+// See soma.hxx
+bool Soma::hint_undo()
+{
+    if (!_hint_started || _hint_placed.empty())
+        return false;
+
+    const unsigned  piece = _hint_placed.back().first;
+
+    _shape.reset_piece(_pieces[piece], piece);
+
+    _hint_cells  |= _hint_placed.back().second;
+    _hint_unused |= 1 << piece;
+    _hint_placed.pop_back();
+
+    return true;
+
+}  // hint_undo()
+
+
+
+// See soma.hxx
+uint64_t Soma::hint_count()
+{
+    if (!_hint_started)
+        return 0;
+
+    return _rank->completions(_hint_cells, _hint_unused);
+
+}  // hint_count()
+
+
+
+// See soma.hxx
+void Soma::hint_moves(
+std::array<std::vector<uint64_t>, Piece::NUMBER_OF_PIECES>  &moves)
+{
+    for (unsigned piece = 0 ; piece < Piece::NUMBER_OF_PIECES ; ++piece) {
+        moves[piece].assign(_hint_started ? _rank_placements[piece].size()
+                                          : 0                            ,
+                            0                                             );
+
+        if (!_hint_started || !(_hint_unused & (1 << piece)))
+            continue;
+
+        for (unsigned     placement = 0                             ;
+                          placement < _rank_placements[piece].size();
+                        ++placement                                  ) {
+            const uint32_t  mask = _rank_placements[piece][placement].mask;
+
+            if (!(mask & ~_hint_cells))
+                moves[piece][placement]
+                = _rank->completions(_hint_cells  & ~mask        ,
+                                     _hint_unused & ~(1 << piece));
+        }
+    }
+
+}  // hint_moves(std::array<std::vector<uint64_t>, ...>&)
+
+
+
+// Per piece, bitmasks of all its placements in shape as if only
+//   pre-placed pieces were placed, or only its current one if
+//   pre-placed, keeping corresponding Piece::Placement for place()
+//   in _rank_placements
+//
+void Soma::cover_items(
+std::vector<std::vector<uint32_t>>  &items)
+{
+    // Placements as in shape with only pre-placed pieces, so
+    //   temporarily remove any placed by solve(), exists(), etc.
+    std::array<int     , Piece::NUMBER_OF_PIECES>   positions   ;
+    std::array<unsigned, Piece::NUMBER_OF_PIECES>   orientations;
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx) {
+        Piece   *piece = _pieces[ndx];
+
+        positions   [ndx] = piece->position   ();
+        orientations[ndx] = piece->orientation();
+
+        if (!piece->is_pre_placed() && piece->is_placed())
+            _shape.remove_piece(piece, ndx);
+    }
+
+    items.assign(Piece::NUMBER_OF_PIECES, std::vector<uint32_t>());
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx) {
+        _pieces[ndx]->placements(_rank_placements[ndx]);  // empty if
+                                                          //   pre-placed
+        if (_pieces[ndx]->is_pre_placed())
+            items[ndx].push_back(_shape.occupant_mask(_pieces[ndx]->code()));
+
+        for (const Piece::Placement &placement : _rank_placements[ndx])
+            items[ndx].push_back(placement.mask);
+    }
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx)
+        if (!_pieces[ndx]->is_pre_placed() && positions[ndx] >= 0)
+            _pieces[ndx]->place_at(ndx, positions[ndx], orientations[ndx]);
+
+}  // cover_items(std::vector<std::vector<uint32_t>>&)
+
+
+
+// See soma.hxx
+void Soma::diagram(
+Zdd     &zdd)
+{
+    Trace::Span     trace("diagram");
+
+    std::vector<std::vector<uint32_t>>  items;
+    std::string                         names;
+
+    if (_infeasibility.empty())
+        cover_items(items);
+    else
+        items.assign(Piece::NUMBER_OF_PIECES, std::vector<uint32_t>());
+
+    for (const Piece *piece : _pieces)
+        names += piece->name();
+
+    zdd = Zdd((1u << Shape::NUMBER_OF_CUBICLES) - 1, items, names);
+
+}  // diagram(Zdd&)
+
+
+
+// See soma.hxx
+void Soma::marginals(
+Marginals   &marginals)
+{
+    Trace::Span     trace("marginals");
+
+    Zdd                     zdd ;
+    std::vector<uint64_t>   uses;
+
+    diagram(zdd);  // also sets _rank_placements, if feasible
+    zdd.marginals(uses);
+
+    marginals.solutions = zdd.count();
+
+    // Per piece, index in marginals.placements of placement's bitmask
+    std::array<std::unordered_map<uint32_t, unsigned>,
+               Piece::NUMBER_OF_PIECES                >     indices;
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx) {
+        std::vector<std::pair<uint32_t, uint64_t>>
+                   &placements = marginals.placements[ndx];
+
+        marginals.names   [ndx] = _pieces[ndx]->name();
+        marginals.cubicles[ndx].fill(0);
+        placements.clear();
+
+        if (!_infeasibility.empty())
+            continue;
+
+        if (_pieces[ndx]->is_pre_placed())
+            placements.emplace_back(
+                _shape.occupant_mask(_pieces[ndx]->code()), 0);
+        else
+            for (const Piece::Placement &placement : _rank_placements[ndx])
+                placements.emplace_back(placement.mask, 0);
+
+        for (unsigned index = 0 ; index < placements.size() ; ++index)
+            indices[ndx][placements[index].first] = index;
+    }
+
+    for (unsigned var = 0 ; var < uses.size() ; ++var) {
+        const Zdd::Variable &variable = zdd.variables()[var];
+
+        marginals.placements[variable.item]
+                            [indices[variable.item][variable.mask]]
+                            .second = uses[var];
+
+        for (uint32_t bits = variable.mask ; bits ; bits &= bits - 1)
+            marginals.cubicles[variable.item][__builtin_ctz(bits)]
+            += uses[var];
+    }
+
+}  // marginals(Marginals&)
+
+
+
+// See soma.hxx
+unsigned Soma::near_misses(
+std::vector<Move>   &solvable)
+{
+    Trace::Span     trace("near_misses");
+
+    std::vector<Figure::Coords>                         cubicles;
+    std::vector<std::pair<Figure::Coords, char>>        fixed   ;
+    std::vector<std::vector<std::vector<Figure::Coords>>>
+                                                        items   ;
+    std::array<char, Shape::NUMBER_OF_CUBICLES>         occupant;
+
+    auto    coords = [](const Position &position)
+                     {
+                         return Figure::Coords{{position.x(),
+                                                position.y(),
+                                                position.z()}};
+                     };
+
+    solvable.clear();
+    occupant.fill(0);
+    figure_items(items);
+
+    for (const Piece *piece : _pieces) {
+        if (!piece->is_pre_placed())
+            continue;
+
+        const uint32_t  mask = _shape.occupant_mask(piece->code());
+        for (unsigned ndx = 0 ; ndx < Shape::NUMBER_OF_CUBICLES ; ++ndx)
+            if (mask & (1 << ndx))
+                occupant[ndx] = piece->name();
+    }
+
+    for (unsigned ndx = 0 ; ndx < Shape::NUMBER_OF_CUBICLES ; ++ndx)
+        if (occupant[ndx])
+            fixed.emplace_back(coords(_shape.input_position(ndx)),
+                               occupant[ndx]                     );
+        else
+            cubicles.push_back(coords(_shape.input_position(ndx)));
+
+    Figure                                  figure(cubicles, fixed, items);
+    std::unordered_map<std::string, bool>   checked ;  // by canonical()
+    std::vector<Figure::Coords>             frontier;
+    unsigned                                tried = 0;
+
+    for (const Figure::Coords &from : cubicles) {
+        figure.remove(from);
+        figure.frontier(frontier);
+
+        for (const Figure::Coords &to : frontier) {
+            if (to == from)
+                continue;
+
+            figure.add(to);
+            ++tried;
+
+            const std::string   canonical = figure.canonical();
+            std::unordered_map<std::string, bool>::iterator
+                                found     = checked.find(canonical);
+
+            if (found == checked.end())
+                found = checked.emplace(canonical, figure.solvable()).first;
+
+            if (found->second)
+                solvable.push_back(Move{Position(from[0], from[1], from[2]),
+                                        Position(to  [0], to  [1], to  [2])});
+
+            figure.remove(to);
+        }
+
+        figure.add(from);
+    }
+
+    return tried;
+
+}  // near_misses(std::vector<Move>&)
+
+
+
+// Per non-pre-placed piece, cubes of its orientations, for Figure
+void Soma::figure_items(
+std::vector<std::vector<std::vector<Figure::Coords>>>   &items)
+const
+{
+    std::vector<std::vector<Position>>  orientations;
+
+    items.clear();
+
+    for (const Piece *piece : _pieces) {
+        if (piece->is_pre_placed())
+            continue;
+
+        piece->orientations(orientations);
+        items.emplace_back();
+        for (const std::vector<Position> &cubes : orientations) {
+            items.back().emplace_back();
+            for (const Position &cube : cubes)
+                items.back().back().push_back({{cube.x(),
+                                                cube.y(),
+                                                cube.z()}});
+        }
+    }
+
+}  // figure_items(std::vector<std::vector<std::vector<...>>>&) const
+
+
+
+// See soma.hxx
+bool Soma::place(
+const Rank::Cover   &cover)
+{
+    std::vector<std::vector<uint32_t>>                  items ;
+    std::array<const Piece::Placement*, Piece::NUMBER_OF_PIECES>
+                                                        chosen;
+    uint32_t                                            used  = 0;
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx)
+        if (!_pieces[ndx]->is_pre_placed() && _pieces[ndx]->is_placed())
+            _shape.reset_piece(_pieces[ndx], ndx);
+
+    // Placements as in diagram(), which needn't have been called
+    //   since read() if cover is from diagram read back from file
+    cover_items(items);
+
+    // All pieces' placements found, and not overlapping, before
+    //   placing any
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx) {
+        chosen[ndx] = 0;
+
+        if (_pieces[ndx]->is_pre_placed()) {
+            if (cover[ndx] != items[ndx].front())
+                return false;
+        }
+        else {
+            for (const Piece::Placement &placement : _rank_placements[ndx])
+                if (placement.mask == cover[ndx]) {
+                    chosen[ndx] = &placement;
+                    break;
+                }
+
+            if (!chosen[ndx])
+                return false;
+        }
+
+        if (used & cover[ndx])
+            return false;
+        used |= cover[ndx];
+    }
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx)
+        if (chosen[ndx])
+            _pieces[ndx]->place_at(ndx                   ,
+                                   chosen[ndx]->position ,
+                                   chosen[ndx]->orientation);
+
+    return true;
+
+}  // place(const Rank::Cover&)
+
+
+
+// See soma.hxx
+void Soma::cover(
+Rank::Cover     &cover)
+const
+{
+    cover.fill(0);
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx)
+        if (_pieces[ndx]->is_pre_placed() || _pieces[ndx]->is_placed())
+            cover[ndx] = _shape.occupant_mask(_pieces[ndx]->code());
+
+}  // cover(Rank::Cover&) const
+
+
+
+// See soma.hxx
+bool Soma::store(
+      std::ostream                  &output   ,
+const std::vector<Rank::Cover>      &solutions)
+{
+    Trace::Span     trace("store");
+
+    std::vector<std::vector<uint32_t>>                  items ;
+    std::string                                         names ;
+    std::array<int, Shape::NUMBER_OF_CUBICLES * 3>      coords;
+    std::vector<Store::Coords>                          cubicles;
+
+    if (_infeasibility.empty())
+        cover_items(items);
+    else
+        items.assign(Piece::NUMBER_OF_PIECES, std::vector<uint32_t>());
+
+    for (const Piece *piece : _pieces)
+        names += piece->name();
+
+    _shape.solution(coords);
+    for (unsigned ndx = 0 ; ndx < Shape::NUMBER_OF_CUBICLES ; ++ndx)
+        cubicles.push_back(Store::Coords{{coords[ndx * 3    ],
+                                          coords[ndx * 3 + 1],
+                                          coords[ndx * 3 + 2]}});
+
+    return Store::write(output, names, cubicles, items, solutions);
+
+}  // store(std::ostream&, const std::vector<Rank::Cover>&)
+
+
+
+// Per piece, bitmasks of all its placements in shape, or only its
+//   current one if pre-placed, and per cubicle, bitmask of cubicles
+//   adjacent to it, as needed by Decompose and Join
+//
+void Soma::placement_masks(
+std::vector<std::vector<uint32_t>>  &items    ,
+std::vector<uint32_t>               &adjacents)
+const
+{
+    items    .clear();
+    adjacents.clear();
+
+    for (unsigned ndx = 0 ; ndx < Shape::NUMBER_OF_CUBICLES ; ++ndx)
+        adjacents.push_back(_shape.adjacent_mask(ndx));
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx) {
+        items.emplace_back();
+
+        if (_pieces[ndx]->is_pre_placed())
+            items.back().push_back(_shape.occupant_mask(_pieces[ndx]->code()));
+        else {
+            std::vector<Piece::Placement>   placements;
+            _pieces[ndx]->placements(placements);
+            for (const Piece::Placement &placement : placements)
+                items.back().push_back(placement.mask);
+        }
+    }
+
+}  // placement_masks(std::vector<std::vector<uint32_t>>&, ...) const
+
+
+
+// See soma.hxx
+bool Soma::exists(
+const uint64_t  seed)
+{
+    Trace::Span     trace("exists");
+
+    if (!_infeasibility.empty())
+        return false;
+
+    // Cover items are non-pre-placed pieces
+    std::vector<unsigned>                       piece_ndxs ;
+    std::vector<std::vector<Piece::Placement>>  placements ;
+    std::vector<std::vector<uint32_t>>          masks      ;
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx) {
+        if (_pieces[ndx]->is_pre_placed())
+            continue;
+
+        piece_ndxs.push_back(ndx);
+        placements.emplace_back();
+        _pieces[ndx]->placements(placements.back());
+
+        masks.emplace_back();
+        for (const Piece::Placement &placement : placements.back())
+            masks.back().push_back(placement.mask);
+    }
+
+    Cover                   cover(_shape.occupant_mask(), masks);
+    std::vector<unsigned>   chosen;
+
+    if (!cover.solve(seed, chosen))
+        return false;
+
+    for (unsigned item = 0 ; item < piece_ndxs.size() ; ++item) {
+        const Piece::Placement  &placement = placements[item][chosen[item]];
+        _pieces[piece_ndxs[item]]->place_at(piece_ndxs[item]     ,
+                                            placement.position   ,
+                                            placement.orientation);
+    }
+
+    return true;
+
+}  // exists(const uint64_t)
+
+
+
+// See soma.hxx
+// Format is:
+//   yass-checkpoint <version>
+//   <piece order> <orphans> <duplicates> <symmetries>
+//     <pair anchored or "-"> <symmetry breaking>
+//   <active piece> <interrupted>
+//   7 lines of <position> <orientation>, in piece order
+//   Shape::write_state()
+void Soma::checkpoint(
+std::ostream    &output)
+const
+{
+    output << "yass-checkpoint "
+           << CHECKPOINT_VERSION
+           << '\n'
+           << _piece_order
+           << ' '
+           << _orphan_checks
+           << ' '
+           << _duplicate_checks
+           << ' '
+           << _symmetry_checks
+           << ' '
+           << (_pair_anchored.empty() ? "-" : _pair_anchored)
+           << ' '
+           << _symmetry_breaking
+           << '\n'
+           << _active_piece
+           << ' '
+           << _interrupted
+           << '\n';
+
+    for (const Piece *piece : _pieces)
+        output << piece->position()
+               << ' '
+               << piece->orientation()
+               << '\n';
+
+    _shape.write_state(output);
+
+    output << std::flush;
+
+}  // checkpoint(std::ostream&) const
+
+
+
+// See soma.hxx and checkpoint()
+bool Soma::resume(
+std::istream    &input ,
+std::ostream    *errors)
+{
+    std::string     magic      ,
+                    order      ,
+                    anchored   ;
+    unsigned        version    ,
+                    orphans    ,
+                    duplicates ,
+                    symmetries ,
+                    active     ;
+    bool            breaking   ,
+                    interrupted;
+
+    if (   !(input >> magic >> version)
+        || magic   != "yass-checkpoint"
+        || version != CHECKPOINT_VERSION) {
+        if (errors)
+            *errors << "Not a version "
+                    << CHECKPOINT_VERSION
+                    << " checkpoint"
+                    << std::endl;
+        return false;
+    }
+
+    if (   !(  input
+             >> order
+             >> orphans
+             >> duplicates
+             >> symmetries
+             >> anchored
+             >> breaking  )
+        || order      != _piece_order
+        || orphans    != _orphan_checks
+        || duplicates != _duplicate_checks
+        || symmetries != _symmetry_checks
+        || anchored   != (_pair_anchored.empty() ? "-" : _pair_anchored)
+        || breaking   != _symmetry_breaking                             ) {
+        if (errors)
+            *errors << "Checkpoint has different -P/-O/-D/-S/-A/-b settings"
+                    << std::endl;
+        return false;
+    }
+
+    if (   !(input >> active >> interrupted)
+        || active >= Piece::NUMBER_OF_PIECES) {
+        if (errors)
+            *errors << "Bad checkpoint search state" << std::endl;
+        return false;
+    }
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx) {
+        int         position   ;
+        unsigned    orientation;
+
+        if (!(input >> position >> orientation)) {
+            if (errors)
+                *errors << "Bad checkpoint piece state" << std::endl;
+            return false;
+        }
+
+        if (position < 0 && !_pieces[ndx]->is_pre_placed())
+            continue;  // not placed
+
+        if (!_pieces[ndx]->place_at(ndx, position, orientation)) {
+            if (errors)
+                *errors << "Checkpoint piece '"
+                        << _pieces[ndx]->name()
+                        << "' does not fit figure"
+                        << std::endl;
+            return false;
+        }
+    }
+
+    if (!_shape.read_state(input)) {
+        if (errors)
+            *errors << "Bad checkpoint statuses or duplicate solutions"
+                    << std::endl;
+        return false;
+    }
+
+    _active_piece = active     ;
+    _interrupted  = interrupted;
+    _shape.restore_statuses(_active_piece);
+
+    // Residual symmetries of placed pieces, not saved in checkpoint
+    if (_symmetry_breaking)
+        for (unsigned ndx = 0 ; ndx < _active_piece ; ++ndx)
+            _shape.is_canonical(ndx, _pieces[ndx]);
+
+    // Same for remaining placements
+    if (_forward_checking)
+        for (unsigned ndx = 0 ; ndx < _active_piece ; ++ndx)
+            _shape.forward_check(ndx, _pieces[ndx]);
+
+    return true;
+
+}  // resume(std::istream&, std::ostream*)
+
+
+
+// After read() or shape() of new shape to solve.
+bool Soma::init_shape(
+std::ostream    *errors)
+{
+    Trace::Span     trace("init_shape");
+
+    // Before anything that rotates shape or checks duplicates
+    _shape.engine(_engine);
+
+    // Pieces can't be symmetry checked unless pair-anchored (see
+    //   Piece::_pair_anchored), so are regardless of pair_anchored()
+    for (unsigned     piece_ndx = 0                       ;
+                      piece_ndx < Piece::NUMBER_OF_PIECES ;
+                    ++piece_ndx                            ) {
+        Piece *const    piece = _pieces[piece_ndx];
+        const bool      pair  =    piece->pair_anchorable()
+                                && (      _pair_anchored.find(piece->name())
+                                       != std::string::npos
+                                    || (_symmetry_checks & (1 << piece_ndx)));
+        if (pair != piece->is_pair_anchored())
+            piece->generate_orientations(pair);
+    }
+
+    if (!check_preplaced(errors))
+        return false;
+
+    // Nothing else to do for one-cube-thick figures (and no need for
+    //   analyze(), etc.) because "c", "p", and "n" can't fit
+    if (_shape.is_planar()) {
+        std::ostringstream  reasons;
+        for (const Piece *piece : _pieces)
+            if (!piece->is_planar())
+                reasons << "Piece '"
+                        << piece->name()
+                        << "' does not fit in one-cube-thick figure"
+                        << std::endl;
+        _infeasibility = reasons.str();
+        return true;
+    }
+
+    // Valid orienatations are subset of each piece's orientations on
+    //   per-shape-cubicle basis because no need to keep checking
+    //   an orientation at each step of recursive solve if piece cannot
+    //   fit into shape at a cubicle regardless of other pieces placed
+    //   in shape or not.
+    {
+        Trace::Span     trace_valid("valid_orientations");
+        for (unsigned     piece_ndx = 0                       ;
+                          piece_ndx < Piece::NUMBER_OF_PIECES ;
+                        ++piece_ndx                            ) {
+            if (!_pieces[piece_ndx]->is_pre_placed())
+                for (unsigned     cubicle_ndx = 0                         ;
+                                  cubicle_ndx < Shape::NUMBER_OF_CUBICLES ;
+                                ++cubicle_ndx                              )
+                    _pieces[piece_ndx]->set_valid_orientations(cubicle_ndx,
+                                                               piece_ndx  );
+        }
+    }
+
+    // Need if checking either at any piece number
+    if (   _duplicate_checks != 0
+        || _symmetry_checks  != 0
+        || _symmetry_breaking     ) {
+        Trace::Span     trace_rotators("rotator_reflectors");
+        if (!_shape.generate_rotator_reflectors(errors))
+            return false;
+    }
+
+    {
+        Trace::Span     trace_analyze("analyze");
+        analyze();
+    }
+
+    // Have to handle edge cases separated shapes.
+    if (_symmetry_breaking) {
+        // not needed, and would conflict with Shape::is_canonical()
+        _dup_chks_adjstd = 0;
+        _sym_chks_adjstd = 0;
+        _shape.init_canonical();
+    }
+    else if (_shape.num_children() == 1) {
+        _dup_chks_adjstd = _duplicate_checks;
+        _sym_chks_adjstd = _symmetry_checks ;
+    }
+    else {
+        // turn off all but last piece
+        _dup_chks_adjstd = 1 | 1 << 6;  // force like "-D 17" commandline option
+        _sym_chks_adjstd = 0         ;  // turn off all
+    }
+
+    if (_dup_chks_adjstd)
+        _shape.reserve_solutions();
+
+    // Pre-placed pieces have no remaining placements to check
+    if (_forward_checking) {
+        Trace::Span     trace_forward("forward");
+
+        std::array<std::vector<uint32_t>, Piece::NUMBER_OF_PIECES>  placements;
+        for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx)
+            if (!_pieces[ndx]->is_pre_placed()) {
+                std::vector<Piece::Placement>   piece_placements;
+                _pieces[ndx]->placements(piece_placements);
+                for (const Piece::Placement &placement : piece_placements)
+                    placements[ndx].push_back(placement.mask);
+            }
+
+        _shape.init_forward(placements);
+    }
+
+    // Specialized Piece::place() for each piece number in solve(),
+    //   instead of testing checks at every iteration
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx) {
+        // Need to do this because can't rely on Piece::place() to
+        //   do check_duplicate==true if last piece is pre-placed
+        const bool  is_last_piece = ndx == Piece::NUMBER_OF_PIECES - 1;
+
+        // Canonical and forward checks needed at last piece (e.g.
+        //   if is "n"), unlike others
+        _placers[ndx] = _pieces[ndx]->placer(
+                            !is_last_piece && (_orphan_checks   & 1 << ndx),
+                            !is_last_piece && (_dup_chks_adjstd & 1 << ndx),
+                            _symmetry_breaking                             ,
+                            _forward_checking                              ,
+                            _engine                                        );
+    }
+
+    // For first piece
+    _shape.set_statuses(0                                      ,
+                        _pieces[0]->name()                     ,
+                        static_cast<bool>(_sym_chks_adjstd & 1),
+                        _pieces[0]->is_pair_anchored()         );
+
+    return true;
+}  // init_shape(std::ostream*)
+
+
+
+// Checks correct number of cubes per pre-placed piece, and if so that
+//   they form one of the piece's orientations (see pre_placed_fits()).
+//
+bool Soma::check_preplaced(
+std::ostream    *errors)
+{
+    bool    result = true;
+
+    for (const Piece *piece : _pieces) {
+        unsigned    count;
+        if (   piece->is_pre_placed()
+            && (count = _shape.num_piece_cubicles(piece)) != piece->size()) {
+            if (errors)
+                *errors << "Pre-placed piece '"
+                        << piece->name()
+                        << "' has "
+                        << count
+                        << " cubes instead of correct "
+                        << piece->size()
+                        << std::endl;
+            result = false;
+        }
+        else if (piece->is_pre_placed() && !pre_placed_fits(piece)) {
+            if (errors)
+                *errors << "Pre-placed piece '"
+                        << piece->name()
+                        << "' cubes are not its shape"
+                        << std::endl;
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+
+
+// Mutually mirrored "p" and "n" pieces are accepted with each other's
+//   shapes if both are pre-placed (names swapped, but still one of
+//   each, so solutions are valid).
+//
+bool Soma::pre_placed_fits(
+const Piece     *piece)
+const
+{
+    if (piece != &Piece::pos && piece != &Piece::neg)
+        return piece->pre_placed_fits(*piece);
+
+    const Piece &mirror = piece == &Piece::pos ? Piece::neg : Piece::pos;
+
+    if (piece->pre_placed_fits(*piece))
+        return !mirror.is_pre_placed() || mirror.pre_placed_fits(mirror);
+
+    return    mirror.is_pre_placed()
+           && piece ->pre_placed_fits(mirror)
+           && mirror. pre_placed_fits(*piece);
+
+}  // pre_placed_fits(const Piece*) const
+
+
+
+// Pre-search infeasibility analysis, from every placement of every
+//   piece in empty (except for pre-placed pieces) shape. Sets
+//   _infeasibility if figure certainly unsolvable because:
+//   - a piece has no placements
+//   - an unoccupied cubicle is covered by no placement
+//   - no assignment of pieces to separated regions of unoccupied
+//     cubicles matches region sizes and 3D checkerboard color
+//     imbalances (black minus white cubicles)
+// Not complete: passing does not guarantee a solution.
+//
+void Soma::analyze()
+{
+    std::ostringstream              reasons ;
+    const uint32_t                  free     = _shape.occupant_mask(),
+                                    black    = _shape.color_mask   ();
+    std::array<uint32_t, Shape::NUMBER_OF_CUBICLES>     regions ;
+    const unsigned                  num_regions
+                                    = _shape.free_regions(regions);
+    std::array<unsigned, Piece::NUMBER_OF_PIECES>       pieces  ;  // non-pre-
+    unsigned                        num_pieces = 0;                //   placed
+    uint32_t                        covered  = 0;
+
+    // Per piece and region, bitmask of possible imbalances + 4
+    std::array<std::array<unsigned, Shape::NUMBER_OF_CUBICLES>,
+               Piece::NUMBER_OF_PIECES                        >   imbalances;
+
+    auto    imbalance = [black](const uint32_t mask)
+    {
+        return   __builtin_popcount(mask &  black)
+               - __builtin_popcount(mask & ~black);
+    };
+
+    for (unsigned ndx = 0 ; ndx < Piece::NUMBER_OF_PIECES ; ++ndx) {
+        if (_pieces[ndx]->is_pre_placed())
+            continue;
+
+        _pieces[ndx]->placements(_placements);
+        if (_placements.empty())
+            reasons << "Piece '"
+                    << _pieces[ndx]->name()
+                    << "' does not fit anywhere in figure"
+                    << std::endl;
+
+        pieces[num_pieces] = ndx;
+        imbalances[num_pieces].fill(0);
+
+        for (const Piece::Placement &placement : _placements) {
+            covered |= placement.mask;
+            for (unsigned region = 0 ; region < num_regions ; ++region)
+                if (placement.mask & regions[region])
+                    imbalances[num_pieces][region]
+                    |= 1 << (imbalance(placement.mask) + 4);
+        }
+
+        ++num_pieces;
+    }
+
+    for (unsigned ndx = 0 ; ndx < Shape::NUMBER_OF_CUBICLES ; ++ndx)
+        if (free & ~covered & (1 << ndx)) {
+            const Position  position = _shape.input_position(ndx);
+            reasons << "Cubicle at x,y,z "
+                    << static_cast<int>(position.x())
+                    << ','
+                    << static_cast<int>(position.y())
+                    << ','
+                    << static_cast<int>(position.z())
+                    << " can not be covered by any piece"
+                    << std::endl;
+        }
+
+    // Assign each piece to a region (size pruned), then check each
+    //   region's imbalance is a possible sum of its pieces' imbalances
+    if (reasons.tellp() == 0) {
+        std::array<int     , Shape::NUMBER_OF_CUBICLES>     sizes   ;
+        std::array<unsigned, Piece::NUMBER_OF_PIECES   >    assigned;
+
+        for (unsigned region = 0 ; region < num_regions ; ++region)
+            sizes[region] = __builtin_popcount(regions[region]);
+
+        // Recursive via self parameter instead of std::function, which
+        //   would allocate for this many captures
+        auto    assign = [&](auto &self, unsigned piece) -> bool
+        {
+            if (piece == num_pieces) {
+                for (unsigned region = 0 ; region < num_regions ; ++region) {
+                    // Set of possible sums, offset by 32
+                    uint64_t    sums = 1ull << 32;
+                    for (unsigned ndx = 0 ; ndx < num_pieces ; ++ndx) {
+                        if (assigned[ndx] != region)
+                            continue;
+                        uint64_t    next = 0;
+                        for (int value = -4 ; value <= 4 ; ++value)
+                            if (imbalances[ndx][region] & (1 << (value + 4)))
+                                next |=   value >= 0 ? sums <<  value
+                                                     : sums >> -value;
+                        sums = next;
+                    }
+                    if (!(sums & (1ull << (imbalance(regions[region]) + 32))))
+                        return false;
+                }
+                return true;
+            }
+
+            const int   size = _pieces[pieces[piece]]->size();
+            for (unsigned region = 0 ; region < num_regions ; ++region)
+                if (imbalances[piece][region] && sizes[region] >= size) {
+                    sizes[region] -= size  ;
+                    assigned[piece] = region;
+                    const bool  found = self(self, piece + 1);
+                    sizes[region] += size;
+                    if (found)
+                        return true;
+                }
+
+            return false;
+        };
+
+        if (!assign(assign, 0)) {
+            if (num_regions == 1)
+                reasons << "Checkerboard color imbalance of figure ("
+                        << imbalance(free)
+                        << ") not possible with pieces"
+                        << std::endl;
+            else
+                reasons << "No assignment of pieces to "
+                        << num_regions
+                        << " separated regions matches their sizes and "
+                           "checkerboard color imbalances"
+                        << std::endl;
+        }
+    }
+
+    _infeasibility = reasons.str();
+
+}  // analyze()
 
 
 
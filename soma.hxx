@@ -22,10 +22,23 @@
 #define SOMA_HXX
 
 #include <array>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
 #include <iostream>
-
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "counters.hxx"
+#include "engine.hxx"
+#include "enumerate.hxx"
+#include "figure.hxx"
 #include "piece.hxx"
+#include "rank.hxx"
 #include "shape.hxx"
+#include "store.hxx"
+#include "zdd.hxx"
 
 
 namespace soma {
@@ -45,7 +58,8 @@ class Soma {
                             MICRO_VERSION = 0;
 
     // Client code can override
-    static const std::string    DEFAULT_PIECE_ORDER;
+    static const std::string    DEFAULT_PIECE_ORDER  ,
+                                DEFAULT_PAIR_ANCHORED;
 
     // Arguments set performance optimizations
     // See EXTENDED_HELP_TEXT in file main.cxx
@@ -75,10 +89,282 @@ class Soma {
                   const std::string                                     pieces,
                   std::ostream                                     *errors = 0);
 
+    // Prepare figure from last successful read() or shape() again for
+    //   solve(), with current configuration (changed since by
+    //   orphans(), piece_order(), etc), without re-reading it or
+    //   repeating its configuration-independent analysis (see
+    //   Shape::restart()). Returns as per read().
+    bool    reconfigure(std::ostream *errors = 0);
+
     // Returns true on successful solve.
     // Client can call repeatedly for multiple solutions of same SOMA figure.
+    // Also returns false if interrupted (see interruptible()), in which
+    //   case interrupted() is true and calling again continues search.
     bool    solve();
 
+    // Empty if figure might be solvable, otherwise reasons (one per
+    //   line) found by pre-search analysis in read() or shape(), in which
+    //   case solve() and exists() return false immediately.
+    const std::string&  infeasibility() const { return _infeasibility; }
+
+    // Existence-only query. Returns true, with solution in shape for
+    //   print() or solution(), if figure has any solution.
+    // Uses Cover (see cover.hxx) instead of solve()'s search, so ignores
+    //   orphans/duplicates/symmetries/piece_order settings.
+    // Client must call read() or shape() again before solve().
+    bool    exists(const uint64_t   seed = 1);
+
+    // Number of solutions repeated solve() calls would find (unique,
+    //   unless neither duplicates() 7 nor symmetry_breaking()), by
+    //   covering each separated child shape independently with each
+    //   fitting subset of pieces and summing products of per-child
+    //   counts over all assignments of pieces to children, and the
+    //   same for regions of each child split apart by placed pieces
+    //   (see decompose.hxx). Much faster than solve() for separated
+    //   shapes, and faster for all (not unique) solutions of others,
+    //   but slower for their unique ones (no orphan pruning).
+    // Doesn't change shape, and ignores piece_order, etc.
+    uint64_t    count();
+
+    // Number of solutions, as per count(), by meet-in-the-middle join
+    //   of partial solutions by two groups of pieces (see join.hxx),
+    //   unique ones by Burnside's lemma over shape's symmetries.
+    //   Faster than solve() for figures with many solutions.
+    // Returns false, without count, if unique solutions and figure
+    //   has separated shapes or pre-placed pieces.
+    bool        join_count(uint64_t &count);
+
+    // Solutions in fixed order: lowest-numbered empty cubicle filled
+    //   by each piece in piece_order() in turn, in Piece::placements()
+    //   order. Unique ones, as per count(), are those least (by
+    //   cubicles of each piece) of their rotations/reflections, and
+    //   numbered in that order among themselves.
+    // First call after read() or shape() counts solutions completing
+    //   each partial one (and lists unique ones, if so), see rank.hxx,
+    //   then unrank(), rank(), and sample() each place just one
+    //   piece at a time.
+    // unrank() and sample() leave solution in shape for print() or
+    //   solution(). Client must call read() or shape() again before
+    //   solve().
+    // All return false if unique solutions and figure has separated
+    //   shapes, and unrank(), rank(), and sample() if no such
+    //   solution.
+    //
+    // Number of solutions, as per count()
+    bool        ranked(uint64_t        &count);
+    // Solution number index (from 0)
+    bool        unrank(const uint64_t   index);
+    // Number of solution in shape (after solve(), exists(), unrank(),
+    //   or sample()), or of its unique equivalent
+    bool        rank  (uint64_t        &index);
+    // Uniformly random solution
+    bool        sample(std::mt19937_64 &random);
+
+    // Decision diagram of all solutions (as per count() with
+    //   reflects_rotates), built in one pass like ranked() and
+    //   independent of it. Empty if figure found infeasible. See
+    //   zdd.hxx for counting, enumerating, sampling, and writing to
+    //   file.
+    void        diagram(Zdd &zdd);
+
+    // For all solutions (as per diagram()), number using each piece
+    //   placement and having each piece cover each cubicle, from one
+    //   counting pass over diagram. Placements used by all solutions
+    //   are forced, those used by none impossible.
+    struct Marginals {
+        uint64_t    solutions;
+
+        std::array<char, Piece::NUMBER_OF_PIECES>   names;
+
+        // Per piece, (cubicles bitmask, number of solutions) for each
+        //   placement in Piece::placements() order, or only one if
+        //   pre-placed
+        std::array<std::vector<std::pair<uint32_t, uint64_t>>,
+                   Piece::NUMBER_OF_PIECES                    >
+                    placements;
+
+        // Per piece and cubicle (in solution() order)
+        std::array<std::array<uint64_t, Shape::NUMBER_OF_CUBICLES>,
+                   Piece::NUMBER_OF_PIECES                        >
+                    cubicles;
+    };
+    void        marginals(Marginals &marginals);
+
+    // Interactive session: client places and removes pieces one at a
+    //   time, each piece and placement numbered as per Marginals
+    //   (names, and Piece::placements() order), and asks how many
+    //   solutions (all, as per diagram()) complete the pieces placed
+    //   so far, or would after each possible next placement. Counts
+    //   are memoized per set of empty cubicles and unused pieces (see
+    //   ranked()), and kept across calls and sessions until read() or
+    //   shape(), so each answer is a few table lookups once explored.
+    // hint_start() removes any pieces placed by solve() etc., keeping
+    //   pre-placed ones, and returns false if figure found infeasible
+    //   (then other calls do nothing). Pieces are placed in shape, so
+    //   print() shows them, and as per unrank() regarding solve().
+    bool        hint_start();
+    // False if piece already placed, or placement doesn't fit
+    bool        hint_place(const unsigned   piece     ,
+                           const unsigned   placement );
+    // Remove most recently placed piece, false if none
+    bool        hint_undo ();
+    // Solutions completing current pieces
+    uint64_t    hint_count();
+    // Per piece, per placement, solutions completing current pieces
+    //   plus that placement, zero if dead end, piece already placed,
+    //   or doesn't fit
+    void        hint_moves(std::array<std::vector<uint64_t>,
+                                      Piece::NUMBER_OF_PIECES>  &moves);
+
+    // One-cube edits making figure solvable: each cubicle without a
+    //   pre-placed piece moved to each unoccupied position
+    //   orthogonally adjacent to rest of figure. All edits share one
+    //   Figure, whose placements are updated only through moved
+    //   cubicle, and are checked (as per exists()) once per distinct
+    //   edited figure up to rotation/reflection. Ignores
+    //   infeasibility(), and doesn't change shape.
+    // Positions x,y,z are as per infeasibility() (input file's, from
+    //   0), so to can be -1 or one past figure's extent. Returns
+    //   number of edits tried.
+    struct Move {
+        Position    from,
+                    to  ;
+    };
+    unsigned    near_misses(std::vector<Move> &solvable);
+
+    // Generated figures (see enumerate.hxx) of NUMBER_OF_CUBICLES
+    //   cubicles whose bounding box is box (x, y, z sizes), once each
+    //   up to rotation/reflection, meeting Enumerate rules, and having
+    //   a solution as per exists(). Calls found(coords) for each, with
+    //   coords as per shape() (all to be solved), so found() can
+    //   shape() and count() it, etc, until found() returns false.
+    // Calls reset() first. Figures meeting rules, and how many
+    //   solvable, in candidates and solvable. False, without
+    //   enumerating, if box has more than Enumerate::MAX_CELLS or
+    //   fewer than NUMBER_OF_CUBICLES cells.
+    template<typename Found>
+    bool        enumerate(const std::array<unsigned, 3>    &box       ,
+                          const unsigned                    rules     ,
+                                Found                       found     ,
+                                uint64_t                   &candidates,
+                                uint64_t                   &solvable  )
+    {
+        const uint64_t  cells = static_cast<uint64_t>(box[0])
+                                * box[1] * box[2];
+
+        if (   cells > Enumerate::MAX_CELLS
+            || cells < Shape::NUMBER_OF_CUBICLES)
+            return false;
+
+        std::vector<std::vector<std::vector<Figure::Coords>>>   items ;
+        std::array<int, Shape::NUMBER_OF_CUBICLES * 3>          coords;
+
+        reset();
+        figure_items(items);
+
+        Enumerate   figures({{static_cast<int>(box[0]),
+                              static_cast<int>(box[1]),
+                              static_cast<int>(box[2])}},
+                            Shape::NUMBER_OF_CUBICLES  ,
+                            rules                      ,
+                            items                      );
+
+        figures.run([&](const Figure &figure)
+                    {
+                        for (unsigned     ndx = 0                         ;
+                                          ndx < Shape::NUMBER_OF_CUBICLES ;
+                                        ++ndx                              )
+                            for (unsigned axis = 0 ; axis < 3 ; ++axis)
+                                coords[ndx * 3 + axis]
+                                = figure.coords(ndx)[axis];
+                        return found(static_cast<const std::array<
+                                       int                           ,
+                                       Shape::NUMBER_OF_CUBICLES * 3>&>(
+                                         coords));
+                    });
+
+        candidates = figures.candidates();
+        solvable   = figures.solvable  ();
+
+        return true;
+    }
+
+    // Put pieces in solution's placements, e.g. from Zdd::unrank()
+    //   of diagram(), or of one written by it and read back by
+    //   Zdd::read() (whose Zdd::Cover is a Rank::Cover, but with
+    //   items in writer's piece_order(), see Zdd::names()), and as
+    //   per unrank() regarding print() and solve(). False, placing
+    //   none, if any piece's mask isn't one of its placements (or
+    //   pre-placed piece's cubicles), or masks overlap.
+    bool        place(const Rank::Cover &cover);
+
+    // Placements of pieces in shape, e.g. after solve(), as per
+    //   rank() (zero if not placed)
+    void        cover(Rank::Cover &cover) const;
+
+    // Write solutions (e.g. cover() after each solve()) to solution
+    //   store file, see store.hxx. False if stream fails.
+    bool        store(      std::ostream               &output   ,
+                      const std::vector<Rank::Cover>   &solutions);
+
+    // Figure has more than one separated shape.
+    bool        separated() const { return _shape.num_children() > 1; }
+
+    // Make solve() return false, leaving interrupted() true, if *stop
+    //   becomes non-zero (e.g. set by signal handler) or deadline
+    //   passes. Checked every POLL_INTERVAL placement attempts.
+    // Either or both can be disabled with stop==0 and/or
+    //   deadline==time_point::max() (defaults).
+    // Persists across reset(), read(), and shape().
+    static const unsigned   POLL_INTERVAL = 1 << 12;
+    void    interruptible(
+            const volatile std::sig_atomic_t             *stop    ,
+            const std::chrono::steady_clock::time_point   deadline)
+    {
+        _stop     = stop    ;
+        _deadline = deadline;
+    }
+    bool    interrupted() const { return _interrupted; }
+
+    // Save complete search state, after solve() has returned (either
+    //   true, or false with interrupted()).
+    // Restore with resume() after read() or shape() of same figure
+    //   with same orphans/duplicates/symmetries/piece_order/
+    //   pair_anchored/symmetry_breaking settings,
+    //   then continue with solve().
+    // Text format, see soma.cxx.
+    void    checkpoint(std::ostream &output) const;
+    bool    resume    (std::istream &input     ,
+                       std::ostream *errors = 0);
+
+    // Knuth estimate of search tree explored by repeated solve() calls
+    //   until no more solutions, from random root-to-leaf probes using
+    //   current orphans/duplicates/symmetries/piece_order/
+    //   symmetry_breaking settings.
+    // Each *_error is half-width of 95% confidence interval.
+    struct Estimate {
+        unsigned    probes         ;
+        double      nodes          ,  // successful Piece::place() calls
+                    nodes_error    ,
+                    tries          ,  // Shape::place_piece() attempts
+                    tries_error    ,
+                    solutions      ,  // as would be returned by solve()
+                    solutions_error,
+                    seconds        ,  // tries * measured per-try time
+                    seconds_error  ,
+                    elapsed        ;  // time taken by estimate() itself
+    };
+
+    // Call after read() or shape() instead of, or before, solve().
+    // Leaves state as after read() or shape(), so solve() can follow.
+    // All zero if infeasibility() is non-empty.
+    // Solution count is approximate if final duplicate check (piece 7
+    //   in duplicates()) is enabled together with checks of more than
+    //   the first piece, or with symmetries(): assumes first consecutive
+    //   duplicate checked pieces reduce each to one canonical partial
+    //   solution, and ignores symmetries() checks after the first piece.
+    Estimate    estimate(const unsigned probes, const uint64_t seed);
+
     // Output solution(s) to user
     void    print(std::ostream  &output) { _shape.write(output); }
 
@@ -96,17 +382,74 @@ class Soma {
     unsigned    duplicates () const { return _duplicate_checks; }
     unsigned    symmetries () const { return _symmetry_checks ; }
     std::string piece_order() const { return _piece_order     ; }
+    std::string pair_anchored() const { return _pair_anchored   ; }
+    bool    symmetry_breaking() const { return _symmetry_breaking; }
+    bool    forward_checking () const { return _forward_checking ; }
+    // Whether finding only unique solutions (as per -D/-b and, for
+    //   separated shapes, always), valid after read() or shape()
+    bool    unique() const
+    {
+        return    _symmetry_breaking
+               || (_dup_chks_adjstd & 1 << (Piece::NUMBER_OF_PIECES - 1));
+    }
+    const Engine&   engine   () const { return _engine           ; }
 
     // Change configuration of existing object.
     // Only change before or immediately after reset() (or initial object
-    //   construction), not between read() or shape() and solve(), or
-    //   between repeated calls to solve().
+    //   construction), or before reconfigure(), not between read() or
+    //   shape() and solve(), or between repeated calls to solve().
     void    orphans    (const unsigned setting) { _orphan_checks    = setting; }
     void    duplicates (const unsigned setting) { _duplicate_checks = setting; }
     void    symmetries (const unsigned setting) { _symmetry_checks  = setting; }
     bool    piece_order(const std::string&    );
 
-#ifdef SOMA_STATISTICS
+    // Pieces, by Piece::name(), to place by middle pair of cubes
+    //   instead of by central cube. Any of "pnz" (see
+    //   Piece::pair_anchorable()), or empty string for none. May be
+    //   faster or slower depending on figure. Pieces in symmetries()
+    //   are always pair-anchored.
+    // Returns false, and sets DEFAULT_PAIR_ANCHORED, if any other
+    //   pieces.
+    // Persists across reset(), but only change when piece_order() can.
+    bool    pair_anchored(const std::string&  );
+
+    // Place pieces only where lexicographically first among all
+    //   rotations/reflections of partial solution still possible (see
+    //   Shape::is_canonical()), so each unique solution found exactly
+    //   once without duplicates() or symmetries() checks (which are
+    //   ignored if set). Works for separated shapes and any
+    //   piece_order().
+    // Same restrictions on changing as piece_order().
+    void    symmetry_breaking(const bool setting) { _symmetry_breaking
+                                                    = setting;        }
+
+    // After placing each piece, check that every remaining piece still
+    //   has at least one placement not overlapping placed ones, and
+    //   that every empty cubicle is still covered by at least one of
+    //   them (see Shape::forward_check()). Rejections are counted as
+    //   orphans. Prunes more than orphans() but costs more per
+    //   placement, so may be faster or slower depending on figure.
+    // Same restrictions on changing as piece_order().
+    void    forward_checking(const bool setting) { _forward_checking
+                                                   = setting;       }
+
+    // Rotation and duplicate set implementations, and whether to
+    //   keep statistics (see Engine). Only affects speed, not results,
+    //   so figures can be compared across variants in one program.
+    // Same restrictions on changing as piece_order().
+    void    engine(const Engine &setting) { _engine = setting; }
+
+    // Runtime search counters, see counters.hxx
+    // Off by default. Can be changed at any time, but if turned on
+    //   between repeated calls to solve() will only count from then on.
+    // Values are per-figure: zeroed by reset() (and so by read() and
+    //   shape()) and accumulated by all subsequent calls to solve().
+    void            counters        (const bool enable);
+    bool            counters_enabled() const { return _counters_enabled; }
+    const Counters& counters        () const { return _counters        ; }
+
+    // Statistics, only updated if engine().statistics
+    // Accumulated over all figures (not zeroed by reset()).
     char piece_name(
     unsigned piece_number)
     const
@@ -142,7 +485,6 @@ class Soma {
     SOMA_PRINT_PIECE_STATS(place_orphans         )
 #undef SOMA_PRINT_SHAPE_STATS
 #undef SOMA_PRINT_PIECE_STATS
-#endif
 
 
 
@@ -151,17 +493,36 @@ class Soma {
     static const unsigned       DEFAULT_P_PIECE_NDX,
                                 DEFAULT_N_PIECE_NDX;
 
+    // First line of checkpoint()
+    static const unsigned       CHECKPOINT_VERSION = 3;
+
 
     // See implementations in file soma.cxx
     //
 
+    void        reset_search();
     bool        init_shape(std::ostream *errors = 0);
 
     bool        check_preplaced(std::ostream    *errors = 0);
+    bool        pre_placed_fits(const Piece     *piece     ) const;
+
+    void        analyze();
 
     void        post_solve();
 
+    void        placement_masks(std::vector<std::vector<uint32_t>> &items    ,
+                                std::vector<uint32_t>              &adjacents)
+                                                                    const;
+
+    bool        ranking   ();
+    void        create_rank();
+    void        cover_items(std::vector<std::vector<uint32_t>> &items);
+    void        figure_items(std::vector<std::vector<std::vector<
+                             Figure::Coords>>>  &items) const;
+
     std::array<Piece*, Piece::NUMBER_OF_PIECES>     _pieces;
+    std::array<Piece::Placer, Piece::NUMBER_OF_PIECES>
+                                                    _placers; // init_shape()
     Shape       _shape           ;
     unsigned    _orphan_checks   ,  // see EXTENDED_HELP_TEXT
                 _duplicate_checks,  //   in file main.cxx
@@ -169,9 +530,33 @@ class Soma {
                 _dup_chks_adjstd ,  // forced to just 7 if shape has children
                 _sym_chks_adjstd ;  //   "    "   "   0 "    "    "     "
     std::string _piece_order     ;  // see EXTENDED_HELP_TEXT in main.cxx
+    std::string _pair_anchored   ;  // see pair_anchored()
+    bool        _symmetry_breaking; // see symmetry_breaking()
+    bool        _forward_checking;  // see forward_checking()
+    Engine      _engine          ;  // see engine()
     unsigned    _active_piece    ,  // state of recursive tree solve
                 _p_piece_ndx     ,  // for special case duplicate checks of
                 _n_piece_ndx     ;  //   these two mutually-mirrored pieces
+    Counters    _counters        ;  // see counters()
+    bool        _counters_enabled;  //  "      "
+    const volatile std::sig_atomic_t
+               *_stop            ;  // see interruptible()
+    std::chrono::steady_clock::time_point
+                _deadline        ;  //  "       "
+    unsigned    _poll_countdown  ;  //  "       "
+    bool        _interrupted     ;  // solve() returned mid-search
+    std::string _infeasibility   ;  // see infeasibility()
+    std::vector<Piece::Placement>
+                _placements      ;  // analyze() scratch, kept to reuse
+    std::unique_ptr<Rank>
+                _rank            ;  // see ranked(), null until then
+    std::array<std::vector<Piece::Placement>, Piece::NUMBER_OF_PIECES>
+                _rank_placements ;  // of _rank's items, for place()
+    std::vector<std::pair<unsigned, uint32_t>>
+                _hint_placed     ;  // hint_place() piece, mask stack
+    uint32_t    _hint_cells      ;  // empty, as per hint_start()
+    unsigned    _hint_unused     ;  // pieces,  "   "      "
+    bool        _hint_started    ;
 };
 
 }  // namespace soma
@@ -0,0 +1,465 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "store.hxx"
+
+
+
+namespace {
+
+// File format identification, including version number
+const char  MAGIC[] = "yasssdb1";
+
+
+// Round file offset up for alignment of following uint64_t data
+uint64_t aligned(
+uint64_t    offset)
+{
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+
+}  // aligned(uint64_t)
+
+
+
+void pad(
+std::ostream    &output,
+uint64_t         offset)
+{
+    for ( ; offset & 7 ; ++offset)
+        output.put('\0');
+
+}  // pad(std::ostream&, uint64_t)
+
+}  // namespace
+
+
+
+namespace soma {
+
+// See store.hxx
+bool Store::write(
+      std::ostream                          &output   ,
+const std::string                           &names    ,
+const std::vector<Coords>                   &coords   ,
+const std::vector<std::vector<uint32_t>>    &items    ,
+const std::vector<Cover>                    &solutions)
+{
+    if (   items.size() > MAX_PIECES   || names.size() != items.size()
+        || coords.size() > MAX_CUBICLES                                )
+        return false;
+
+    Header  header;
+
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+
+    header.pieces    = items    .size();
+    header.cubicles  = coords   .size();
+    header.solutions = solutions.size();
+    header.words     = (solutions.size() + 63) / 64;
+
+    std::memcpy(header.names, names.data(), names.size());
+
+    for (unsigned cubicle = 0 ; cubicle < coords.size() ; ++cubicle)
+        for (unsigned axis = 0 ; axis < 3 ; ++axis)
+            header.coords[cubicle * 3 + axis] = coords[cubicle][axis];
+
+    uint64_t    offset = sizeof(header);
+
+    header.masks = offset;
+    for (unsigned piece = 0 ; piece < items.size() ; ++piece) {
+        if (items[piece].size() > UINT16_MAX)
+            return false;
+
+        header.placements[piece]  = items[piece].size();
+        offset                   += items[piece].size() * sizeof(uint32_t);
+    }
+
+    header.numbers  = aligned(offset);
+    header.bitmaps  =   header.numbers
+                      + solutions.size() * MAX_PIECES * sizeof(uint16_t);
+
+    // Placement numbers, and bitmaps, of each solution
+    std::vector<std::unordered_map<uint32_t, uint16_t>>
+                            numbers(items.size());
+    std::vector<uint16_t>   placements(solutions.size() * MAX_PIECES);
+    std::vector<uint64_t>   bitmaps(  header.pieces
+                                    * header.cubicles
+                                    * header.words   );
+
+    for (unsigned piece = 0 ; piece < items.size() ; ++piece)
+        for (unsigned     placement = 0                     ;
+                          placement < items[piece].size()   ;
+                        ++placement                          )
+            numbers[piece][items[piece][placement]] = placement;
+
+    for (uint64_t solution = 0 ; solution < solutions.size() ; ++solution)
+        for (unsigned piece = 0 ; piece < items.size() ; ++piece) {
+            const uint32_t  mask = solutions[solution][piece];
+            const std::unordered_map<uint32_t, uint16_t>::const_iterator
+                            found = numbers[piece].find(mask);
+
+            if (found == numbers[piece].end())
+                return false;
+
+            placements[solution * MAX_PIECES + piece] = found->second;
+
+            for (uint32_t bits = mask ; bits ; bits &= bits - 1)
+                bitmaps[  (piece * header.cubicles + __builtin_ctz(bits))
+                        * header.words
+                        + solution / 64                                  ]
+                |= static_cast<uint64_t>(1) << solution % 64;
+        }
+
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (const std::vector<uint32_t> &item : items)
+        output.write(reinterpret_cast<const char*>(item.data()),
+                     item.size() * sizeof(uint32_t)             );
+    pad(output, offset);
+
+    output.write(reinterpret_cast<const char*>(placements.data()),
+                 placements.size() * sizeof(uint16_t)             );
+    pad(output, header.bitmaps);
+
+    output.write(reinterpret_cast<const char*>(bitmaps.data()),
+                 bitmaps.size() * sizeof(uint64_t)             );
+
+    return static_cast<bool>(output);
+
+}  // write(std::ostream&, const std::string&, ...)
+
+
+
+// See store.hxx
+Store::Store()
+:   _file  (0),
+    _size  (0),
+    _header(0)
+{
+}
+
+
+
+// See store.hxx
+Store::~Store()
+{
+    close();
+}
+
+
+
+// See store.hxx
+bool Store::open(
+const std::string   &filename,
+      std::ostream  &errors  )
+{
+    close();
+
+    const int   descriptor = ::open(filename.c_str(), O_RDONLY);
+    struct stat status;
+
+    if (descriptor < 0 || fstat(descriptor, &status) != 0) {
+        if (descriptor >= 0)
+            ::close(descriptor);
+        errors << "Can't open file " << filename << std::endl;
+        return false;
+    }
+
+    _size = status.st_size;
+
+    if (_size >= sizeof(Header)) {
+        void    *mapped = mmap(0, _size, PROT_READ, MAP_PRIVATE, descriptor,
+                                   0                                       );
+
+        if (mapped != MAP_FAILED)
+            _file = static_cast<const uint8_t*>(mapped);
+    }
+
+    ::close(descriptor);  // mapping remains valid
+
+    _header = reinterpret_cast<const Header*>(_file);
+
+    uint64_t    masks = 0;
+    if (_file && _header->pieces <= MAX_PIECES)
+        for (unsigned piece = 0 ; piece < _header->pieces ; ++piece)
+            masks += _header->placements[piece];
+
+    if (   !_file
+        || std::memcmp(_header->magic, MAGIC, sizeof(_header->magic)) != 0
+        || _header->pieces   > MAX_PIECES
+        || _header->cubicles > MAX_CUBICLES
+        // Bounded by file size before multiplying, so products of
+        //   corrupt counts can't wrap around to match it
+        || _header->solutions > _size / (MAX_PIECES * sizeof(uint16_t))
+        || _header->words   != (_header->solutions + 63) / 64
+        || _header->masks   != sizeof(Header)
+        || _header->numbers != aligned(  _header->masks
+                                       + masks * sizeof(uint32_t))
+        || _header->bitmaps !=   _header->numbers
+                               +   _header->solutions
+                                 * MAX_PIECES
+                                 * sizeof(uint16_t)
+        || _size !=   _header->bitmaps
+                    +   _header->pieces
+                      * _header->cubicles
+                      * _header->words
+                      * sizeof(uint64_t)                            ) {
+        close();
+        errors << "File "
+               << filename
+               << " isn't a solution store"
+               << std::endl;
+        return false;
+    }
+
+    return true;
+
+}  // open(const std::string&, std::ostream&)
+
+
+
+// See store.hxx
+void Store::close()
+{
+    if (_file)
+        munmap(const_cast<uint8_t*>(_file), _size);
+
+    _file   = 0;
+    _size   = 0;
+    _header = 0;
+
+}  // close()
+
+
+
+// See store.hxx
+uint64_t Store::solutions()
+const
+{
+    return _header ? _header->solutions : 0;
+}
+
+
+
+// See store.hxx
+unsigned Store::cubicles()
+const
+{
+    return _header ? _header->cubicles : 0;
+}
+
+
+
+// See store.hxx
+std::string Store::names()
+const
+{
+    return _header ? std::string(_header->names, _header->pieces) : "";
+}
+
+
+
+// See store.hxx
+Store::Coords Store::coords(
+const unsigned  cubicle)
+const
+{
+    return Coords{{_header->coords[cubicle * 3    ],
+                   _header->coords[cubicle * 3 + 1],
+                   _header->coords[cubicle * 3 + 2]}};
+}
+
+
+
+// See store.hxx
+Store::Cover Store::solution(
+const uint64_t  ndx)
+const
+{
+    const uint32_t  *masks   = reinterpret_cast<const uint32_t*>(
+                                 _file + _header->masks  );
+    const uint16_t  *numbers = reinterpret_cast<const uint16_t*>(
+                                 _file + _header->numbers) + ndx * MAX_PIECES;
+    Cover            cover   ;
+
+    cover.fill(0);
+    for (unsigned piece = 0 ; piece < _header->pieces ; ++piece) {
+        // Number from file, so checked against piece's placements
+        if (numbers[piece] < _header->placements[piece])
+            cover[piece] = masks[numbers[piece]];
+        masks += _header->placements[piece];
+    }
+
+    return cover;
+
+}  // solution(const uint64_t) const
+
+
+
+// See store.hxx
+bool Store::query(
+const std::string           &expression,
+      std::vector<uint64_t> &matches   ,
+      uint64_t              &count     ,
+      std::ostream          &errors    )
+const
+{
+    std::string     text;
+
+    for (const char character : expression)
+        if (!std::isspace(static_cast<unsigned char>(character)))
+            text += character;
+
+    std::vector<uint64_t>   clause,
+                            bits  ;
+
+    matches.assign(_header->words, 0);
+
+    // "|"-separated clauses of "&"-separated terms
+    for (std::string::size_type begin = 0 ; begin <= text.size() ; ) {
+        std::string::size_type  end = text.find('|', begin);
+        if (end == std::string::npos)
+            end = text.size();
+
+        clause.assign(_header->words, UINT64_MAX);
+
+        for (std::string::size_type start = begin ; start <= end ; ) {
+            std::string::size_type  stop = text.find('&', start);
+            if (stop == std::string::npos || stop > end)
+                stop = end;
+
+            if (!term(text.substr(start, stop - start), bits, errors))
+                return false;
+
+            for (uint64_t word = 0 ; word < _header->words ; ++word)
+                clause[word] &= bits[word];
+
+            start = stop + 1;
+        }
+
+        for (uint64_t word = 0 ; word < _header->words ; ++word)
+            matches[word] |= clause[word];
+
+        begin = end + 1;
+    }
+
+    // Unused bits of last word, possibly set by "!" terms
+    if (_header->solutions % 64)
+        matches.back() &= (static_cast<uint64_t>(1) << _header->solutions % 64)
+                          - 1;
+
+    count = 0;
+    for (const uint64_t word : matches)
+        count += __builtin_popcountll(word);
+
+    return true;
+
+}  // query(const std::string&, std::vector<uint64_t>&, ...) const
+
+
+
+// Bitmap of piece/cubicle
+const uint64_t *Store::bitmap(
+const unsigned  piece  ,
+const unsigned  cubicle)
+const
+{
+    return   reinterpret_cast<const uint64_t*>(_file + _header->bitmaps)
+           + (piece * _header->cubicles + cubicle) * _header->words;
+
+}  // bitmap(const unsigned, const unsigned) const
+
+
+
+// Bitmap of query term (see store.hxx), false with message to errors
+//   if invalid
+//
+bool Store::term(
+const std::string           &text  ,
+      std::vector<uint64_t> &bits  ,
+      std::ostream          &errors)
+const
+{
+    const bool              negate = !text.empty() && text[0] == '!';
+    const std::string::size_type
+                            name   = negate ? 1 : 0;
+    const std::string       names  = this->names();
+    const std::string::size_type
+                            piece  =   text.size() > name
+                                     ? names.find(text[name])
+                                     : std::string::npos;
+    int                     coords[3];
+    const char             *scan   = text.c_str() + name + 1;
+    char                   *end    = 0;
+    bool                    valid  =    piece != std::string::npos
+                                     && text.size() > name + 1
+                                     && text[name + 1] == '@';
+
+    for (unsigned axis = 0 ; axis < 3 && valid ; ++axis) {
+        coords[axis] = strtol(++scan, &end, 10);
+        valid        = end != scan && *end == (axis == 2 ? '\0' : ',');
+        scan         = end;
+    }
+
+    if (!valid) {
+        errors << "Invalid query term \""
+               << text
+               << "\": must be [!]<piece>@<x>,<y>,<z>"
+               << std::endl;
+        return false;
+    }
+
+    unsigned    cubicle = 0;
+
+    while (   cubicle < _header->cubicles
+           && (   _header->coords[cubicle * 3    ] != coords[0]
+               || _header->coords[cubicle * 3 + 1] != coords[1]
+               || _header->coords[cubicle * 3 + 2] != coords[2]))
+        ++cubicle;
+
+    if (cubicle == _header->cubicles) {
+        errors << "Query term \""
+               << text
+               << "\": no cubicle at those coordinates"
+               << std::endl;
+        return false;
+    }
+
+    const uint64_t  *source = bitmap(piece, cubicle);
+
+    bits.resize(_header->words);
+    for (uint64_t word = 0 ; word < _header->words ; ++word)
+        bits[word] = negate ? ~source[word] : source[word];
+
+    return true;
+
+}  // term(const std::string&, std::vector<uint64_t>&, std::ostream&) const
+
+}  // namespace soma
@@ -0,0 +1,131 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef STORE_HXX
+#define STORE_HXX
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+
+namespace soma {
+
+// File of solutions of one figure, each recorded once as per-piece
+//   placement numbers, plus per (piece, cubicle) bitmap of solutions
+//   in which piece covers cubicle. Queries combine bitmaps word by
+//   word from memory-mapped file without decoding solutions, so cost
+//   is proportional to number of solutions / 64 per term.
+// Query expression: terms joined by "&" (and) and "|" (or, lower
+//   precedence, as "a&b|c" is "(a&b)|c"), each term a piece name,
+//   "@", and cubicle coordinates "x,y,z" (as per Soma::solution()),
+//   true if piece covers cubicle, optionally preceded by "!" (not).
+//   E.g. "t@-1,-1,-1&t@1,-1,-1|t@-1,-1,-1&t@-1,1,-1" for "t" piece
+//   covering two of those corners. Spaces ignored.
+// File is native byte order, so only portable between same-endian
+//   machines.
+//
+class Store {
+  public:
+    static const unsigned   MAX_PIECES   = 8 ,
+                            MAX_CUBICLES = 32;
+
+    // Per piece, cells covered by its placement
+    typedef std::array<uint32_t, MAX_PIECES>    Cover;
+
+    // Cubicle coordinates
+    typedef std::array<int, 3>                  Coords;
+
+    // names:      per piece, one character
+    // coords:     per cubicle (cell of solution's bitmasks)
+    // items:      per piece, all its placements, each numbered by
+    //             its index
+    // solutions:  each a placement in items per piece
+    // False if stream fails or a placement isn't in items
+    static bool write(      std::ostream                       &output   ,
+                      const std::string                        &names    ,
+                      const std::vector<Coords>                &coords   ,
+                      const std::vector<std::vector<uint32_t>> &items    ,
+                      const std::vector<Cover>                 &solutions);
+
+    Store();
+    ~Store();
+
+    Store(const Store&) = delete;
+    Store &operator=(const Store&) = delete;
+
+    // Map file into memory, false with message to errors if can't or
+    //   not a store
+    bool        open (const std::string    &filename,
+                            std::ostream   &errors  );
+    void        close();
+
+    uint64_t    solutions() const;
+    unsigned    cubicles () const;
+    std::string names    () const;
+    Coords      coords   (const unsigned    cubicle ) const;
+
+    // Placements of solution number ndx (from 0)
+    Cover       solution (const uint64_t    ndx     ) const;
+
+    // Bitmap, one bit per solution, of solutions matching expression,
+    //   and their number. False, with message to errors, if
+    //   expression invalid.
+    bool        query    (const std::string        &expression,
+                                std::vector<uint64_t>&matches ,
+                                uint64_t           &count     ,
+                                std::ostream       &errors    ) const;
+
+
+
+  protected:
+    struct Header {
+        char        magic[8];
+        uint32_t    pieces   ,
+                    cubicles ;
+        uint64_t    solutions,
+                    words    ;      // per bitmap
+        char        names   [MAX_PIECES  ]    ;
+        int32_t     coords  [MAX_CUBICLES * 3];
+        uint32_t    placements[MAX_PIECES]    ;  // number, per piece
+        uint64_t    masks    ,      // file offsets of uint32_t masks,
+                    numbers  ,      //   uint16_t[MAX_PIECES] per solution,
+                    bitmaps  ;      //   and uint64_t per piece, cubicle,
+    };                              //   and word
+
+    const uint64_t *bitmap  (const unsigned  piece  ,
+                             const unsigned  cubicle) const;
+
+    bool            term    (const std::string          &text   ,
+                                   std::vector<uint64_t>&bits   ,
+                                   std::ostream         &errors ) const;
+
+    const uint8_t  *_file  ;
+    size_t          _size  ;
+    const Header   *_header;
+
+};  // class Store
+
+}  // namespace soma
+
+#endif  // #ifndef STORE_HXX
@@ -0,0 +1,114 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#include <atomic>
+#include <mutex>
+
+#include "json.hxx"
+#include "trace.hxx"
+
+
+
+namespace soma {
+
+std::ostream                            *Trace::_output = 0   ;
+std::chrono::steady_clock::time_point    Trace::_origin       ;
+bool                                     Trace::_first  = true;
+
+
+namespace {
+
+std::mutex          write_mutex;
+std::atomic<int>    next_thread_id(1);
+
+// Perfetto track per thread, numbered in order of first event
+int thread_id()
+{
+    thread_local int    id = next_thread_id++;
+    return id;
+}
+
+}  // namespace
+
+
+
+// See trace.hxx
+void Trace::open(
+std::ostream    *output)
+{
+    _output = output;
+    _origin = std::chrono::steady_clock::now();
+    _first  = true;
+
+    if (_output)
+        *_output << '[';
+}
+
+
+
+// See trace.hxx
+void Trace::close()
+{
+    if (!_output)
+        return;
+
+    *_output << "\n]" << std::endl;
+    _output = 0;
+}
+
+
+
+// See trace.hxx
+void Trace::write(
+const char                                  *name  ,
+const std::string                           &detail,
+const std::chrono::steady_clock::time_point  begin )
+{
+    using std::chrono::duration;
+    using std::chrono::steady_clock;
+
+    const steady_clock::time_point  end = steady_clock::now();
+    const int                       tid = thread_id();
+
+    std::lock_guard<std::mutex>     lock(write_mutex);
+
+    if (!_output)
+        return;
+
+    *_output << (_first ? "\n" : ",\n")
+             << "{\"name\":\"" << name
+             << "\",\"cat\":\"soma\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+             << ",\"ts\":"
+             << duration<double, std::micro>(begin - _origin).count()
+             << ",\"dur\":"
+             << duration<double, std::micro>(end   - begin  ).count();
+
+    if (!detail.empty()) {
+        *_output << ",\"args\":{\"detail\":\"";
+        write_json_escaped(*_output, detail);
+        *_output << "\"}";
+    }
+
+    *_output << '}';
+    _first = false;
+
+}  // write(const char*, const std::string&, steady_clock::time_point)
+
+}  // namespace soma
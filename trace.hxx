@@ -0,0 +1,96 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef TRACE_HXX
+#define TRACE_HXX
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+
+
+namespace soma {
+
+// Phase timeline in Chrome trace-event JSON format (view with
+//   https://ui.perfetto.dev or chrome://tracing).
+// Single process-wide output, off (and costing only a pointer test
+//   per span) unless open()'ed. Each thread gets its own track.
+// Spans are per-figure phases, not per-placement, so overhead when
+//   enabled is negligible.
+//
+class Trace {
+  public:
+    // Start writing events to output, which must remain valid until
+    //   close(). Not thread-safe with respect to concurrent spans.
+    static void open (std::ostream *output);
+
+    // Terminate JSON array. Does not close or delete output.
+    static void close();
+
+    static bool enabled() { return _output != 0; }
+
+    // Complete ("X") event from construction to destruction.
+    // name must be a string literal or otherwise outlive the span.
+    // detail, if non-empty, is added as "args":{"detail":...}.
+    class Span {
+      public:
+        explicit Span(const char          *name      ,
+                      const std::string   &detail = "")
+        :   _name(name)
+        {
+            if (Trace::enabled()) {
+                _detail = detail;
+                _begin  = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~Span() { end(); }
+
+        // Write event before destruction (once only)
+        void end()
+        {
+            if (_name && Trace::enabled())
+                Trace::write(_name, _detail, _begin);
+            _name = 0;
+        }
+
+      protected:
+        const char                                  *_name  ;
+        std::string                                  _detail;
+        std::chrono::steady_clock::time_point        _begin ;
+    };
+
+
+
+  protected:
+    static void write(const char                                *name  ,
+                      const std::string                         &detail,
+                      const std::chrono::steady_clock::time_point begin);
+
+    static std::ostream                             *_output ;
+    static std::chrono::steady_clock::time_point     _origin ;
+    static bool                                      _first  ;
+
+};  // class Trace
+
+}  // namespace soma
+
+#endif  // #ifndef TRACE_HXX
@@ -0,0 +1,454 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#include <cstring>
+#include <utility>
+
+#include "zdd.hxx"
+
+
+
+namespace {
+
+// write() file format identification, including version number
+const char      MAGIC[]     = "yasszdd1";
+const unsigned  MAGIC_SIZE  = sizeof(MAGIC) - 1;
+
+
+// Variable-length unsigned integer: 7 bits per byte, low bits first,
+//   high bit set in all but last byte
+//
+void put(
+std::ostream    &output,
+uint64_t         number)
+{
+    while (number >= 0x80) {
+        output.put(static_cast<char>((number & 0x7f) | 0x80));
+        number >>= 7;
+    }
+    output.put(static_cast<char>(number));
+
+}  // put(std::ostream&, uint64_t)
+
+
+
+bool get(
+std::istream    &input ,
+uint64_t        &number)
+{
+    number = 0;
+
+    for (unsigned shift = 0 ; shift < 64 ; shift += 7) {
+        const int   byte = input.get();
+
+        if (byte == EOF)
+            return false;
+
+        number |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+
+}  // get(std::istream&, uint64_t&)
+
+}  // namespace
+
+
+
+namespace soma {
+
+// See zdd.hxx
+Zdd::Zdd()
+:   _cells(0    ),
+    _root (EMPTY)
+{
+    _nodes .push_back({0, EMPTY, EMPTY});
+    _nodes .push_back({0, UNIT , UNIT });
+    _counts.push_back(0);
+    _counts.push_back(1);
+
+}  // Zdd()
+
+
+
+// See zdd.hxx
+Zdd::Zdd(
+const uint32_t                               cells,
+const std::vector<std::vector<uint32_t>>    &items,
+const std::string                           &names)
+:   Zdd()
+{
+    _cells = cells;
+    _names = names;
+
+    std::array<std::vector<std::pair<unsigned, unsigned>>, 32>  lowest;
+
+    for (unsigned item = 0 ; item < items.size() ; ++item)
+        for (unsigned     placement = 0                   ;
+                          placement < items[item].size()  ;
+                        ++placement                        )
+            lowest[__builtin_ctz(items[item][placement])]
+            .emplace_back(item, placement);
+
+    // Variables in order of lowest cell, then item, then placement
+    for (unsigned cell = 0 ; cell < lowest.size() ; ++cell)
+        for (const std::pair<unsigned, unsigned> &candidate : lowest[cell]) {
+            _lowest[cell].push_back(_variables.size());
+            _variables.push_back({static_cast<uint8_t>(candidate.first),
+                                  items[candidate.first][candidate.second]});
+        }
+
+    _root = build(cells, (1 << items.size()) - 1);
+
+    // Free construction-only tables
+    for (std::vector<uint32_t> &variables : _lowest)
+        std::vector<uint32_t>().swap(variables);
+    std::unordered_map<uint64_t, uint32_t>().swap(_states);
+    _uniques.clear();
+
+}  // Zdd(const uint32_t, const std::vector<...>&, const std::string&)
+
+
+
+// See zdd.hxx
+bool Zdd::write(
+std::ostream    &output)
+const
+{
+    output.write(MAGIC, MAGIC_SIZE);
+
+    put(output, _cells);
+
+    put(output, _names.size());
+    output.write(_names.data(), _names.size());
+
+    put(output, _variables.size());
+    for (const Variable &variable : _variables) {
+        put(output, variable.item);
+        put(output, variable.mask);
+    }
+
+    // Children always precede parents, so relative to them is small
+    put(output, _nodes.size() - 2);
+    for (uint32_t node = 2 ; node < _nodes.size() ; ++node) {
+        put(output, _nodes[node].var     );
+        put(output, node - _nodes[node].lo);
+        put(output, node - _nodes[node].hi);
+    }
+
+    put(output, _root);
+
+    return static_cast<bool>(output);
+
+}  // write(std::ostream&) const
+
+
+
+// See zdd.hxx
+bool Zdd::read(
+std::istream    &input)
+{
+    *this = Zdd();
+
+    Zdd         loaded           ;
+    char        magic[MAGIC_SIZE];
+    uint64_t    number           ;
+
+    if (   !input.read(magic, MAGIC_SIZE)
+        || std::memcmp(magic, MAGIC, MAGIC_SIZE) != 0
+        || !get(input, number) || number > UINT32_MAX)
+        return false;
+    loaded._cells = number;
+
+    if (!get(input, number) || number > MAX_ITEMS)
+        return false;
+    loaded._names.resize(number);
+    if (number && !input.read(&loaded._names[0], number))
+        return false;
+
+    // Counts aren't trusted for allocation: vectors grow only as
+    //   entries are actually read, so a truncated or corrupt file
+    //   fails at end of stream instead of exhausting memory
+    uint64_t    variables;
+    if (!get(input, variables) || variables > UINT32_MAX)
+        return false;
+    for (uint64_t variable = 0 ; variable < variables ; ++variable) {
+        uint64_t    item, mask;
+
+        if (   !get(input, item) || item >= loaded._names.size()
+            || !get(input, mask) || mask >  UINT32_MAX           )
+            return false;
+
+        loaded._variables.push_back({static_cast<uint8_t >(item),
+                                     static_cast<uint32_t>(mask)});
+    }
+
+    uint64_t    nodes;
+    if (!get(input, nodes) || nodes > UINT32_MAX - 2)
+        return false;
+    for (uint32_t node = 2 ; node < nodes + 2 ; ++node) {
+        uint64_t    var, lo, hi;
+
+        if (   !get(input, var) || var >= loaded._variables.size()
+            || !get(input, lo ) || lo  == 0 || lo > node
+            || !get(input, hi ) || hi  == 0 || hi > node)
+            return false;
+
+        loaded._nodes .push_back({static_cast<uint32_t>(var      ),
+                                  static_cast<uint32_t>(node - lo),
+                                  static_cast<uint32_t>(node - hi)});
+        loaded._counts.push_back(  loaded._counts[node - lo]
+                                 + loaded._counts[node - hi]);
+    }
+
+    if (!get(input, number) || number >= loaded._nodes.size())
+        return false;
+    loaded._root = number;
+
+    *this = std::move(loaded);
+
+    return true;
+
+}  // read(std::istream&)
+
+
+
+// See zdd.hxx
+uint64_t Zdd::count()
+const
+{
+    return _counts[_root];
+
+}  // count() const
+
+
+
+// See zdd.hxx
+uint64_t Zdd::count(
+const std::vector<bool>     &excluded)
+const
+{
+    std::vector<uint64_t>   counts;
+
+    allowed(excluded, counts);
+
+    return counts[_root];
+
+}  // count(const std::vector<bool>&) const
+
+
+
+// See zdd.hxx
+bool Zdd::unrank(
+uint64_t     index,
+Cover       &cover)
+const
+{
+    if (index >= count())
+        return false;
+
+    descend(index, _counts, 0, cover);
+
+    return true;
+
+}  // unrank(uint64_t, Cover&) const
+
+
+
+// See zdd.hxx
+bool Zdd::sample(
+      std::mt19937_64   &random  ,
+      Cover             &cover   ,
+const std::vector<bool> *excluded)
+const
+{
+    std::vector<uint64_t>   restricted;
+
+    if (excluded)
+        allowed(*excluded, restricted);
+
+    const std::vector<uint64_t> &counts = excluded ? restricted : _counts;
+
+    if (!counts[_root])
+        return false;
+
+    std::uniform_int_distribution<uint64_t>     any(0, counts[_root] - 1);
+
+    descend(any(random), counts, excluded, cover);
+
+    return true;
+
+}  // sample(std::mt19937_64&, Cover&, const std::vector<bool>*) const
+
+
+
+// See zdd.hxx
+void Zdd::marginals(
+std::vector<uint64_t>   &uses)
+const
+{
+    std::vector<uint64_t>   paths(_nodes.size(), 0);
+
+    uses.assign(_variables.size(), 0);
+    paths[_root] = 1;
+
+    // Parents before children
+    for (uint32_t node = _nodes.size() ; node-- > 2 ; ) {
+        const Node  &current = _nodes[node];
+
+        if (!paths[node])
+            continue;
+
+        paths[current.lo]  += paths[node];
+        paths[current.hi]  += paths[node];
+        uses [current.var] += paths[node] * _counts[current.hi];
+    }
+
+}  // marginals(std::vector<uint64_t>&) const
+
+
+
+// Memoized root of sub-diagram of covers of cells by unused items,
+//   as chain of nodes, one per candidate for lowest cell (in
+//   variable order, so first at top) whose hi child is its covers
+//   and lo child the next candidate's node
+//
+uint32_t Zdd::build(
+const uint32_t  cells ,
+const unsigned  unused)
+{
+    if (!cells)
+        return UNIT;
+
+    const uint64_t  key = static_cast<uint64_t>(cells) << MAX_ITEMS | unused;
+    const std::unordered_map<uint64_t, uint32_t>::iterator
+                    found = _states.find(key);
+
+    if (found != _states.end())
+        return found->second;
+
+    const std::vector<uint32_t> &candidates = _lowest[__builtin_ctz(cells)];
+    uint32_t                     chain      = EMPTY;
+
+    for (unsigned ndx = candidates.size() ; ndx-- ; ) {
+        const uint32_t   var      = candidates[ndx];
+        const Variable  &variable = _variables[var];
+
+        if ((unused & (1 << variable.item)) && !(variable.mask & ~cells))
+            chain = node(var                                  ,
+                         chain                                ,
+                         build(cells  & ~variable.mask        ,
+                               unused & ~(1 << variable.item)));
+    }
+
+    _states[key] = chain;
+
+    return chain;
+
+}  // build(const uint32_t, const unsigned)
+
+
+
+// Existing or new node, or lo if hi is EMPTY (zero-suppression)
+uint32_t Zdd::node(
+const uint32_t  var,
+const uint32_t  lo ,
+const uint32_t  hi )
+{
+    if (hi == EMPTY)
+        return lo;
+
+    const std::array<uint32_t, 3>   key{{var, lo, hi}};
+    const std::map<std::array<uint32_t, 3>, uint32_t>::iterator
+                                    found = _uniques.find(key);
+
+    if (found != _uniques.end())
+        return found->second;
+
+    const uint32_t  added = _nodes.size();
+
+    _nodes  .push_back({var, lo, hi});
+    _counts .push_back(_counts[lo] + _counts[hi]);
+    _uniques.emplace(key, added);
+
+    return added;
+
+}  // node(const uint32_t, const uint32_t, const uint32_t)
+
+
+
+// Per node, number of covers not using excluded variables
+void Zdd::allowed(
+const std::vector<bool>     &excluded,
+      std::vector<uint64_t> &counts  )
+const
+{
+    counts.resize(_nodes.size());
+    counts[EMPTY] = 0;
+    counts[UNIT ] = 1;
+
+    for (uint32_t node = 2 ; node < _nodes.size() ; ++node) {
+        const Node  &current = _nodes[node];
+
+        counts[node] =   counts[current.lo]
+                       + (excluded[current.var] ? 0 : counts[current.hi]);
+    }
+
+}  // allowed(const std::vector<bool>&, std::vector<uint64_t>&) const
+
+
+
+// Cover at index (which must be < counts[_root]) among those counted
+//   by counts, hi before lo
+//
+void Zdd::descend(
+      uint64_t               index   ,
+const std::vector<uint64_t> &counts  ,
+const std::vector<bool>     *excluded,
+      Cover                 &cover   )
+const
+{
+    uint32_t    node = _root;
+
+    cover.fill(0);
+    while (node != UNIT) {
+        const Node      &current = _nodes[node];
+        const uint64_t   number  =   excluded && (*excluded)[current.var]
+                                   ? 0
+                                   : counts[current.hi];
+
+        if (index < number) {
+            const Variable  &variable = _variables[current.var];
+
+            cover[variable.item] = variable.mask;
+            node                 = current.hi   ;
+        }
+        else {
+            index -= number    ;
+            node   = current.lo;
+        }
+    }
+
+}  // descend(uint64_t, const std::vector<uint64_t>&, ...) const
+
+}  // namespace soma
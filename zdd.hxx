@@ -0,0 +1,200 @@
+// yass: Yet Another Soma Solver
+// Copyright (C) 2021 Mark R. Rubin aka "thanks4opensource"
+//
+// This file is part of yass.
+//
+// The yass program is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// The yass program is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// (LICENSE.txt) along with the yass program.  If not, see
+// <https://www.gnu.org/licenses/gpl.html>
+
+
+#ifndef ZDD_HXX
+#define ZDD_HXX
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+
+namespace soma {
+
+// Zero-suppressed decision diagram of all exact covers of up to 32
+//   cells by one placement (bitmask of cells) from each of up to 8
+//   items (pieces). One variable per (item, placement), ordered by
+//   placement's lowest cell, then item, then placement, so that
+//   filling lowest uncovered cell first (as per Rank) chooses
+//   variables in increasing order. Each node is a variable with
+//   "lo" (not chosen) and "hi" (chosen) children; paths to UNIT node
+//   through hi edges are the covers. Partial covers leaving same
+//   cells uncovered and items unused share one sub-diagram, and
+//   identical nodes are merged.
+// Counting, enumeration, and sampling, optionally restricted to
+//   covers without excluded variables (e.g. all placements of an
+//   item not covering some cell), work directly on the nodes, so
+//   cost is proportional to diagram, not number of covers.
+// Independent of Shape/Piece search. Built by Soma::diagram().
+//
+class Zdd {
+  public:
+    static const unsigned   MAX_ITEMS = 8;
+
+    // Terminal nodes
+    static const uint32_t   EMPTY = 0,  // no covers
+                            UNIT  = 1;  // one empty cover
+
+    // Per item, cells covered by its placement
+    typedef std::array<uint32_t, MAX_ITEMS>     Cover;
+
+    struct Variable {
+        uint8_t     item;
+        uint32_t    mask;
+    };
+
+    struct Node {
+        uint32_t    var,
+                    lo ,    // index of node, less than own
+                    hi ;    //   "   "   "     "    "    "
+    };
+
+    // Empty diagram
+    Zdd();
+
+    // cells:  bitmask of cells to be covered
+    // items:  per item, all its candidate placements
+    // names:  per item, one character (e.g. Piece::name()), for
+    //         readers of write() output
+    Zdd(const uint32_t                              cells,
+        const std::vector<std::vector<uint32_t>>   &items,
+        const std::string                          &names);
+
+    // Compact binary format (variable-length integers, child nodes
+    //   relative to parent). False if stream fails, or, for read(),
+    //   isn't a diagram (leaving this one empty).
+    bool        write(std::ostream  &output) const;
+    bool        read (std::istream  &input );
+
+    // Number of covers, or of those not using any variable whose
+    //   excluded[var] is true
+    uint64_t    count()                                    const;
+    uint64_t    count(const std::vector<bool>   &excluded) const;
+
+    // Cover number index (from 0), in same order as Rank without
+    //   Rank::unique(). False if index >= count().
+    bool        unrank(      uint64_t        index,
+                             Cover          &cover) const;
+
+    // Uniformly random cover, optionally of those allowed by excluded
+    //   as per count(). False if none.
+    bool        sample(      std::mt19937_64    &random          ,
+                             Cover              &cover           ,
+                       const std::vector<bool>  *excluded = 0    ) const;
+
+    // Call visit(cover) for each cover in unrank() order, optionally
+    //   only those allowed by excluded as per count(), until visit()
+    //   returns false. Number of covers visited.
+    template<typename Visit>
+    uint64_t    enumerate(      Visit                visit          ,
+                          const std::vector<bool>   *excluded = 0   ) const
+    {
+        Cover       cover   ;
+        uint64_t    visited = 0;
+
+        cover.fill(0);
+        walk(_root, excluded, cover, visit, visited);
+
+        return visited;
+    }
+
+    // Per variable, number of covers using it, all at once by one
+    //   pass over nodes: number of paths from root to each node times
+    //   number of covers of its hi child, summed over variable's nodes
+    void        marginals(std::vector<uint64_t> &uses) const;
+
+    // Variables, e.g. to make excluded for count(), sample(), and
+    //   enumerate()
+    const std::vector<Variable>    &variables() const { return _variables; }
+    const std::string              &names    () const { return _names    ; }
+    uint32_t                        cells    () const { return _cells    ; }
+
+    // Statistics: number of nodes, including EMPTY and UNIT
+    size_t      nodes() const { return _nodes.size(); }
+
+
+
+  protected:
+    uint32_t    build  (const uint32_t      cells ,
+                        const unsigned      unused);
+    uint32_t    node   (const uint32_t      var   ,
+                        const uint32_t      lo    ,
+                        const uint32_t      hi    );
+
+    void        allowed(const std::vector<bool>    &excluded,
+                              std::vector<uint64_t>&counts  ) const;
+    void        descend(      uint64_t              index   ,
+                        const std::vector<uint64_t>&counts  ,
+                        const std::vector<bool>    *excluded,
+                              Cover                &cover   ) const;
+
+    template<typename Visit>
+    bool        walk   (const uint32_t              node    ,
+                        const std::vector<bool>    *excluded,
+                              Cover                &cover   ,
+                              Visit                &visit   ,
+                              uint64_t             &visited ) const
+    {
+        if (node == EMPTY)
+            return true;
+
+        if (node == UNIT) {
+            ++visited;
+            return visit(static_cast<const Cover&>(cover));
+        }
+
+        const Node      &current  = _nodes    [node       ];
+        const Variable  &variable = _variables[current.var];
+
+        if (!excluded || !(*excluded)[current.var]) {
+            cover[variable.item] = variable.mask;
+            const bool  more = walk(current.hi, excluded, cover, visit,
+                                    visited                           );
+            cover[variable.item] = 0;
+            if (!more)
+                return false;
+        }
+
+        return walk(current.lo, excluded, cover, visit, visited);
+    }
+
+    uint32_t                    _cells    ;
+    std::string                 _names    ;
+    std::vector<Variable>       _variables;
+    std::vector<Node>           _nodes    ; // children before parents
+    std::vector<uint64_t>       _counts   ; // per node, number of covers
+    uint32_t                    _root     ;
+
+    // Construction only, see build()
+    std::array<std::vector<uint32_t>, 32>           _lowest ;   // vars
+    std::unordered_map<uint64_t, uint32_t>          _states ;
+    std::map<std::array<uint32_t, 3>, uint32_t>     _uniques;   // nodes
+
+};  // class Zdd
+
+}  // namespace soma
+
+#endif  // #ifndef ZDD_HXX